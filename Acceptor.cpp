@@ -3,6 +3,7 @@
 #include <muduo/Channel.h>
 #include <muduo/Socket.h>
 #include <fcntl.h>
+#include <cassert>
 
 using namespace muduo;
 
@@ -18,10 +19,13 @@ Acceptor::Acceptor(EventLoop* owner, const InetAddr& addr, bool reuse_port)
 #endif
     , idleFd_(::open("/dev/null", O_RDONLY|O_CLOEXEC))
     , listening_(false)
+    , maxAcceptsPerWakeup_(kDefaultMaxAcceptsPerWakeup)
+    , completionIo_(false)
 {
     listener_->SetReuseAddr(true);
     listener_->SetReusePort(reuse_port);
     listener_->BindInetAddr(addr);
+    addr_ = InetAddr(sockets::address::getLocalAddr(listener_->FileDescriptor()));  // port 0 was given a real one
     channel_->SetReadCallback(std::bind(&Acceptor::HandleNewConnection, this));
 }
 
@@ -38,15 +42,51 @@ void Acceptor::Listen() {
     bool expect = false;
     if (listening_.compare_exchange_strong(expect, true)) { // CAS
         listener_->Listen();
+        if (completionIo_ && !owner_->SupportsCompletionIo()) {
+            LOG_WARN << "Acceptor the poller doesn't support completion mode, fall back to accept(2)";
+            completionIo_ = false;
+        }
+        if (completionIo_) {
+            channel_->EnableCompletionIo(Channel::kAcceptCompletion);
+        }
         channel_->EnableReading();
     }
 }
 
+bool Acceptor::AttachReusePortCpuSteering(size_t group_size) {
+    owner_->AssertInLoopThread();
+    assert(listening_);
+    return listener_->AttachReusePortCpuSteering(group_size);
+}
+
+bool Acceptor::SetIncomingCpu(int cpu) {
+    return listener_->SetIncomingCpu(cpu);
+}
+
 void Acceptor::HandleNewConnection() {
     owner_->AssertInLoopThread();
-    InetAddr remote_addr;
-    int connfd = listener_->Accept(&remote_addr);
-    if (connfd >= 0) {
+    // the listener is non-blocking, accepts until EAGAIN instead of waking up once per connection,
+    // the accepted sockets are non-blocking & close-on-exec already(accept4), no fcntl per connection
+    size_t accepted = 0;
+    while (accepted < maxAcceptsPerWakeup_) {
+        InetAddr remote_addr;
+        int connfd = -1;
+        if (completionIo_) {
+            int savedErrno = 0;
+            connfd = owner_->TakeAccepted(channel_.get(), &savedErrno);
+            if (connfd < 0) {
+                HandleAcceptError(savedErrno);
+                break;
+            }
+            remote_addr = InetAddr(sockets::address::getRemoteAddr(connfd));
+        } else {
+            connfd = listener_->Accept(&remote_addr);
+            if (connfd < 0) {
+                HandleAcceptError(errno);
+                break;
+            }
+        }
+        accepted++;
         if (onNewConnectionCb_) {
             onNewConnectionCb_(connfd, remote_addr);
         } else {
@@ -54,15 +94,24 @@ void Acceptor::HandleNewConnection() {
                 << "close new connection(" << connfd << ")now";
             sockets::close(connfd);
         }
-    } else {
-        LOG_SYSERR << "in Acceptor::HandleNewConnection" ;
-        if (errno == EMFILE) {  // Current progress opens too many open files, 占坑法
-            LOG_WARN << "Current progress opens too many open files";
+    }
+    if (accepted > 0 && onAcceptedBatchCb_) {
+        onAcceptedBatchCb_();
+    }
+}
 
-            sockets::close(idleFd_);
-            idleFd_ = ::accept(listener_->FileDescriptor(), nullptr, nullptr);
-            sockets::close(idleFd_);
-            idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-        }
+void Acceptor::HandleAcceptError(int err) {
+    if (err == EAGAIN) {
+        return;     // drained
+    }
+    errno = err;
+    LOG_SYSERR << "in Acceptor::HandleNewConnection" ;
+    if (err == EMFILE) {  // Current progress opens too many open files, 占坑法
+        LOG_WARN << "Current progress opens too many open files";
+
+        sockets::close(idleFd_);
+        idleFd_ = ::accept(listener_->FileDescriptor(), nullptr, nullptr);
+        sockets::close(idleFd_);
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
     }
 }
@@ -5,6 +5,7 @@
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <cassert>
 
 namespace muduo {
 class EventLoop;    // forward declaration
@@ -20,12 +21,23 @@ class Acceptor {
     Acceptor& operator=(const Acceptor&) = delete;
 public:
     using NewConnectionCallback_t = std::function<void(int sockfd, const InetAddr& addr)>; 
+    using AcceptedBatchCallback_t = std::function<void()>;
+
+    /// the default of the connections accepted per wakeup
+    static const size_t kDefaultMaxAcceptsPerWakeup = 64;
 
 public:
     Acceptor(EventLoop* owner, const InetAddr& addr, bool reuse_port);
     ~Acceptor() noexcept;
     void Listen();
 
+    /// @pre listening, and the socket was bound with reuse_port
+    /// @see Socket::AttachReusePortCpuSteering
+    bool AttachReusePortCpuSteering(size_t group_size);
+    /// @see Socket::SetIncomingCpu
+    bool SetIncomingCpu(int cpu);
+
+    /// @brief The bound address, whose port was chosen by the kernel if 0 was given
     const InetAddr& GetListeningAddr() const
     { return addr_; }
 
@@ -36,12 +48,31 @@ public:
 
     void SetNewConnectionCallback(const NewConnectionCallback_t& cb) 
     { onNewConnectionCb_ = cb; }
+
+    /// @brief Called after the connections of a wakeup were handed to NewConnectionCallback one by one,
+    /// so the receiver can flush them together
+    void SetAcceptedBatchCallback(const AcceptedBatchCallback_t& cb)
+    { onAcceptedBatchCb_ = cb; }
+
+    /// @brief Accepts until the backlog is drained or n connections are accepted in a wakeup,
+    /// the rest are left to the next wakeup so that the other events of loop are not starved.
+    /// 1 accepts a connection per wakeup
+    void SetMaxAcceptsPerWakeup(size_t n)
+    { assert(n > 0); maxAcceptsPerWakeup_ = n; }
+
+    /// @brief Lets the poller accept the connections with a multishot request(e.g. io_uring),
+    /// the accepted sockets are handed over without accept(2) per connection
+    /// @note Must be called before Listen, falls back to accept(2) if the poller doesn't support it,
+    ///     see EventLoop::SupportsCompletionIo
+    void SetCompletionIo(bool on)
+    { assert(!listening_); completionIo_ = on; }
     
     std::string GetIp() const { return addr_.GetIp(); }
     std::string GetIpPort() const { return addr_.GetIpPort(); }
 
 private:
     void HandleNewConnection();
+    void HandleAcceptError(int err);
 
 private:
     EventLoop* const owner_;
@@ -52,7 +83,11 @@ private:
     // std::atomic_flag listening_;
     std::atomic_bool listening_;
 
+    size_t maxAcceptsPerWakeup_;
+    bool completionIo_;
+
     NewConnectionCallback_t onNewConnectionCb_;
+    AcceptedBatchCallback_t onAcceptedBatchCb_;
 };
 
 } // namespace muduo 
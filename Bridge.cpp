@@ -26,6 +26,7 @@ Bridge::Bridge(EventLoop* loop)
     , chan_(std::make_unique<Channel>(loop, CreateEventFd()))
 #endif
 {
+    chan_->EnableEdgeTriggered();   // reading the eventfd resets it, see Bridge::HandleWakeUpFdRead
     chan_->EnableReading();
     chan_->SetReadCallback(std::bind(&Bridge::HandleWakeUpFdRead, this));
 }
@@ -5,18 +5,37 @@ using namespace muduo;
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
+char* detail::AllocateBufferStorage(BufferBlockPool* pool, size_t n) {
+    if (pool != nullptr && n <= BufferBlockPool::kMaxBlockSize) {
+        return pool->Allocate(n);
+    }
+    return static_cast<char*>(::operator new(n));
+}
+
+void detail::FreeBufferStorage(BufferBlockPool* pool, char* p, size_t n) {
+    if (pool != nullptr && n <= BufferBlockPool::kMaxBlockSize) {
+        pool->Free(p, n);
+    } else {
+        ::operator delete(p);
+    }
+}
+
 ssize_t Buffer::ReadFd(int fd, int* savedErrno) {
     // saved an ioctl()/FIONREAD call to tell how much to read
     char extrabuf[65536];
+    return ReadFd(fd, extrabuf, sizeof extrabuf, savedErrno);
+}
+
+ssize_t Buffer::ReadFd(int fd, char* spill, size_t spillSize, int* savedErrno) {
     struct iovec vec[2];
     const size_t writable = WriteableBytes();
     vec[0].iov_base = Begin() + writerIndex_;
     vec[0].iov_len = writable;
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
-    // when there is enough space in this buffer, don't read into extrabuf.
-    // when extrabuf is used, we read 128k-1 bytes at most.
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    vec[1].iov_base = spill;
+    vec[1].iov_len = spillSize;
+    // when there is enough space in this buffer, don't read into spill.
+    // when spill is used, we read writable+spillSize-1 bytes at most.
+    const int iovcnt = (writable < spillSize) ? 2 : 1;
     const ssize_t n = sockets::readv(fd, vec, iovcnt);
     if (n < 0) {
         *savedErrno = errno;
@@ -24,7 +43,7 @@ ssize_t Buffer::ReadFd(int fd, int* savedErrno) {
         writerIndex_ += n;
     } else {
         writerIndex_ = buffer_.size();
-        Append(extrabuf, n - writable);
+        Append(spill, n - writable);
     }
     return n;
 }
\ No newline at end of file
@@ -2,11 +2,68 @@
 #define MUDUO_BUFFER_H
 
 #include <muduo/base/Endian.h>
+#include <muduo/BufferBlockPool.h>
 #include <vector>
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <type_traits>
+#include <utility>
 namespace muduo {
 
+namespace detail {
+/// @return n bytes from pool if it's not null and n fits in a block, otherwise from heap
+char* AllocateBufferStorage(BufferBlockPool* pool, size_t n);
+void FreeBufferStorage(BufferBlockPool* pool, char* p, size_t n);
+
+/// @brief Allocator of the storage of Buffer, draws the blocks from pool if given.
+/// It default-initializes the elements, so neither constructing nor resizing the storage zero-fills it.
+/// A copy of the storage is allocated from heap, and the allocator never propagates,
+/// so the pool is only used by the buffer which was created with it.
+template <typename T>
+class BufferAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+    using is_always_equal = std::false_type;
+
+    BufferAllocator() noexcept : pool_(nullptr) { }
+    explicit BufferAllocator(BufferBlockPool* pool) noexcept : pool_(pool) { }
+    template <typename U>
+    BufferAllocator(const BufferAllocator<U>& other) noexcept : pool_(other.pool()) { }
+
+    T* allocate(size_t n)
+    { return reinterpret_cast<T*>(AllocateBufferStorage(pool_, n * sizeof(T))); }
+
+    void deallocate(T* p, size_t n)
+    { FreeBufferStorage(pool_, reinterpret_cast<char*>(p), n * sizeof(T)); }
+
+    /// default-initializes, instead of value-initializing
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value)
+    { ::new (static_cast<void*>(p)) U; }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    BufferAllocator select_on_container_copy_construction() const
+    { return BufferAllocator(); }
+
+    BufferBlockPool* pool() const { return pool_; }
+
+    template <typename U>
+    bool operator==(const BufferAllocator<U>& other) const { return pool_ == other.pool(); }
+    template <typename U>
+    bool operator!=(const BufferAllocator<U>& other) const { return pool_ != other.pool(); }
+
+private:
+    BufferBlockPool* pool_;
+};
+} // namespace detail
+
 /// @code
 /// +-------------------+------------------+------------------+
 /// | prependable bytes |  readable bytes  |  writable bytes  |
@@ -21,12 +78,13 @@ class TcpConnection;    // forward declaration
 /// a copyable buffer for send/recv data to/from file descriptor
 class Buffer {
     friend TcpConnection;
+    using Storage = std::vector<char, detail::BufferAllocator<char>>;
 public:
     static const size_t kCheapPrepend = 8;
 
     static const size_t kInitialSize = 1024;
     explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + initialSize, 0)
+        : buffer_(kCheapPrepend + initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
     {
@@ -35,10 +93,45 @@ public:
         assert(PrependableBytes() == kCheapPrepend);
     }
 
+    /// @brief A pooled buffer, whose storage is a block of pool(4, 16 or 64 KiB, larger ones from heap).
+    /// The storage grows to the whole block, and is returned to pool by ReleaseStorage.
+    /// @param initialSize 0 means no storage until the first appending
+    /// @note Must be used in the loop thread of pool, a copy of it or the buffer moved to is not pooled
+    /// @see EventLoop::GetBufferBlockPool
+    Buffer(BufferBlockPool* pool, size_t initialSize)
+        : buffer_(detail::BufferAllocator<char>(pool))
+        , readerIndex_(0)
+        , writerIndex_(0)
+    {
+        if (initialSize > 0) {
+            EnsureWriteableBytes(initialSize);
+        }
+    }
+
 public:
     Buffer(const Buffer&) = default;
     Buffer& operator=(const Buffer&) = default;
 
+    /// @brief Steals the storage, the moved-from buffer is left empty but usable
+    /// @note The readable bytes of a pooled buffer are copied instead, and it keeps its storage,
+    ///     the copying allocates, so the moves are not noexcept
+    Buffer(Buffer&& other)
+        : buffer_()
+        , readerIndex_(0)
+        , writerIndex_(0)
+    { MoveFrom(&other); }
+
+    Buffer& operator=(Buffer&& other) {
+        if (this != &other) {
+            MoveFrom(&other);
+        }
+        return *this;
+    }
+
+    /// @return whether the storage is drawn from a BufferBlockPool
+    bool Pooled() const
+    { return buffer_.get_allocator().pool() != nullptr; }
+
     size_t ReadableBytes() const
     { return writerIndex_ - readerIndex_; }
 
@@ -64,8 +157,9 @@ public:
     }
 
     void RetrieveAll() {
-        readerIndex_ = kCheapPrepend;
-        writerIndex_ = kCheapPrepend;
+        // a moved-from buffer has no storage yet
+        readerIndex_ = std::min(kCheapPrepend, buffer_.size());
+        writerIndex_ = readerIndex_;
     }
 
     std::string RetrieveAsString(size_t len) {
@@ -115,12 +209,52 @@ public:
     void Shrink()
     { buffer_.shrink_to_fit(); }
 
+    /// @brief Reallocates the storage to fit readable bytes plus reserve writable bytes
+    void Shrink(size_t reserve) {
+        const size_t readable = ReadableBytes();
+        Storage storage(kCheapPrepend + readable + reserve, buffer_.get_allocator());
+        std::copy(Peek(), Peek()+readable, storage.begin()+kCheapPrepend);
+        buffer_.swap(storage);
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = readerIndex_ + readable;
+    }
+
+    /// @brief Frees the storage of an empty buffer, it's allocated again on next appending
+    void ReleaseStorage() {
+        assert(ReadableBytes() == 0);
+        Storage(buffer_.get_allocator()).swap(buffer_);
+        ResetAfterMoved();
+    }
+
+    /// @brief Moves the readable bytes into storage drawn from pool, e.g. when the owner moved to another loop.
+    /// The old storage is returned to its pool, which may be done in any thread
+    /// @note Must be called in the loop thread of the new pool
+    void RebindPool(BufferBlockPool* pool) {
+        Buffer rebound(pool, 0);
+        rebound.Append(Peek(), ReadableBytes());
+        // the allocators never propagate on assignment, so the storage is re-constructed to take the new one
+        buffer_.~Storage();
+        ::new (static_cast<void*>(&buffer_)) Storage(std::move(rebound.buffer_));
+        readerIndex_ = rebound.readerIndex_;
+        writerIndex_ = rebound.writerIndex_;
+        rebound.ResetAfterMoved();
+    }
+
+    /// @return bytes of storage, 0 if released
+    size_t StorageBytes() const
+    { return buffer_.size(); }
+
     /// Read data directly into buffer.
     ///
     /// It may implement with readv(2)
     /// @return result of read(2), @c errno is saved
     ssize_t ReadFd(int fd, int* savedErrno);
 
+    /// @brief Same as above, but the bytes which don't fit in writable space go to spill
+    /// instead of a stack buffer, then are appended
+    /// @param spill scratch space, e.g. EventLoop::GetSpillBuffer
+    ssize_t ReadFd(int fd, char* spill, size_t spillSize, int* savedErrno);
+
 
     /* short-cuts */
 
@@ -268,11 +402,32 @@ public:
     }
 
 private:
+    void MoveFrom(Buffer* other) {
+        if (buffer_.get_allocator() == other->buffer_.get_allocator() && !other->Pooled()) {
+            buffer_ = std::move(other->buffer_);    // the allocators are equal, so the storage is stolen
+            readerIndex_ = other->readerIndex_;
+            writerIndex_ = other->writerIndex_;
+            other->ResetAfterMoved();
+        } else {
+            // the storage can't leave its pool, which is only used in its loop thread
+            RetrieveAll();
+            Append(other->Peek(), other->ReadableBytes());
+            other->RetrieveAll();
+        }
+    }
+
+    /// leaves an empty buffer without storage, which grows on next appending
+    void ResetAfterMoved() noexcept {
+        buffer_.clear();
+        readerIndex_ = 0;
+        writerIndex_ = 0;
+    }
+
     const char* Begin() const
-    { return &buffer_.front(); }
+    { return buffer_.data(); }
 
     char* Begin()
-    { return &buffer_.front(); }
+    { return buffer_.data(); }
 
     char* BeginWrite()
     { return Begin() + writerIndex_; }
@@ -285,8 +440,12 @@ private:
     }
 
     void BroadenSpace(size_t len) {
-        if (WriteableBytes() + PrependableBytes() < len + kCheapPrepend) {
-            buffer_.resize(writerIndex_+len);
+        if (buffer_.empty()) {  // moved-from
+            Resize(kCheapPrepend + len);
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = kCheapPrepend;
+        } else if (WriteableBytes() + PrependableBytes() < len + kCheapPrepend) {
+            Resize(writerIndex_+len);
         } else {
             // move readable data to the front, make space inside buffer
             assert(kCheapPrepend < readerIndex_);
@@ -300,8 +459,20 @@ private:
         }
     }
 
+    /// @brief A pooled storage takes the whole block, which costs nothing since it's not zero-filled
+    void Resize(size_t size) {
+        if (Pooled() && size > buffer_.capacity()) {
+            const size_t block = BufferBlockPool::BlockSize(size);
+            if (block > 0) {
+                buffer_.reserve(block);
+                size = block;
+            }
+        }
+        buffer_.resize(size);
+    }
+
 private: 
-    std::vector<char> buffer_;
+    Storage buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
 };
@@ -0,0 +1,79 @@
+#include <muduo/BufferBlockPool.h>
+#include <muduo/EventLoop.h>
+#include <cassert>
+
+using namespace muduo;
+
+const size_t BufferBlockPool::kClassesNum;
+const size_t BufferBlockPool::kMaxBlockSize;
+const size_t BufferBlockPool::kSlabBytes;
+
+namespace {
+const size_t kBlockSizes[BufferBlockPool::kClassesNum] = {4 * 1024, 16 * 1024, 64 * 1024};
+} // namespace
+
+BufferBlockPool::BufferBlockPool(EventLoop* loop)
+    : loop_(loop)
+    , slabs_()
+{ }
+
+BufferBlockPool::~BufferBlockPool() noexcept = default;
+
+size_t BufferBlockPool::ClassOf(size_t n) {
+    assert(n > 0 && n <= kMaxBlockSize);
+    size_t cls = 0;
+    while (kBlockSizes[cls] < n) {
+        cls++;
+    }
+    return cls;
+}
+
+size_t BufferBlockPool::BlockSize(size_t n) {
+    return n > kMaxBlockSize ? 0 : kBlockSizes[ClassOf(n == 0 ? 1 : n)];
+}
+
+char* BufferBlockPool::Allocate(size_t n) {
+    loop_->AssertInLoopThread();
+    const size_t cls = ClassOf(n);
+    Block* block = freeLists_[cls];
+    if (block == nullptr) {
+        // only the loop thread pops, and it takes the whole list at once, so there is no ABA problem
+        block = remoteFrees_[cls].exchange(nullptr, std::memory_order_acquire);
+    }
+    if (block == nullptr) {
+        AllocateSlab(cls);
+        block = freeLists_[cls];
+    }
+    freeLists_[cls] = block->next;
+    liveBlocks_.fetch_add(1, std::memory_order_relaxed);
+    return reinterpret_cast<char*>(block);
+}
+
+void BufferBlockPool::Free(char* ptr, size_t n) {
+    const size_t cls = ClassOf(n);
+    Block* block = reinterpret_cast<Block*>(ptr);
+    liveBlocks_.fetch_sub(1, std::memory_order_relaxed);
+    if (loop_->IsInLoopThread()) {
+        block->next = freeLists_[cls];
+        freeLists_[cls] = block;
+    } else {
+        // without waking up the loop, the loop drains it when it needs
+        Block* head = remoteFrees_[cls].load(std::memory_order_relaxed);
+        do {
+            block->next = head;
+        } while (!remoteFrees_[cls].compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+    }
+}
+
+void BufferBlockPool::AllocateSlab(size_t cls) {
+    const size_t size = kBlockSizes[cls];
+    slabs_.emplace_back(new char[kSlabBytes]);  // default-initialized, no zero-filling
+    slabBytes_.fetch_add(kSlabBytes, std::memory_order_relaxed);
+    char* slab = slabs_.back().get();
+    // links in address order, so the blocks are handed out from the front of slab
+    for (size_t offset = kSlabBytes; offset >= size; offset -= size) {
+        Block* block = reinterpret_cast<Block*>(slab + offset - size);
+        block->next = freeLists_[cls];
+        freeLists_[cls] = block;
+    }
+}
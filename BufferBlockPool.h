@@ -0,0 +1,71 @@
+#if !defined(MUDUO_BUFFER_BLOCK_POOL_H)
+#define MUDUO_BUFFER_BLOCK_POOL_H
+
+#include <muduo/base/allocator/Allocatable.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace muduo {
+
+class EventLoop;    // forward declaration
+
+/**
+ * Per-loop pool of fixed-size blocks(4, 16 and 64 KiB), the storage of pooled Buffer and OutputQueue chunks.
+ * The blocks are carved from kSlabBytes slabs without zero-filling, and a freed block is reused
+ * by the next allocation of its size, so connections accepted in a burst neither call malloc nor fault in new pages.
+ * @note Allocate must be called in the loop thread.
+ *  Free may be called in any thread, a block freed by a foreign thread is pushed to a lock-free list,
+ *  which the loop thread drains when the free list of the size runs out.
+ * @see EventLoop::GetBufferBlockPool
+*/
+#ifdef MUDUO_USE_MEMPOOL
+class BufferBlockPool : public base::detail::Allocatable {
+#else
+class BufferBlockPool {
+#endif
+    // non-copyable & non-moveable
+    BufferBlockPool(const BufferBlockPool&) = delete;
+    BufferBlockPool& operator=(const BufferBlockPool&) = delete;
+
+public:
+    static const size_t kClassesNum = 3;
+    static const size_t kMaxBlockSize = 64 * 1024;
+    static const size_t kSlabBytes = 256 * 1024;
+
+    explicit BufferBlockPool(EventLoop* loop);
+    ~BufferBlockPool() noexcept;
+
+    /// @return size of the block serving n bytes, 0 if n is larger than kMaxBlockSize
+    static size_t BlockSize(size_t n);
+
+    /// @pre 0 < n <= kMaxBlockSize
+    /// @return a block of BlockSize(n) bytes, its content is indeterminate
+    char* Allocate(size_t n);
+    /// @param n the same as the one allocated with
+    void Free(char* block, size_t n);
+
+    /// @brief bytes of all the slabs
+    size_t SlabBytes() const { return slabBytes_.load(std::memory_order_relaxed); }
+    /// @brief blocks handed out and not freed yet(including the ones freed by foreign threads but not drained)
+    size_t LiveBlocks() const { return liveBlocks_.load(std::memory_order_relaxed); }
+
+private:
+    struct Block { Block* next; };  // a free block, linked by its first word
+
+    static size_t ClassOf(size_t n);
+    void AllocateSlab(size_t cls);
+
+private:
+    EventLoop* const loop_;
+    Block* freeLists_[kClassesNum] {};
+    std::atomic<Block*> remoteFrees_[kClassesNum] {};   // MPSC stacks, pushed by foreign threads
+    std::vector<std::unique_ptr<char[]>> slabs_;
+    std::atomic<size_t> slabBytes_ {0};
+    std::atomic<size_t> liveBlocks_ {0};
+};
+
+} // namespace muduo
+
+#endif // MUDUO_BUFFER_BLOCK_POOL_H
@@ -1,6 +1,7 @@
 #if !defined(MUDUO_CALLBACKS_H)
 #define MUDUO_CALLBACKS_H
 
+#include <muduo/base/InlineFunction.h>
 #include <functional>
 #include <chrono>
 #include <memory>
@@ -12,7 +13,13 @@ class Buffer;           // forward declaration
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
 using ReceiveTimePoint_t = std::chrono::system_clock::time_point;   // must same as EventLoop::ReceiveTimePoint_t
-using PendingEventCb_t = std::function<void()>;
+using PendingEventCb_t = base::InlineFunction<void()>;   // move-only, small callables are stored inline
+
+/// @brief Lane of a pending callback, see EventLoop::EnqueueEventLoop
+enum class CallbackPriority {
+    kNormal,
+    kHigh,  // control tasks(timers, closing), run before the normal ones and out of the budget of an iteration
+};
 
 using IoThreadInitCallback_t = std::function<void(EventLoop* loop)>;
 
@@ -14,6 +14,8 @@ Channel::Channel(EventLoop* owner, int fd)
     , fd_(fd)
     , events_(kNoneEvent)
     , logHup_(true)
+    , edgeTriggered_(false)
+    , completionIo_(kNoCompletion)
     , eventHandling_(false)
     , revents_(kNoneEvent)
     , index_(-1)
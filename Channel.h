@@ -27,10 +27,13 @@ class Channel {
     static const int kWriteEvent;
 
 public:
+    /// how the poller serves the reading of a channel, see Channel::EnableCompletionIo
+    enum CompletionIo { kNoCompletion, kReceiveCompletion, kAcceptCompletion };
+
     Channel(EventLoop* owner, int fd);
-    using EventCallback_t = std::function<void()>;
+    using EventCallback_t = base::InlineFunction<void()>;
     using ReceiveTimePoint_t = EventLoop::ReceiveTimePoint_t;
-    using RDCallback_t = std::function<void(const ReceiveTimePoint_t&)>;
+    using RDCallback_t = base::InlineFunction<void(const ReceiveTimePoint_t&)>;
 
     ~Channel() {
         assert(!eventHandling_);
@@ -46,13 +49,15 @@ public:
         tied_ = true;
     }
 
-    void SetReadCallback(const RDCallback_t& cb) { readCb_ = cb; }
-    void SetWriteCallback(const EventCallback_t& cb) { writeCb_ = cb; }
-    void SetCloseCallback(const EventCallback_t& cb) { closeCb_ = cb; }
-    void SetErrorCallback(const EventCallback_t& cb) { errorCb_ = cb; }
+    void SetReadCallback(RDCallback_t cb) { readCb_ = std::move(cb); }
+    void SetWriteCallback(EventCallback_t cb) { writeCb_ = std::move(cb); }
+    void SetCloseCallback(EventCallback_t cb) { closeCb_ = std::move(cb); }
+    void SetErrorCallback(EventCallback_t cb) { errorCb_ = std::move(cb); }
 
     void EnableReading() { events_ |= kReadEvent; Update(); }
     void enableWriting() { events_ |= kWriteEvent; Update(); }
+    void EnableReadingAndWriting() { events_ |= (kReadEvent | kWriteEvent); Update(); }
+    void disableReading() { events_ &= ~kReadEvent; Update(); }
     void disableWriting() { events_ &= ~kWriteEvent; Update(); }
     void disableAllEvents() { events_ = kNoneEvent; Update(); }
 
@@ -60,6 +65,22 @@ public:
     bool IsWriting() const { return events_ & kWriteEvent; }
     void NotLogHup() { logHup_ = false; }
 
+    /**
+     * Requests edge-triggered notification, takes effect on the next update.
+     * @note Only honored by pollers which support it(e.g. epoll), see EventLoop::SupportsEdgeTriggered
+    */
+    void EnableEdgeTriggered() { edgeTriggered_ = true; }
+    bool IsEdgeTriggered() const { return edgeTriggered_; }
+
+    /**
+     * Lets the poller receive(kReceiveCompletion) OR accept(kAcceptCompletion) for the channel while reading is enabled,
+     * the results are reported as POLLIN and taken by EventLoop::TakeReceived OR EventLoop::TakeAccepted
+     * instead of read(2)/accept(2). Takes effect on the next update.
+     * @note Only honored by pollers which support it(e.g. io_uring), see EventLoop::SupportsCompletionIo
+    */
+    void EnableCompletionIo(CompletionIo mode) { completionIo_ = mode; }
+    CompletionIo GetCompletionIo() const { return completionIo_; }
+
     /**
      * handle incoming events
     */
@@ -106,6 +127,8 @@ private:
     const int fd_;
     int events_;        // interested I/O events
     bool logHup_;       // for POLLHUP
+    bool edgeTriggered_;
+    CompletionIo completionIo_;
     bool eventHandling_; 
     int revents_;		// poll/epoll返回的事件
     int index_;
@@ -1,15 +1,58 @@
 #include <muduo/EventLoop.h>
-#include <muduo/poller/PollPoller.h>
+#include <muduo/Poller.h>
 #include <muduo/Callbacks.h>
 #include <muduo/TimerQueue.h>
 #include <muduo/Channel.h>
 #include <muduo/Bridge.h>
+#include <muduo/BufferBlockPool.h>
 #include <chrono>
+#include <cstdint>
 #include <cassert>
 #include <sys/poll.h>
 
 namespace {
     thread_local muduo::EventLoop* tl_loop_inThisThread = {nullptr};
+
+    /// element of EventLoop::pendingCbsQueue_
+    /// @note allocated by the producer thread, so can't be allocated in the loop-level mempool
+    struct PendingCallbackNode : public muduo::base::MpscNode {
+        muduo::PendingEventCb_t callback;
+    };
+
+    /**
+     * Per-thread cache of the nodes recycled by loops,
+     * refilled by taking the whole recycled-list of the target loop at once,
+     * so a steady stream of cross-thread callbacks allocates nothing.
+     * Like the capacity of a vector, the cached nodes are bounded by the peak number of pending callbacks.
+    */
+    class PendingNodeCache {
+    public:
+        ~PendingNodeCache() {
+            while (head_ != nullptr) {
+                PendingCallbackNode* next = static_cast<PendingCallbackNode*>(head_->next.load(std::memory_order_relaxed));
+                delete head_;
+                head_ = next;
+            }
+        }
+
+        PendingCallbackNode* Get(std::atomic<muduo::base::MpscNode*>& recycled) {
+            if (head_ == nullptr) {
+                // taking the whole list is immune to ABA problem
+                head_ = static_cast<PendingCallbackNode*>(recycled.exchange(nullptr, std::memory_order_acquire));
+                if (head_ == nullptr) {
+                    return new PendingCallbackNode;
+                }
+            }
+            PendingCallbackNode* node = head_;
+            head_ = static_cast<PendingCallbackNode*>(node->next.load(std::memory_order_relaxed));
+            return node;
+        }
+
+    private:
+        PendingCallbackNode* head_ {nullptr};
+    };
+
+    thread_local PendingNodeCache tl_pendingNodeCache;
 }
 
 namespace muduo {
@@ -17,6 +60,13 @@ namespace muduo {
 using namespace std::chrono;
 
 const EventLoop::TimeoutDuration_t EventLoop::kPollTimeout = duration_cast<EventLoop::TimeoutDuration_t>(seconds(5));
+const size_t EventLoop::kSpillBufferSize;
+const int EventLoop::kMaxSendIovecs;
+
+namespace {
+/// the time budget of pending callbacks is checked once per so many callbacks
+const size_t kBudgetCheckInterval = 8;
+} // namespace
 
 /**
  * @code
@@ -37,8 +87,12 @@ const EventLoop::TimeoutDuration_t EventLoop::kPollTimeout = duration_cast<Event
  * @endcode 
  */
 EventLoop::EventLoop()
+    : EventLoop(EventLoopOptions())
+{ }
+
+EventLoop::EventLoop(const EventLoopOptions& options)
 #ifdef MUDUO_USE_MEMPOOL
-    : memPool_(std::make_unique<base::MemoryPool>(this))
+    : memPool_(std::make_unique<base::MemoryPool>(this, options.memPool))
     , threadId_(::pthread_self())
 #else
     : threadId_(::pthread_self())
@@ -47,18 +101,43 @@ EventLoop::EventLoop()
     , quit_(false)
     , eventHandling_(false)
 #ifdef MUDUO_USE_MEMPOOL
-    , poller_(new (memPool_.get()) PollPoller(this))
-    , timerQueue_(new (memPool_.get()) TimerQueue(this))
+    , poller_(Poller::NewDefaultPoller(this))
+    , timerQueue_(new (memPool_.get()) TimerQueue(this, options.timerBackend))
+    , timerSlack_(options.timerSlack)
+    , busyPollBudget_(options.busyPollBudget)
+    , socketBusyPoll_(options.socketBusyPoll)
+    , spinning_(false)
+    , lastWork_()
+    , maxPendingCbs_(options.maxPendingCallbacks)
+    , pendingCbsBudget_(options.pendingCallbacksBudget)
+    , carriedOver_(false)
+    , carriedOverIterations_(0)
     , activeChannels_(base::allocator<Channel*>(GetMemoryPool()))
+    , bufferBlockPool_(new (memPool_.get()) BufferBlockPool(this))
     , bridge_(new (memPool_.get()) Bridge(this))
 #else
-    , poller_(std::make_unique<PollPoller>(this))
-    , timerQueue_(std::make_unique<TimerQueue>(this))
+    , poller_(Poller::NewDefaultPoller(this))
+    , timerQueue_(std::make_unique<TimerQueue>(this, options.timerBackend))
+    , timerSlack_(options.timerSlack)
+    , busyPollBudget_(options.busyPollBudget)
+    , socketBusyPoll_(options.socketBusyPoll)
+    , spinning_(false)
+    , lastWork_()
+    , maxPendingCbs_(options.maxPendingCallbacks)
+    , pendingCbsBudget_(options.pendingCallbacksBudget)
+    , carriedOver_(false)
+    , carriedOverIterations_(0)
     , activeChannels_()
+    , bufferBlockPool_(std::make_unique<BufferBlockPool>(this))
     , bridge_(std::make_unique<Bridge>(this))
 #endif
     , pendingCbsQueue_()
+    , urgentCbsQueue_()
     , callingPendingCbs_(false)
+    , wakeupPending_(false)
+    , enqueuedCbs_(0)
+    , coalescedWakeups_(0)
+    , recycledNodes_(nullptr)
 {
     LOG_DEBUG << "EventLoop is created in thread " << threadId_;
     if (tl_loop_inThisThread != nullptr) {
@@ -67,6 +146,13 @@ EventLoop::EventLoop()
     } else {
         tl_loop_inThisThread = this;
     }
+#ifdef MUDUO_USE_MEMPOOL
+    // the loop doesn't wait for the classes to allocate again, the empty spans are released in time
+    const Interval_t drainInterval = options.memPool.remote_drain_interval;
+    if (drainInterval > Interval_t::zero()) {
+        RunEvery(drainInterval, [this]() { memPool_->drain_remote_spans(); }, drainInterval);
+    }
+#endif
 }
 
 EventLoop::~EventLoop() {
@@ -77,6 +163,19 @@ EventLoop::~EventLoop() {
 #endif
     LOG_DEBUG << "EventLoop " << this << " of thread " << threadId_
             << " destructs in thread " << ::pthread_self();
+    // discards the callbacks which were never handled
+    pendingCbsQueue_.Consume([](base::MpscNode* node) {
+        delete static_cast<PendingCallbackNode*>(node);
+    });
+    urgentCbsQueue_.Consume([](base::MpscNode* node) {
+        delete static_cast<PendingCallbackNode*>(node);
+    });
+    base::MpscNode* recycled = recycledNodes_.exchange(nullptr, std::memory_order_acquire);
+    while (recycled != nullptr) {
+        base::MpscNode* next = recycled->next.load(std::memory_order_relaxed);
+        delete static_cast<PendingCallbackNode*>(recycled);
+        recycled = next;
+    }
     tl_loop_inThisThread = nullptr;
 }
 
@@ -101,18 +200,57 @@ void EventLoop::Loop() {
 
     LOG_TRACE << "EventLoop " << this << " start to loop";
 
+    lastWork_ = steady_clock::now();
     while (!quit_) {
         activeChannels_.clear();    // Clear the list for polling new channels
-        receiveTimePoint_ = poller_->Poll(kPollTimeout, &activeChannels_);
+        receiveTimePoint_ = poller_->Poll(NextPollTimeout(), &activeChannels_);
+        const steady_clock::time_point busyStart = steady_clock::now();
         if (muduo::GetLoglevel() <= Logger::LogLevel::TRACE) {
             PrintActiveChannels();
         }
         HandleActiveChannels();
-        HandlePendingCallbacks();
+        const bool handledCallbacks = HandlePendingCallbacks();
+        const steady_clock::time_point busyEnd = steady_clock::now();
+        load_.AddBusyTime(duration_cast<nanoseconds>(busyEnd - busyStart));
+        if (handledCallbacks || !activeChannels_.empty()) {
+            lastWork_ = busyEnd;
+        }
+    }
+    if (spinning_) {
+        spinning_ = false;
+        wakeupPending_.store(false, std::memory_order_release);    // the producers wake up the next Loop
     }
     looping_ = false;
 }
 
+EventLoop::TimeoutDuration_t EventLoop::NextPollTimeout() {
+    if (carriedOver_) {
+        // only polls the ready events, the rest of callbacks are handled right after
+        return TimeoutDuration_t::zero();
+    }
+    if (busyPollBudget_ == microseconds::zero()) {
+        return kPollTimeout;
+    }
+    if (steady_clock::now() - lastWork_ < busyPollBudget_) {
+        if (!spinning_) {
+            spinning_ = true;
+            // looks pending to producers, so they skip the eventfd, see EventLoop::EnqueueEventLoop
+            wakeupPending_.store(true, std::memory_order_release);
+        }
+        return TimeoutDuration_t::zero();
+    }
+    if (spinning_) {
+        spinning_ = false;
+        // re-arms the wakeup before blocking, a producer which skipped the eventfd before
+        // has pushed its node before this, so it's seen by the check below
+        wakeupPending_.exchange(false, std::memory_order_acq_rel);
+        if (!pendingCbsQueue_.Empty() || !urgentCbsQueue_.Empty()) {
+            return TimeoutDuration_t::zero();
+        }
+    }
+    return kPollTimeout;
+}
+
 void EventLoop::HandleActiveChannels() {
     assert(!eventHandling_);
     eventHandling_ = true;
@@ -130,62 +268,155 @@ void EventLoop::RemoveChannel(Channel* c) {
     poller_->RemoveChannel(c);
 }
 
-TimerId_t EventLoop::RunAt(const TimePoint_t& when, const TimeoutCb_t& cb) {
-    return timerQueue_->AddTimer(when, TimeoutDuration_t::zero(), cb);
+bool EventLoop::SupportsEdgeTriggered() const {
+    return poller_->SupportsEdgeTriggered();
+}
+
+bool EventLoop::SupportsCompletionIo() const {
+    return poller_->SupportsCompletionIo();
 }
 
-TimerId_t EventLoop::RunAfter(const Interval_t& delay, const TimeoutCb_t& cb) {
+ssize_t EventLoop::TakeReceived(Channel* c, Buffer* buf, int* savedErrno) {
+    return poller_->TakeReceived(c, buf, savedErrno);
+}
+
+int EventLoop::TakeAccepted(Channel* c, int* savedErrno) {
+    return poller_->TakeAccepted(c, savedErrno);
+}
+
+void EventLoop::SubmitSend(Channel* c, const struct iovec* iov, int iovcnt, std::shared_ptr<void> holder) {
+    poller_->SubmitSend(c, iov, iovcnt, std::move(holder));
+}
+
+bool EventLoop::TakeSent(Channel* c, ssize_t* result) {
+    return poller_->TakeSent(c, result);
+}
+
+TimerId_t EventLoop::RunAt(const TimePoint_t& when, TimeoutCb_t cb) {
+    return RunAt(when, std::move(cb), timerSlack_);
+}
+
+TimerId_t EventLoop::RunAt(const TimePoint_t& when, TimeoutCb_t cb, const Interval_t& slack) {
+    return timerQueue_->AddTimer(when, TimeoutDuration_t::zero(), std::move(cb), slack);
+}
+
+TimerId_t EventLoop::RunAfter(const Interval_t& delay, TimeoutCb_t cb) {
+    return RunAfter(delay, std::move(cb), timerSlack_);
+}
+
+TimerId_t EventLoop::RunAfter(const Interval_t& delay, TimeoutCb_t cb, const Interval_t& slack) {
     using namespace std;
     auto timepoint = chrono::steady_clock::now() + delay;
-    return RunAt(timepoint, cb);
+    return RunAt(timepoint, std::move(cb), slack);
 }
 
-TimerId_t EventLoop::RunEvery(const Interval_t& interval, const TimeoutCb_t& cb) {
+TimerId_t EventLoop::RunEvery(const Interval_t& interval, TimeoutCb_t cb) {
+    return RunEvery(interval, std::move(cb), timerSlack_);
+}
+
+TimerId_t EventLoop::RunEvery(const Interval_t& interval, TimeoutCb_t cb, const Interval_t& slack) {
     using namespace std;
     auto timepoint = chrono::steady_clock::now() + interval;
-    return timerQueue_->AddTimer(timepoint, interval, cb);
+    return timerQueue_->AddTimer(timepoint, interval, std::move(cb), slack);
 }
 
 void EventLoop::cancelTimer(const TimerId_t timerId) {
     timerQueue_->CancelTimer(timerId);
 }
 
-void EventLoop::EnqueueEventLoop(const PendingEventCb_t& cb) {
-    {
-        std::lock_guard<std::mutex> guard(mtx_);
-        pendingCbsQueue_.push_back(cb);
-    }
+void EventLoop::EnqueueEventLoop(PendingEventCb_t cb, CallbackPriority priority) {
+    Enqueue(priority == CallbackPriority::kHigh ? &urgentCbsQueue_ : &pendingCbsQueue_, std::move(cb));
+}
+
+void EventLoop::Enqueue(base::MpscQueue* queue, PendingEventCb_t cb) {
+    // both lanes share the nodes and the wakeup
+    PendingCallbackNode* node = tl_pendingNodeCache.Get(recycledNodes_);
+    node->callback = std::move(cb);
+    queue->Push(node);
 
     /**
      * 1. 如果不在IO线程中，因为IO线程此时可能阻塞在poll中，为确保任务即使被处理，故要调用WakeUp
      * 2. 如果在IO线程中并且此时线程正在处理pending Callbacks，由Loop内部实现决定此时还需调用WakeUp,防止IO线程阻塞
      * 3. 如果在IO线程中且此时线程正在处理activeChannels的callback，则无需调用WakeUp
+     * 
+     * Only the producer which flips wakeupPending_ from false to true writes the eventfd,
+     * the others are coalesced into that wakeup.
+     * The flag is set after pushing and cleared by loop before consuming, so a coalesced node is always
+     * pushed before the loop consumes, and a node which is not linked in time is followed by its own wakeup.
     */
+    enqueuedCbs_.fetch_add(1, std::memory_order_relaxed);
     if (!IsInLoopThread() || callingPendingCbs_) {
-        bridge_->WakeUp();
+        if (!wakeupPending_.exchange(true, std::memory_order_acq_rel)) {
+            bridge_->WakeUp();
+        } else {
+            coalescedWakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 }
 
-void EventLoop::RunInEventLoop(const PendingEventCb_t& cb) {
+void EventLoop::RunInEventLoop(PendingEventCb_t cb, CallbackPriority priority) {
     if (IsInLoopThread()) {
         cb();
     } else {
-        EnqueueEventLoop(cb);
+        EnqueueEventLoop(std::move(cb), priority);
     }
 }
 
-void EventLoop::HandlePendingCallbacks() {
-    PendingCallbacksQueue tmp_queue;
-
+bool EventLoop::HandlePendingCallbacks() {
     callingPendingCbs_.store(true);
-    {   // 缩短临界区大小
-        std::lock_guard<std::mutex> guard(mtx_);
-        tmp_queue.swap(pendingCbsQueue_);    // Can effectively prevent deadlock
+    // re-arm the wakeup before consuming, see EventLoop::EnqueueEventLoop.
+    // While spinning it stays pending, the next zero-timeout poll comes soon anyway
+    if (!spinning_) {
+        wakeupPending_.exchange(false, std::memory_order_acq_rel);
     }
-    for (const auto& cb : tmp_queue) {
-        cb.operator()();
+    base::MpscNode* recycledFirst = nullptr;
+    base::MpscNode* recycledLast = nullptr;
+    auto run = [&](base::MpscNode* node) {
+        PendingCallbackNode* pending = static_cast<PendingCallbackNode*>(node);
+        pending->callback.operator()();
+        pending->callback = nullptr;    // releases the captures now, not when the node is reused
+        node->next.store(recycledFirst, std::memory_order_relaxed);
+        recycledFirst = node;
+        recycledLast = (recycledLast == nullptr) ? node : recycledLast;
+    };
+
+    // the high-priority callbacks go first, and again between the normal ones,
+    // so a control task enqueued during a long batch waits for one callback at most
+    size_t handled = urgentCbsQueue_.Consume(run);
+    const size_t maxCbs = (maxPendingCbs_ == 0) ? SIZE_MAX : maxPendingCbs_;
+    const bool timed = (pendingCbsBudget_ != microseconds::zero());
+    const steady_clock::time_point deadline = timed ? steady_clock::now() + pendingCbsBudget_ : steady_clock::time_point();
+    size_t normal = 0;
+    bool exhausted = false;
+    // the callbacks enqueued during consuming are handled in next iteration
+    pendingCbsQueue_.Consume([&](base::MpscNode* node) {
+        run(node);
+        normal += 1;
+        if (!urgentCbsQueue_.Empty()) {
+            handled += urgentCbsQueue_.Consume(run);
+        }
+        // reading the clock every few callbacks, it costs more than a small callback
+        if (normal >= maxCbs || (timed && normal % kBudgetCheckInterval == 0 && steady_clock::now() >= deadline)) {
+            exhausted = true;
+            return false;
+        }
+        return true;
+    });
+    handled += normal;
+    carriedOver_ = exhausted && !pendingCbsQueue_.Empty();
+    if (carriedOver_) {
+        carriedOverIterations_.fetch_add(1, std::memory_order_relaxed);
     }
     callingPendingCbs_.store(false);
+
+    if (recycledFirst != nullptr) {
+        // return the nodes to producers with one CAS
+        base::MpscNode* head = recycledNodes_.load(std::memory_order_relaxed);
+        do {
+            recycledLast->next.store(head, std::memory_order_relaxed);
+        } while (!recycledNodes_.compare_exchange_weak(head, recycledFirst, std::memory_order_release, std::memory_order_relaxed));
+    }
+    return handled > 0;
 }
 
 void EventLoop::Quit() {
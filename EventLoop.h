@@ -3,15 +3,18 @@
 
 #include <muduo/base/allocator/sgi_stl_alloc.h>
 #include <muduo/base/Logging.h>
+#include <muduo/base/MpscQueue.h>
 #include <muduo/TimerType.h>
+#include <muduo/EventLoopOptions.h>
 #include <muduo/Callbacks.h>
-#include <mutex>
+#include <muduo/LoopLoad.h>
 #include <atomic>
 #include <thread>
 #include <forward_list>
 #include <vector>
 #include <memory>
 #include <cassert>
+#include <sys/types.h>
 
 /**
  * Mode of one EventLoop instance per thread.
@@ -25,8 +28,12 @@ namespace muduo {
     class Channel;      // forward declaration
     class Poller;       // forward declaration
     class Bridge;       // forward declaration
+    class BufferBlockPool;  // forward declaration
+    class Buffer;       // forward declaration
 }
 
+struct iovec;   // forward declaration for struct iovec in header file sys/uio.h
+
 namespace {
     extern thread_local muduo::EventLoop* tl_loop_inThisThread;
 } // namespace 
@@ -37,7 +44,6 @@ namespace muduo {
 class EventLoop {
     /// noncopyable & nonmoveable
     EventLoop(const EventLoop&) = delete;
-    using PendingCallbacksQueue = std::vector<PendingEventCb_t>;
     
 #ifdef MUDUO_USE_MEMPOOL
 public:
@@ -56,6 +62,9 @@ public:
     /// @note Only use by EventLoop::Create
     EventLoop();
 
+    /// @brief Constructs with the specified settings
+    explicit EventLoop(const EventLoopOptions& options);
+
     ~EventLoop();
 
     /// @brief Must be called in the same thread as creation of the object.
@@ -77,23 +86,50 @@ public:
     /// @note internal usage
     void RemoveChannel(Channel* c);
 
+    /// Whether the IO-multiplexing backend of the loop supports edge-triggered channels
+    bool SupportsEdgeTriggered() const;
+
+    /// Whether the IO-multiplexing backend of the loop reads, accepts and sends for the channels
+    /// in completion mode itself, see Channel::EnableCompletionIo
+    bool SupportsCompletionIo() const;
+    /// @note internal usage, see Poller::TakeReceived
+    ssize_t TakeReceived(Channel* c, Buffer* buf, int* savedErrno);
+    /// @note internal usage, see Poller::TakeAccepted
+    int TakeAccepted(Channel* c, int* savedErrno);
+    /// the iovecs of a SubmitSend at most
+    static const int kMaxSendIovecs = 64;
+    /// @note internal usage, see Poller::SubmitSend
+    void SubmitSend(Channel* c, const struct iovec* iov, int iovcnt, std::shared_ptr<void> holder);
+    /// @note internal usage, see Poller::TakeSent
+    bool TakeSent(Channel* c, ssize_t* result);
+
     /**
      * Runs callback at 'when'
      * Safe to call from other threads
     */
-    TimerId_t RunAt(const TimePoint_t& when, const TimeoutCb_t& cb);
+    TimerId_t RunAt(const TimePoint_t& when, TimeoutCb_t cb);
+
+    /**
+     * Runs callback in [when, when + slack], the timers whose windows overlap fire in one wakeup,
+     * and the timerfd isn't reprogrammed for a timer whose window covers the armed time.
+     * The overloads without slack use EventLoopOptions::timerSlack
+     * Safe to call from other threads
+    */
+    TimerId_t RunAt(const TimePoint_t& when, TimeoutCb_t cb, const Interval_t& slack);
 
     /**
      * Runs callback after delay which the given time
      * Safe to call from other threads
     */
-    TimerId_t RunAfter(const Interval_t& delay, const TimeoutCb_t& cb);
+    TimerId_t RunAfter(const Interval_t& delay, TimeoutCb_t cb);
+    TimerId_t RunAfter(const Interval_t& delay, TimeoutCb_t cb, const Interval_t& slack);
 
     /**
      * Runs callback every 'interval' which the given time
      * Safe to call from other threads
     */
-    TimerId_t RunEvery(const Interval_t& interval, const TimeoutCb_t& cb);
+    TimerId_t RunEvery(const Interval_t& interval, TimeoutCb_t cb);
+    TimerId_t RunEvery(const Interval_t& interval, TimeoutCb_t cb, const Interval_t& slack);
 
     /**
      * Safe to call from other threads.
@@ -103,9 +139,11 @@ public:
     /**
      * Enqueueing cb in the loop thread
      * Runs after finish pooling
+     * The high-priority callbacks run before the normal ones which are still pending,
+     * and the callbacks of the same priority run in FIFO order
      * Safe to call from other threads
     */
-    void EnqueueEventLoop(const PendingEventCb_t& cb);
+    void EnqueueEventLoop(PendingEventCb_t cb, CallbackPriority priority = CallbackPriority::kNormal);
 
     /**
      * Runs callback immediately in the loop thread
@@ -113,7 +151,52 @@ public:
      * If in the same loop thread, cb is run within the function.
      * Safe to call from other threads.
     */
-    void RunInEventLoop(const PendingEventCb_t& cb);
+    void RunInEventLoop(PendingEventCb_t cb, CallbackPriority priority = CallbackPriority::kNormal);
+
+    /// Number of callbacks enqueued by EnqueueEventLoop
+    /// @note Safe to call from other threads
+    uint64_t GetEnqueuedCallbacks() const
+    { return enqueuedCbs_.load(std::memory_order_relaxed); }
+
+    /// Number of enqueues which skipped waking up the loop since a wakeup was already pending,
+    /// OR the loop was spinning in busy-poll mode
+    /// @note Safe to call from other threads
+    uint64_t GetCoalescedWakeups() const
+    { return coalescedWakeups_.load(std::memory_order_relaxed); }
+
+    /// Number of iterations which left normal-priority callbacks for the next one,
+    /// see EventLoopOptions::maxPendingCallbacks
+    /// @note Safe to call from other threads
+    uint64_t GetCarriedOverIterations() const
+    { return carriedOverIterations_.load(std::memory_order_relaxed); }
+
+    /// @brief SO_BUSY_POLL of the connections served by this loop, 0 if unset, see EventLoopOptions::socketBusyPoll
+    int GetSocketBusyPoll() const
+    { return socketBusyPoll_; }
+
+    /// @brief Load counters of the connections of this loop
+    /// @note Readable in any thread
+    LoopLoad& GetLoad()
+    { return load_; }
+    const LoopLoad& GetLoad() const
+    { return load_; }
+
+    /// @brief Scratch space shared by all connections of this loop, receives the bytes
+    /// which don't fit in the input buffer of a connection during one read
+    /// @note Must be used in the loop thread, and the content is only valid until the next read
+    char* GetSpillBuffer() {
+        if (!spillBuffer_) {
+            spillBuffer_.reset(new char[kSpillBufferSize]); // no zero-filling
+        }
+        return spillBuffer_.get();
+    }
+    static const size_t kSpillBufferSize = 64 * 1024;
+
+    /// @brief Blocks for the storage of the connections of this loop, see Buffer::Buffer(BufferBlockPool*, size_t)
+    /// @note Allocates in the loop thread only, frees in any thread
+    BufferBlockPool* GetBufferBlockPool() {
+        return bufferBlockPool_.get();
+    }
      
 #ifdef MUDUO_USE_MEMPOOL
     base::MemoryPool* GetMemoryPool() {
@@ -137,7 +220,11 @@ private:
     */
     void PrintActiveChannels() const;
     void HandleActiveChannels();
-    void HandlePendingCallbacks();
+    /// @return whether any callback was handled
+    bool HandlePendingCallbacks();
+    /// @brief Zero while spinning in busy-poll mode OR callbacks were carried over, otherwise kPollTimeout
+    TimeoutDuration_t NextPollTimeout();
+    void Enqueue(base::MpscQueue* queue, PendingEventCb_t cb);
 
 private:
 #ifdef MUDUO_USE_MEMPOOL
@@ -149,14 +236,31 @@ private:
     bool eventHandling_;
     std::unique_ptr<Poller> poller_;    // 组合
     std::unique_ptr<TimerQueue> timerQueue_;
+    const Interval_t timerSlack_;   // default slack of timers
+    const std::chrono::microseconds busyPollBudget_;
+    const int socketBusyPoll_;
+    bool spinning_;     // polling with zero timeout, the producers skip the eventfd meanwhile
+    std::chrono::steady_clock::time_point lastWork_;    // when the loop handled an event OR a callback last time
+    const size_t maxPendingCbs_;    // per iteration, 0 if unlimited
+    const std::chrono::microseconds pendingCbsBudget_;  // per iteration, 0 if unlimited
+    bool carriedOver_;  // normal-priority callbacks were left by the last iteration
+    std::atomic<uint64_t> carriedOverIterations_;
     ReceiveTimePoint_t receiveTimePoint_;
     ChannelList activeChannels_;
+    std::unique_ptr<char[]> spillBuffer_ {nullptr};  // allocated on first use
+    std::unique_ptr<BufferBlockPool> bufferBlockPool_;
+    alignas(64) LoopLoad load_;     // read by the accepting thread, off the lines of the fields above
 
     /* cross-threads wait/notify helper */
     std::unique_ptr<Bridge> bridge_;
-    std::mutex mtx_;    // for sync EventLoop::pendingCbsQueue_
-    PendingCallbacksQueue pendingCbsQueue_;
+    base::MpscQueue pendingCbsQueue_;   // lock-free, EnqueueEventLoop never blocks
+    base::MpscQueue urgentCbsQueue_;    // of CallbackPriority::kHigh
     std::atomic_bool callingPendingCbs_;
+    /* written by producers together, share one cache line */
+    alignas(64) std::atomic_bool wakeupPending_;    // whether the bridge was waked up but pending callbacks are not handled yet
+    std::atomic<uint64_t> enqueuedCbs_;
+    std::atomic<uint64_t> coalescedWakeups_;
+    alignas(64) std::atomic<base::MpscNode*> recycledNodes_;    // consumed nodes for reusing by producers
 };
 
 } // namespace muduo 
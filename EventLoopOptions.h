@@ -0,0 +1,40 @@
+#if !defined(MUDUO_EVENTLOOP_OPTIONS_H)
+#define MUDUO_EVENTLOOP_OPTIONS_H
+
+#include <muduo/base/allocator/mem_pool.h>
+#include <muduo/TimerType.h>
+#include <chrono>
+#include <cstddef>
+
+namespace muduo {
+
+/// @brief Per-loop settings, fixed when the EventLoop is constructed
+/// @see EventLoop::EventLoop(const EventLoopOptions&), EventLoopThreadPool::SetLoopOptions
+struct EventLoopOptions {
+    TimerBackend timerBackend {TimerBackend::kDefault};
+    /// slack of the timers added without specifying it, see EventLoop::RunAt
+    detail::Interval_t timerSlack {0};
+    /// busy-poll mode: after the last event or callback, the loop spins with zero-timeout polls for this long
+    /// before blocking in the poller, and the cross-thread callbacks enqueued meanwhile are picked up by the spin
+    /// without writing the eventfd. It trades a CPU per spinning loop for the wakeup latency, 0(by default) disables it
+    std::chrono::microseconds busyPollBudget {0};
+    /// SO_BUSY_POLL(in microseconds) of the connections served by the loop, so the kernel polls the device queue
+    /// instead of waiting for the interrupt on reading, 0(by default) leaves it unset.
+    /// Raising it above net.core.busy_read requires CAP_NET_ADMIN
+    int socketBusyPoll {0};
+    /// at most so many normal-priority pending callbacks are run per iteration, the rest are carried over
+    /// to the next one, which polls without blocking, so a burst of callbacks can not delay the IO events
+    /// for long. The high-priority ones are not counted. 0(by default) means unlimited
+    size_t maxPendingCallbacks {0};
+    /// time budget of the normal-priority pending callbacks per iteration, as maxPendingCallbacks.
+    /// Checked every few callbacks, so a single long callback overruns it. 0(by default) means unlimited
+    std::chrono::microseconds pendingCallbacksBudget {0};
+#ifdef MUDUO_USE_MEMPOOL
+    /// size classes and memory return policy of the loop-level memory pool
+    base::MemoryPoolOptions memPool {};
+#endif
+};
+
+} // namespace muduo
+
+#endif // MUDUO_EVENTLOOP_OPTIONS_H
@@ -1,12 +1,18 @@
 #include <muduo/EventLoop.h>
 #include <muduo/EventLoopThread.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 using namespace muduo;
 
-EventLoopThread::EventLoopThread(const IoThreadInitCallback_t& cb, const std::string& n)
+EventLoopThread::EventLoopThread(const IoThreadInitCallback_t& cb, const std::string& n, const EventLoopOptions& options)
     : loop_(nullptr)
     , name_(n)
     , initCb_(cb)
+    , options_(options)
     , IoThread_(nullptr)
     , isExit_(false)
     , mtx_()
@@ -16,7 +22,10 @@ EventLoopThread::EventLoopThread(const IoThreadInitCallback_t& cb, const std::st
 EventLoopThread::~EventLoopThread() noexcept {
     isExit_ = true;
     if (loop_ != nullptr) {
-        loop_->Quit();  // 通知loop结束循环
+        // 通知loop结束循环, quits inside the loop, since EventLoop::Loop resets the quit flag,
+        // a Quit before the thread entered Loop would be lost
+        EventLoop* loop = loop_;
+        loop_->RunInEventLoop([loop]() { loop->Quit(); });
         assert(IoThread_->joinable());
         IoThread_->join();
     }
@@ -42,7 +51,10 @@ EventLoop* EventLoopThread::Run() {
 }
 
 void EventLoopThread::ThreadFunc() {
-    EventLoop loop; // create a EventLoop on stack
+    // placed before the loop is constructed, so that the loop, its memory pool and
+    // the buffers of its connections are first touched on the node of the thread
+    PlaceThread();
+    EventLoop loop(options_); // create a EventLoop on stack
 
     if (initCb_.operator bool()) {
         initCb_(&loop);
@@ -63,4 +75,22 @@ void EventLoopThread::ThreadFunc() {
 
     std::lock_guard<std::mutex> guard(mtx_);
     loop_ = nullptr;
-}
\ No newline at end of file
+}
+
+void EventLoopThread::PlaceThread() {
+    if (cpu_ >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu_, &cpus);
+        int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof cpus, &cpus);
+        if (ret != 0) {
+            LOG_ERROR << "EventLoopThread[" << name_ << "] failed to pin to cpu " << cpu_
+                << ", detail: " << strerror_thread_safe(ret);
+        }
+    }
+    if (numaLocalMemory_) {
+        if (::syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) != 0) {
+            LOG_SYSERR << "EventLoopThread[" << name_ << "] set_mempolicy(MPOL_LOCAL)";
+        }
+    }
+}
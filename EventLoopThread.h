@@ -2,6 +2,7 @@
 #define MUDUO_EVENTLOOP_THREAD_H
 #include <muduo/base/allocator/Allocatable.h>
 #include <muduo/Callbacks.h>
+#include <muduo/EventLoopOptions.h>
 #include <mutex>
 #include <memory>
 #include <atomic>
@@ -19,19 +20,36 @@ class EventLoopThread {
     EventLoopThread(const EventLoopThread&) = delete;
     EventLoopThread operator=(const EventLoopThread&) = delete;
 public:
-    EventLoopThread(const IoThreadInitCallback_t& cb = nullptr, const std::string& name = std::string());
+    EventLoopThread(const IoThreadInitCallback_t& cb = nullptr, const std::string& name = std::string(),
+                    const EventLoopOptions& options = EventLoopOptions());
     ~EventLoopThread() noexcept;
 
     /* @note Only Can be called once */
     EventLoop* Run();
 
+    /// @brief Pins the thread to cpu before its loop is constructed, -1(by default) leaves it floating
+    /// @note must be called before Run
+    void SetCpu(int cpu)
+    { cpu_ = cpu; }
+
+    /// @brief Allocates the memory of the thread from the NUMA node it runs on(MPOL_LOCAL),
+    /// even if the process policy interleaves or binds elsewhere
+    /// @note must be called before Run
+    void SetNumaLocalMemory(bool on)
+    { numaLocalMemory_ = on; }
+
 private:
     void ThreadFunc();
+    /// @brief Applies the CPU and memory placement to the calling thread
+    void PlaceThread();
 
 private:
     EventLoop* loop_;   // EventLoop instance of IO-thread
     std::string name_;
     IoThreadInitCallback_t initCb_;
+    EventLoopOptions options_;
+    int cpu_ {-1};
+    bool numaLocalMemory_ {false};
     std::unique_ptr<std::thread> IoThread_;              // current IO-thread
     bool isExit_;                       // The state dictates whether IO thread exits 
     /* for sync operations on loop_ */
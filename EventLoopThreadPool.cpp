@@ -11,9 +11,13 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop* base_loop, const std::string
 #ifdef MUDUO_USE_MEMPOOL
     , threadPool_(baseLoop_->GetMemoryPool())
     , loops_(baseLoop_->GetMemoryPool())
+    , cpus_(baseLoop_->GetMemoryPool())
+    , cpuLoops_(baseLoop_->GetMemoryPool())
 #else
     , threadPool_()
     , loops_()
+    , cpus_()
+    , cpuLoops_()
 #endif
     { assert(baseLoop_ != nullptr); }
 
@@ -27,11 +31,23 @@ void EventLoopThreadPool::BuildAndRun() {
     for (size_t i = 0; i < poolSize_; i++) {
         std::string cur_trd_name = name_+":"+std::to_string(i);
 #ifdef MUDUO_USE_MEMPOOL
-        threadPool_.emplace_back(new (baseLoop_->GetMemoryPool()) EventLoopThread(initCb_, cur_trd_name));
+        threadPool_.emplace_back(new (baseLoop_->GetMemoryPool()) EventLoopThread(initCb_, cur_trd_name, options_));
 #else
-        threadPool_.emplace_back(std::make_unique<EventLoopThread>(initCb_, cur_trd_name));
+        threadPool_.emplace_back(std::make_unique<EventLoopThread>(initCb_, cur_trd_name, options_));
 #endif
+        threadPool_[i]->SetCpu(GetLoopCpu(i));
+        threadPool_[i]->SetNumaLocalMemory(numaLocalMemory_);
         loops_.push_back(threadPool_[i]->Run());
+
+        const int cpu = GetLoopCpu(i);
+        if (cpu >= 0) {
+            if (static_cast<size_t>(cpu) >= cpuLoops_.size()) {
+                cpuLoops_.resize(cpu + 1, -1);
+            }
+            if (cpuLoops_[cpu] < 0) {
+                cpuLoops_[cpu] = static_cast<int>(i);
+            }
+        }
     }
     assert(loops_.size() == poolSize_);
     started_ = true;
@@ -45,15 +61,86 @@ EventLoop* EventLoopThreadPool::GetNextLoop() const {
     baseLoop_->AssertInLoopThread();
     assert(started_);
     
-    EventLoop* result = baseLoop_;
-    if (!loops_.empty()) {
-        // round-robin
-        assert(nextLoopIdx_ < poolSize_);
-        result = loops_[nextLoopIdx_];
-        nextLoopIdx_ += 1;
-        if (nextLoopIdx_ >= loops_.size()) {
-            nextLoopIdx_ = 0;
+    if (loops_.empty()) {
+        return baseLoop_;
+    }
+    switch (selection_) {
+    case LoopSelection::kLeastConnections:
+        return LeastLoadedLoop(&LoopLoad::Connections);
+    case LoopSelection::kLeastPendingBytes:
+        return LeastLoadedLoop(&LoopLoad::PendingOutputBytes);
+    default:
+        return NextLoopInTurn();
+    }
+}
+
+EventLoop* EventLoopThreadPool::GetNextLoop(size_t hint) const {
+    if (loops_.empty()) {
+        return GetNextLoop();
+    }
+    switch (selection_) {
+    case LoopSelection::kHashHint:
+        baseLoop_->AssertInLoopThread();
+        assert(started_);
+        return loops_[hint % loops_.size()];
+    case LoopSelection::kIncomingCpu:
+        // the CPUs without a pinned loop are served in turn
+        if (hint < cpuLoops_.size() && cpuLoops_[hint] >= 0) {
+            baseLoop_->AssertInLoopThread();
+            assert(started_);
+            return loops_[cpuLoops_[hint]];
         }
+        return GetNextLoop();
+    default:
+        return GetNextLoop();
+    }
+}
+
+EventLoop* EventLoopThreadPool::NextLoopInTurn() const {
+    // round-robin
+    assert(nextLoopIdx_ < poolSize_);
+    EventLoop* result = loops_[nextLoopIdx_];
+    nextLoopIdx_ += 1;
+    if (nextLoopIdx_ >= loops_.size()) {
+        nextLoopIdx_ = 0;
     }
     return result;
-}
\ No newline at end of file
+}
+
+EventLoop* EventLoopThreadPool::LeastLoadedLoop(size_t (LoopLoad::*metric)() const) const {
+    // scans from the loop in turn, so the equally loaded loops are picked in turn
+    const size_t n = loops_.size();
+    size_t best = nextLoopIdx_;
+    size_t best_load = (loops_[best]->GetLoad().*metric)();
+    for (size_t i = 1; i < n && best_load > 0; i++) {
+        const size_t idx = (nextLoopIdx_ + i) % n;
+        const size_t load = (loops_[idx]->GetLoad().*metric)();
+        if (load < best_load) {
+            best = idx;
+            best_load = load;
+        }
+    }
+    nextLoopIdx_ = best + 1 == n ? 0 : best + 1;
+    return loops_[best];
+}
+
+std::vector<EventLoop*> EventLoopThreadPool::GetAllLoops() const {
+    baseLoop_->AssertInLoopThread();
+    assert(started_);
+    if (loops_.empty()) {
+        return std::vector<EventLoop*>(1, baseLoop_);
+    }
+    return std::vector<EventLoop*>(loops_.begin(), loops_.end());
+}
+
+#ifdef MUDUO_USE_MEMPOOL
+base::MemoryPoolStats EventLoopThreadPool::GetMemoryPoolStats() const {
+    base::MemoryPoolStats result = baseLoop_->GetMemoryPool()->stats();
+    if (started_) {
+        for (EventLoop* loop : loops_) {
+            result += loop->GetMemoryPool()->stats();
+        }
+    }
+    return result;
+}
+#endif
@@ -4,6 +4,7 @@
 #include <muduo/base/allocator/Allocatable.h>
 #include <muduo/base/allocator/sgi_stl_alloc.h>
 #include <muduo/Callbacks.h>
+#include <muduo/EventLoopOptions.h>
 #include <string>
 #include <memory>
 #include <vector>
@@ -11,6 +12,16 @@
 
 namespace muduo {
 class EventLoopThread;  // forward declaration
+class LoopLoad;        // forward declaration
+
+/// @brief How EventLoopThreadPool::GetNextLoop picks an IO-loop, see LoopLoad
+enum class LoopSelection {
+    kRoundRobin,        // in turn, regardless of the load
+    kLeastConnections,  // the loop serving the fewest connections
+    kLeastPendingBytes, // the loop with the fewest bytes queued for output
+    kHashHint,          // the loop at (hint % loops), e.g. hash of the remote address for cache affinity
+    kIncomingCpu,       // the loop pinned to the CPU of hint, e.g. SO_INCOMING_CPU of the connection, see SetThreadCpus
+};
 
 #ifdef MUDUO_USE_MEMPOOL
 class EventLoopThreadPool : public base::detail::Allocatable {
@@ -32,6 +43,33 @@ public:
     void SetThreadInitCallback(const IoThreadInitCallback_t& cb)
     { initCb_ = cb; }
 
+    /* @note: applied to the loops of IO-threads, must be called before BuildAndRun */
+    void SetLoopOptions(const EventLoopOptions& options)
+    { options_ = options; }
+
+    /* @note: round-robin by default */
+    void SetLoopSelection(LoopSelection selection)
+    { selection_ = selection; }
+
+    LoopSelection GetLoopSelection() const
+    { return selection_; }
+
+    /// @brief Pins the IO-thread i to cpus[i % cpus.size()], before its loop is constructed,
+    /// so the loop and its memory pool are first touched on the NUMA node of the CPU.
+    /// The threads float on all CPUs by default
+    /// @note must be called before BuildAndRun
+    void SetThreadCpus(const std::vector<int>& cpus)
+    { cpus_.assign(cpus.begin(), cpus.end()); }
+
+    /// @brief The IO-threads allocate from the NUMA node they run on, see EventLoopThread::SetNumaLocalMemory
+    /// @note must be called before BuildAndRun
+    void SetNumaLocalMemory(bool on)
+    { numaLocalMemory_ = on; }
+
+    /// @return the CPU the IO-thread index is pinned to, -1 if it floats
+    int GetLoopCpu(size_t index) const
+    { return cpus_.empty() ? -1 : cpus_[index % cpus_.size()]; }
+
     bool IsStarted() const
     { return started_; }
 
@@ -39,21 +77,44 @@ public:
     { return name_; }
 
     void BuildAndRun();
+    /// @brief Picks a loop by the selection, kHashHint picks in turn without a hint
     EventLoop* GetNextLoop() const;
+    /// @param hint Picks the loop by it with kHashHint and kIncomingCpu, ignored by the other selections
+    EventLoop* GetNextLoop(size_t hint) const;
+    /// @return the loops of IO-threads, or only the base loop if the pool size is 0
+    std::vector<EventLoop*> GetAllLoops() const;
+
+#ifdef MUDUO_USE_MEMPOOL
+    /// @brief Sums up the statistics of the memory pools of the base loop and all the IO loops
+    /// @note Thread-safe, see base::MemoryPool::stats()
+    base::MemoryPoolStats GetMemoryPoolStats() const;
+#endif
+
+private:
+    EventLoop* NextLoopInTurn() const;
+    /// @brief The least loaded loop by metric, the ties are broken in turn
+    EventLoop* LeastLoadedLoop(size_t (LoopLoad::*metric)() const) const;
 
 private:
     EventLoop* const baseLoop_;
     std::string name_;
     IoThreadInitCallback_t initCb_ {nullptr};
+    EventLoopOptions options_ {};
     std::size_t poolSize_ {0};
+    LoopSelection selection_ {LoopSelection::kRoundRobin};
+    bool numaLocalMemory_ {false};
     mutable std::size_t nextLoopIdx_ {0};
     std::atomic_bool started_ {false};
 #ifdef MUDUO_USE_MEMPOOL
     std::vector<std::unique_ptr<EventLoopThread>, base::allocator<std::unique_ptr<EventLoopThread>>> threadPool_;
     std::vector<EventLoop*, base::allocator<EventLoop*>> loops_;
+    std::vector<int, base::allocator<int>> cpus_;
+    std::vector<int, base::allocator<int>> cpuLoops_;  // the index of loop pinned to each CPU, -1 if none
 #else
     std::vector<std::unique_ptr<EventLoopThread>> threadPool_;
     std::vector<EventLoop*> loops_;
+    std::vector<int> cpus_;
+    std::vector<int> cpuLoops_;     // the index of loop pinned to each CPU, -1 if none
 #endif
 };
 
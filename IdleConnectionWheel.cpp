@@ -0,0 +1,98 @@
+#include <muduo/IdleConnectionWheel.h>
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/base/Logging.h>
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+const size_t IdleConnectionWheel::kBuckets;
+const size_t IdleConnectionWheel::kSlots;
+
+std::shared_ptr<IdleConnectionWheel> IdleConnectionWheel::Create(EventLoop* loop, const Interval_t& timeout) {
+    auto wheel = std::make_shared<IdleConnectionWheel>(loop, timeout);
+    const Interval_t tick = std::max(timeout / static_cast<int>(kBuckets), Interval_t(1));
+    // the timer doesn't extend the lifetime of wheel, the connections and the TcpServer own it
+    std::weak_ptr<IdleConnectionWheel> weak_wheel(wheel);
+    wheel->timerId_ = loop->RunEvery(tick, [weak_wheel]() {
+        if (auto w = weak_wheel.lock()) {
+            w->HandleTick();
+        }
+    });
+    return wheel;
+}
+
+IdleConnectionWheel::IdleConnectionWheel(EventLoop* loop, const Interval_t& timeout)
+    : loop_(loop)
+    , timeout_(timeout)
+    , timerId_(0)
+    , current_(0)
+    , size_(0)
+    , slots_()
+{ }
+
+void IdleConnectionWheel::Stop() {
+    loop_->cancelTimer(timerId_);
+}
+
+void IdleConnectionWheel::Link(TcpConnection* conn, size_t slot) {
+    TcpConnection*& head = slots_[slot];
+    conn->idlePrev_ = nullptr;
+    conn->idleNext_ = head;
+    conn->idleSlot_ = &head;
+    if (head != nullptr) {
+        head->idlePrev_ = conn;
+    }
+    head = conn;
+}
+
+void IdleConnectionWheel::Unlink(TcpConnection* conn) {
+    if (conn->idlePrev_ != nullptr) {
+        conn->idlePrev_->idleNext_ = conn->idleNext_;
+    } else {
+        *conn->idleSlot_ = conn->idleNext_;
+    }
+    if (conn->idleNext_ != nullptr) {
+        conn->idleNext_->idlePrev_ = conn->idlePrev_;
+    }
+    conn->idlePrev_ = conn->idleNext_ = nullptr;
+    conn->idleSlot_ = nullptr;
+}
+
+void IdleConnectionWheel::Add(TcpConnection* conn) {
+    loop_->AssertInLoopThread();
+    assert(conn->idleSlot_ == nullptr);
+    conn->lastActiveTick_ = current_;
+    Link(conn, (current_ + kBuckets + 1) % kSlots);
+    size_ += 1;
+}
+
+void IdleConnectionWheel::Remove(TcpConnection* conn) {
+    loop_->AssertInLoopThread();
+    if (conn->idleSlot_ != nullptr) {
+        Unlink(conn);
+        size_ -= 1;
+    }
+}
+
+void IdleConnectionWheel::HandleTick() {
+    loop_->AssertInLoopThread();
+    current_ += 1;
+    TcpConnection*& head = slots_[current_ % kSlots];
+    // pops one by one, closing a connection could close others of the same bucket in callbacks
+    while (head != nullptr) {
+        TcpConnection* conn = head;
+        Unlink(conn);
+        // the activity tick was recorded during the tick in progress,
+        // so the connection has been idle for more than kBuckets ticks after kBuckets + 1 ticks
+        if (current_ - conn->lastActiveTick_ > kBuckets) {
+            size_ -= 1;
+            LOG_INFO << "TcpConnection[" << conn->GetName() << "] has been idle for more than "
+                << timeout_.count() << "ms, close it";
+            conn->HandleClose();
+        } else {
+            Link(conn, (conn->lastActiveTick_ + kBuckets + 1) % kSlots);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#if !defined(MUDUO_IDLE_CONNECTION_WHEEL_H)
+#define MUDUO_IDLE_CONNECTION_WHEEL_H
+
+#include <muduo/TimerType.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace muduo {
+
+class EventLoop;        // forward declaration
+class TcpConnection;    // forward declaration
+
+namespace detail {
+
+/**
+ * Evicts the connections of a loop which have been idle longer than the timeout.
+ *
+ * The timeout is divided into kBuckets ticks, a single repeating timer of the loop advances the wheel.
+ * A connection only records the current tick on activity, so tracking costs no timer and no relinking per event.
+ * When the wheel reaches the bucket of a connection, it is closed if it's idle for more than the timeout,
+ * otherwise it's moved to the bucket of its new deadline, i.e. at most once per timeout period.
+ * A connection is closed at most one tick after its timeout, never before.
+ *
+ * All methods except Create and Stop must be called in the loop thread.
+*/
+class IdleConnectionWheel {
+    /// non-copyable & non-moveable
+    IdleConnectionWheel(const IdleConnectionWheel&) = delete;
+    IdleConnectionWheel& operator=(const IdleConnectionWheel&) = delete;
+
+public:
+    static const size_t kBuckets = 8;
+
+    /// @brief Creates the wheel and starts ticking in loop
+    static std::shared_ptr<IdleConnectionWheel> Create(EventLoop* loop, const Interval_t& timeout);
+
+    IdleConnectionWheel(EventLoop* loop, const Interval_t& timeout);
+    ~IdleConnectionWheel() noexcept = default;
+
+    /// @brief Stops ticking, the tracked connections are never evicted after it
+    /// Safe to call from other threads
+    void Stop();
+
+    uint64_t CurrentTick() const { return current_; }
+    size_t Size() const { return size_; }
+
+    void Add(TcpConnection* conn);
+    void Remove(TcpConnection* conn);
+
+private:
+    /* one more bucket for the tick in progress, and one for the rounding of the activity tick */
+    static const size_t kSlots = kBuckets + 2;
+
+    void HandleTick();
+    void Link(TcpConnection* conn, size_t slot);
+    void Unlink(TcpConnection* conn);
+
+private:
+    EventLoop* const loop_;
+    const Interval_t timeout_;
+    TimerId_t timerId_;
+    uint64_t current_;
+    size_t size_;
+    TcpConnection* slots_[kSlots];
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_IDLE_CONNECTION_WHEEL_H
@@ -60,8 +60,30 @@ std::string InetAddr::GetIpPort() const {
     return std::string(buf);
 }
 
+uint16_t muduo::InetAddr::GetPort() const {
+    // sin_port and sin6_port are at the same offset
+    return base::endian::BigToNative(addr_.inet4.sin_port);
+}
+
 std::string muduo::InetAddr::GetIp() const {
     char buf[64];   // adequate
     sockets::toIp(buf, sizeof buf, sockets::sockaddr_cast(&addr_.operator const sockaddr_in6 &()));
     return std::string(buf);
 }
+
+size_t muduo::InetAddr::GetIpHash() const {
+    const unsigned char* bytes = nullptr;
+    size_t len = 0;
+    if (GetAddressFamily() == AF_INET6) {
+        bytes = addr_.inet6.sin6_addr.s6_addr;
+        len = sizeof addr_.inet6.sin6_addr;
+    } else {
+        bytes = reinterpret_cast<const unsigned char*>(&addr_.inet4.sin_addr);
+        len = sizeof addr_.inet4.sin_addr;
+    }
+    uint64_t hash = 14695981039346656037ull;    // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
@@ -71,6 +71,10 @@ public:
 
     std::string GetIpPort() const;
     std::string GetIp() const;
+    /// @brief Port in host byte order
+    uint16_t GetPort() const;
+    /// @brief Hash of the IP(without the port), the same host hashes to the same value
+    size_t GetIpHash() const;
 
 private:
     SockAddr addr_;
@@ -0,0 +1,64 @@
+#if !defined(MUDUO_LOOP_LOAD_H)
+#define MUDUO_LOOP_LOAD_H
+
+#include <muduo/base/allocator/stat_counter.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace muduo {
+
+/**
+ * Cheap load counters of an EventLoop, which EventLoopThreadPool selects the loop of a new connection by,
+ * and TcpServer rebalances the connections by.
+ * Readable in any thread without locking, the values may be slightly stale.
+ * @see EventLoop::GetLoad, EventLoopThreadPool::SetLoopSelection, TcpServer::SetRebalanceInterval
+*/
+class LoopLoad {
+    // non-copyable & non-moveable
+    LoopLoad(const LoopLoad&) = delete;
+    LoopLoad& operator=(const LoopLoad&) = delete;
+
+public:
+    LoopLoad() = default;
+
+    /// @brief The connections served by the loop, counted from construction to TcpConnection::StepIntoDestroyed
+    size_t Connections() const
+    { return connections_.load(std::memory_order_relaxed); }
+
+    /// @brief The bytes queued in the output queues of the connections of the loop
+    size_t PendingOutputBytes() const
+    { return pendingOutputBytes_.get(); }
+
+    /// @brief The time the loop spent out of polling(handling events, timers and pending callbacks) since it started,
+    /// the busy share of a period is the difference of two samples divided by the period
+    std::chrono::nanoseconds BusyTime() const
+    { return std::chrono::nanoseconds(busyNanos_.get()); }
+
+    /// @note internal usage, the connections are constructed in the accepting thread, so it's atomic
+    void AddConnection()
+    { connections_.fetch_add(1, std::memory_order_relaxed); }
+    /// @note internal usage
+    void RemoveConnection()
+    { connections_.fetch_sub(1, std::memory_order_relaxed); }
+
+    /// @note internal usage, in the loop thread only
+    void AddPendingOutputBytes(size_t n)
+    { pendingOutputBytes_.add(n); }
+    /// @note internal usage, in the loop thread only
+    void SubPendingOutputBytes(size_t n)
+    { pendingOutputBytes_.sub(n); }
+
+    /// @note internal usage, in the loop thread only
+    void AddBusyTime(std::chrono::nanoseconds busy)
+    { busyNanos_.add(static_cast<size_t>(busy.count())); }
+
+private:
+    std::atomic<size_t> connections_ {0};
+    base::detail::stat_counter pendingOutputBytes_;
+    base::detail::stat_counter busyNanos_;
+};
+
+} // namespace muduo
+
+#endif // MUDUO_LOOP_LOAD_H
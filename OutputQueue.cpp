@@ -0,0 +1,296 @@
+#include <muduo/OutputQueue.h>
+#include <muduo/base/SocketOps.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+using namespace muduo;
+
+const size_t OutputQueue::kChunkSize;
+
+OutputQueue::OutputQueue(BufferBlockPool* pool)
+    : segments_()
+    , readableBytes_(0)
+    , pool_(pool)
+    , spareChunk_(nullptr)
+    , zeroCopyThreshold_(0)
+    , nextZeroCopyId_(0)
+    , zeroCopyPending_()
+    , zeroCopyCopied_(0)
+{ }
+
+OutputQueue::~OutputQueue() noexcept {
+    for (Segment& seg : segments_) {
+        ReleaseSegment(&seg);
+    }
+    delete[] spareChunk_;
+}
+
+char* OutputQueue::AllocateChunk() {
+    if (pool_ != nullptr) {
+        return pool_->Allocate(kChunkSize);
+    }
+    if (spareChunk_ != nullptr) {
+        char* chunk = spareChunk_;
+        spareChunk_ = nullptr;
+        return chunk;
+    }
+    return new char[kChunkSize];    // default-initialized, no zero-filling
+}
+
+void OutputQueue::ReleaseChunk(char* chunk) {
+    if (pool_ != nullptr) {
+        pool_->Free(chunk, kChunkSize);     // a drained connection holds no chunk
+    } else if (spareChunk_ == nullptr) {
+        spareChunk_ = chunk;
+    } else {
+        delete[] chunk;
+    }
+}
+
+void OutputQueue::RebindPool(BufferBlockPool* pool) {
+    if (pool == pool_) {
+        return;
+    }
+    for (Segment& seg : segments_) {
+        if (seg.chunk == nullptr) {
+            continue;
+        }
+        char* chunk = (pool != nullptr) ? pool->Allocate(kChunkSize) : new char[kChunkSize];
+        std::memcpy(chunk, seg.data, seg.size);     // only the unsent bytes, so the back has more room
+        ReleaseChunk(seg.chunk);    // to the old pool
+        seg.chunk = chunk;
+        seg.data = chunk;
+    }
+    pool_ = pool;
+    if (pool_ != nullptr) {
+        delete[] spareChunk_;
+        spareChunk_ = nullptr;
+    }
+}
+
+size_t OutputQueue::BackWritableBytes() const {
+    if (segments_.empty() || segments_.back().chunk == nullptr) { // slice, file OR pipe
+        return 0;
+    }
+    const Segment& back = segments_.back();
+    const char* end = back.data + back.size;
+    return kChunkSize - static_cast<size_t>(end - back.chunk);
+}
+
+void OutputQueue::Append(const char* data, size_t len) {
+    readableBytes_ += len;
+    while (len > 0) {
+        size_t writable = BackWritableBytes();
+        if (writable == 0) {
+            char* chunk = AllocateChunk();
+            segments_.push_back(Segment {kMemory, chunk, 0, chunk, nullptr, -1, 0, nullptr});
+            writable = kChunkSize;
+        }
+        Segment& back = segments_.back();
+        const size_t n = std::min(writable, len);
+        ::memcpy(const_cast<char*>(back.data) + back.size, data, n);
+        back.size += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void OutputQueue::AppendSlice(std::shared_ptr<const void> holder, const char* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    readableBytes_ += len;
+    segments_.push_back(Segment {kMemory, data, len, nullptr, std::move(holder), -1, 0, nullptr});
+}
+
+void OutputQueue::AppendFile(int fd, off_t offset, size_t len) {
+    if (len == 0) {
+        ::close(fd);
+        return;
+    }
+    readableBytes_ += len;
+    segments_.push_back(Segment {kFile, nullptr, len, nullptr, nullptr, fd, offset, nullptr});
+}
+
+void OutputQueue::AppendPipe(const std::shared_ptr<SplicePipe>& pipe, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    readableBytes_ += len;
+    if (!segments_.empty() && segments_.back().kind == kPipe && segments_.back().pipe == pipe) {
+        segments_.back().size += len;   // bytes in the same pipe are contiguous
+        return;
+    }
+    segments_.push_back(Segment {kPipe, nullptr, len, nullptr, nullptr, -1, 0, pipe});
+}
+
+void OutputQueue::ReleaseSegment(Segment* seg) {
+    switch (seg->kind) {
+    case kMemory:
+        if (seg->chunk != nullptr) {
+            ReleaseChunk(seg->chunk);
+            seg->chunk = nullptr;
+        }
+        break;
+    case kFile:
+        ::close(seg->fileFd);
+        seg->fileFd = -1;
+        break;
+    case kPipe:
+        if (seg->size > 0) {
+            seg->pipe->Discard(seg->size);  // unblocks the writer of pipe
+            seg->size = 0;
+        }
+        break;
+    }
+}
+
+void OutputQueue::Retrieve(size_t len) {
+    assert(len <= readableBytes_);
+    readableBytes_ -= len;
+    while (len > 0) {
+        Segment& front = segments_.front();
+        if (len < front.size) {
+            if (front.kind == kMemory) {
+                front.data += len;
+            } else if (front.kind == kFile) {
+                front.offset += static_cast<off_t>(len);
+            }
+            front.size -= len;
+            break;
+        }
+        len -= front.size;
+        front.size = 0;     // all bytes were sent
+        ReleaseSegment(&front);
+        segments_.pop_front();
+    }
+}
+
+ssize_t OutputQueue::WriteFd(int fd, size_t max_bytes, int* savedErrno) {
+    if (segments_.empty() || max_bytes == 0) {
+        return 0;
+    }
+    Segment& front = segments_.front();
+    ssize_t n = 0;
+    switch (front.kind) {
+    case kMemory:
+        if (IsZeroCopyCandidate(front)) {
+            return WriteZeroCopy(fd, max_bytes, savedErrno);
+        }
+        return WriteMemory(fd, max_bytes, savedErrno);
+    case kFile: {
+        off_t offset = front.offset;    // advanced by Retrieve
+        n = sockets::sendfile(fd, front.fileFd, &offset, std::min(front.size, max_bytes));
+        if (n == 0) {
+            n = -1;
+            errno = ENODATA;    // the file is shorter than the region
+        }
+        break;
+    }
+    case kPipe:
+        n = front.pipe->SpliceTo(fd, std::min(front.size, max_bytes), savedErrno);
+        if (n > 0) {
+            // the pipe already accounted the drained bytes
+            readableBytes_ -= static_cast<size_t>(n);
+            front.size -= static_cast<size_t>(n);
+            if (front.size == 0) {
+                segments_.pop_front();
+            }
+        }
+        return n;
+    }
+
+    if (n < 0) {
+        *savedErrno = errno;
+    } else {
+        Retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+int OutputQueue::PeekMemory(struct iovec* iov, int max_iovcnt, size_t max_bytes) const {
+    int iovcnt = 0;
+    size_t total = 0;
+    for (auto it = segments_.begin(); it != segments_.end() && it->kind == kMemory && iovcnt < max_iovcnt && total < max_bytes; ++it) {
+        if (iovcnt > 0 && IsZeroCopyCandidate(*it)) {
+            break;  // sent by next call
+        }
+        if (it->size == 0) {
+            continue;
+        }
+        const size_t n = std::min(it->size, max_bytes - total);
+        iov[iovcnt].iov_base = const_cast<char*>(it->data);
+        iov[iovcnt].iov_len = n;
+        iovcnt += 1;
+        total += n;
+    }
+    return iovcnt;
+}
+
+ssize_t OutputQueue::WriteMemory(int fd, size_t max_bytes, int* savedErrno) {
+    struct iovec vec[IOV_MAX];
+    const int iovcnt = PeekMemory(vec, IOV_MAX, max_bytes);
+    if (iovcnt == 0) {
+        return 0;
+    }
+
+    const ssize_t n = sockets::writev(fd, vec, iovcnt);
+    if (n < 0) {
+        *savedErrno = errno;
+    } else {
+        Retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+ssize_t OutputQueue::WriteZeroCopy(int fd, size_t max_bytes, int* savedErrno) {
+    Segment& front = segments_.front();
+    const size_t len = std::min(front.size, max_bytes);
+    ssize_t n = sockets::sendZeroCopy(fd, front.data, len);
+    if (n < 0 && errno == ENOBUFS) {
+        n = sockets::write(fd, front.data, len);    // exceeds the optmem limit, fall back to copying
+    } else if (n >= 0) {
+        zeroCopyPending_.push_back(ZeroCopySend {nextZeroCopyId_++, front.holder});
+    }
+    if (n < 0) {
+        *savedErrno = errno;
+    } else {
+        Retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+void OutputQueue::HandOverZeroCopySends(OutputQueue* other) {
+    assert(other->zeroCopyPending_.empty());
+    other->nextZeroCopyId_ = nextZeroCopyId_;
+    for (ZeroCopySend& send : zeroCopyPending_) {
+        other->zeroCopyPending_.push_back(std::move(send));
+    }
+    zeroCopyPending_.clear();
+}
+
+size_t OutputQueue::ReapZeroCopyCompletions(int fd) {
+    size_t completed = 0;
+    uint32_t lo = 0, hi = 0;
+    bool copied = false;
+    while (sockets::recvZeroCopyCompletion(fd, &lo, &hi, &copied)) {
+        const uint32_t count = hi - lo + 1;
+        completed += count;
+        if (copied) {
+            zeroCopyCopied_ += count;
+        }
+        // completions are almost always reported in order, so the range is at front
+        for (auto it = zeroCopyPending_.begin(); it != zeroCopyPending_.end();) {
+            if (it->id - lo < count) {
+                it = zeroCopyPending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return completed;
+}
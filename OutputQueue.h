@@ -0,0 +1,153 @@
+#if !defined(MUDUO_OUTPUT_QUEUE_H)
+#define MUDUO_OUTPUT_QUEUE_H
+
+#include <muduo/SplicePipe.h>
+#include <muduo/BufferBlockPool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <deque>
+
+namespace muduo {
+
+/// @code
+/// +-----------+    +---------------------+    +------------------+    +-----------+
+/// |   chunk   | -> | slice(user-owned)   | -> | file region      | -> |   chunk   |
+/// | (copied)  |    | held by shared_ptr  |    | sent by sendfile |    | (copied)  |
+/// +-----------+    +---------------------+    +------------------+    +-----------+
+///  ^ front: first unsent byte                                          back: appending ^
+/// @endcode
+
+/**
+ * Segmented queue of outgoing bytes, flushed with writev(2).
+ *
+ * Copied bytes are appended into fixed-size chunks, so a large payload never
+ * reallocates or memmoves the queued bytes. User-owned memory is queued as slices
+ * without copying, the holder keeps it alive until the bytes are sent.
+ * A file region is sent by sendfile(2) and bytes in a pipe are moved by splice(2),
+ * both never enter user space, and are interleaved with memory segments in order.
+ * With zero-copy enabled, a large slice is sent with MSG_ZEROCOPY and its holder is kept
+ * until the kernel reports the completion, since the kernel reads the pages asynchronously.
+ * @note Not thread-safe, used in the loop thread of connection.
+*/
+class OutputQueue {
+    /// non-copyable & non-moveable
+    OutputQueue(const OutputQueue&) = delete;
+    OutputQueue& operator=(const OutputQueue&) = delete;
+
+    enum Kind { kMemory, kFile, kPipe };
+
+    struct Segment {
+        Kind kind;
+        const char* data;   // first unsent byte, only for kMemory
+        size_t size;        // unsent bytes
+        char* chunk;        // owned storage of chunk, nullptr represents a slice
+        std::shared_ptr<const void> holder; // keeps the memory of slice alive
+        int fileFd;         // owned file descriptor, only for kFile
+        off_t offset;       // first unsent byte in file, only for kFile
+        std::shared_ptr<SplicePipe> pipe;   // only for kPipe
+    };
+
+public:
+    static const size_t kChunkSize = 16 * 1024;
+
+    /// @param pool draws the chunks from the blocks of pool if given, the queue must be used in its loop thread then
+    explicit OutputQueue(BufferBlockPool* pool = nullptr);
+    ~OutputQueue() noexcept;
+
+    size_t ReadableBytes() const
+    { return readableBytes_; }
+
+    bool Empty() const
+    { return readableBytes_ == 0; }
+
+    /// @brief Copies data into the chunks
+    void Append(const char* data, size_t len);
+    void Append(const void* data, size_t len)
+    { Append(static_cast<const char*>(data), len); }
+
+    /// @brief Queues [data, data+len) without copying
+    /// @param holder owns the memory, released when all bytes of the slice were sent
+    void AppendSlice(std::shared_ptr<const void> holder, const char* data, size_t len);
+
+    /// @brief Queues [offset, offset+len) of file fd, sent by sendfile(2)
+    /// @param fd takes the ownership, closed when the region was sent
+    void AppendFile(int fd, off_t offset, size_t len);
+
+    /// @brief Queues len bytes which were spliced into pipe, moved by splice(2)
+    void AppendPipe(const std::shared_ptr<SplicePipe>& pipe, size_t len);
+
+    /// @brief Sends slices not shorter than threshold with MSG_ZEROCOPY, 0 disables it
+    /// @note SO_ZEROCOPY must be set on the socket
+    void SetZeroCopyThreshold(size_t threshold)
+    { zeroCopyThreshold_ = threshold; }
+
+    /// @brief Reads the zero-copy completions from error queue of fd, and releases the completed slices
+    /// @return number of completed sends
+    size_t ReapZeroCopyCompletions(int fd);
+
+    /// @return number of zero-copy sends whose slices are still held
+    size_t PendingZeroCopySends() const
+    { return zeroCopyPending_.size(); }
+
+    /// @brief Moves the slices of the in-flight zero-copy sends into other, which reaps their completions from now on.
+    /// The destructor releases the slices still held, so they must be handed over before destroying the queue
+    /// while the kernel may still read their pages
+    void HandOverZeroCopySends(OutputQueue* other);
+
+    /// @return number of zero-copy sends which the kernel completed by copying
+    uint64_t ZeroCopyCopiedSends() const
+    { return zeroCopyCopied_; }
+
+    /// @brief Draws the chunks from pool from now on, the queued copied bytes are moved into new chunks of it,
+    /// and the old chunks are returned to their pool. Slices, file regions and pipes are kept as they are
+    /// @note Must be called in the loop thread of the new pool
+    void RebindPool(BufferBlockPool* pool);
+
+    /// @brief Drops len sent bytes from the front
+    void Retrieve(size_t len);
+
+    /// @brief Describes the consecutive memory segments at front(at most max_bytes bytes) with iov, without consuming them,
+    /// e.g. for an asynchronous send, the bytes stay in place until they are retrieved
+    /// @return number of iovecs filled, 0 if the front is a file region OR a pipe
+    int PeekMemory(struct iovec* iov, int max_iovcnt, size_t max_bytes) const;
+
+    /// @brief Writes the front bytes to fd, at most max_bytes bytes.
+    /// Consecutive memory segments are written with one writev(2)(at most IOV_MAX segments),
+    /// a file region with sendfile(2), and bytes in pipe with splice(2)
+    /// @return bytes written, @c errno is saved into savedErrno on failure,
+    ///     ENODATA if the file was truncated before the region was sent
+    ssize_t WriteFd(int fd, size_t max_bytes, int* savedErrno);
+
+private:
+    char* AllocateChunk();
+    void ReleaseChunk(char* chunk);
+    /// @return writable bytes of the back chunk, 0 if the back is a slice OR the queue is empty
+    size_t BackWritableBytes() const;
+    ssize_t WriteMemory(int fd, size_t max_bytes, int* savedErrno);
+    ssize_t WriteZeroCopy(int fd, size_t max_bytes, int* savedErrno);
+    bool IsZeroCopyCandidate(const Segment& seg) const
+    { return zeroCopyThreshold_ > 0 && seg.kind == kMemory && seg.chunk == nullptr && seg.size >= zeroCopyThreshold_; }
+    void ReleaseSegment(Segment* seg);
+
+private:
+    std::deque<Segment> segments_;
+    size_t readableBytes_;
+    BufferBlockPool* pool_;
+    char* spareChunk_;  // reused for next chunk, avoids allocating for every chunk in steady traffic, unused with pool
+
+    struct ZeroCopySend {
+        uint32_t id;    // assigned by kernel in order, starts from 0
+        std::shared_ptr<const void> holder;
+    };
+    size_t zeroCopyThreshold_;
+    uint32_t nextZeroCopyId_;
+    std::deque<ZeroCopySend> zeroCopyPending_;  // waiting for completion
+    uint64_t zeroCopyCopied_;
+};
+
+} // namespace muduo
+
+#endif // MUDUO_OUTPUT_QUEUE_H
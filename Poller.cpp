@@ -1,5 +1,7 @@
 #include <muduo/Poller.h>
 #include <muduo/EventLoop.h>
+#include <cassert>
+#include <cerrno>
 
 using namespace muduo;
 
@@ -9,3 +11,24 @@ Poller::Poller(EventLoop* loop)
 void Poller::AssertInLoopThread() {
     loop_->AssertInLoopThread();
 }
+
+ssize_t Poller::TakeReceived(Channel*, Buffer*, int* savedErrno) {
+    assert(!SupportsCompletionIo());
+    *savedErrno = EOPNOTSUPP;
+    return -1;
+}
+
+int Poller::TakeAccepted(Channel*, int* savedErrno) {
+    assert(!SupportsCompletionIo());
+    *savedErrno = EOPNOTSUPP;
+    return -1;
+}
+
+void Poller::SubmitSend(Channel*, const struct iovec*, int, std::shared_ptr<void>) {
+    assert(false && "the poller doesn't support completion mode");
+}
+
+bool Poller::TakeSent(Channel*, ssize_t* result) {
+    *result = -EOPNOTSUPP;
+    return true;
+}
@@ -5,12 +5,17 @@
 #include <muduo/EventLoop.h>
 #include <vector>
 #include <chrono>
+#include <memory>
+#include <sys/types.h>
+
+struct iovec;   // forward declaration for struct iovec in header file sys/uio.h
 
 
 namespace muduo {
 
 class Channel;      // forward declaration
 class EventLoop;    // forward declaration
+class Buffer;       // forward declaration
 
 /**
  * abstract base class for IO-multiplexing
@@ -57,8 +62,57 @@ public:
     */
     virtual void RemoveChannel(Channel* c) = 0;
 
+    /**
+     * Whether the backend can notify the channel which requests edge-triggered mode
+    */
+    virtual bool SupportsEdgeTriggered() const { return false; }
+
+    /**
+     * Whether the backend reads, accepts and sends for the channels itself,
+     * and reports the results as POLLIN/POLLOUT, see Channel::EnableCompletionIo.
+     * The methods below are only called on such a backend
+    */
+    virtual bool SupportsCompletionIo() const { return false; }
+
+    /**
+     * Appends the bytes received for a completion-mode channel into buf
+     * @return bytes appended, 0 on end of file, -1 if nothing was received(EAGAIN) OR on failure,
+     *      @c errno is saved into savedErrno
+    */
+    virtual ssize_t TakeReceived(Channel* c, Buffer* buf, int* savedErrno);
+
+    /**
+     * Takes a connection accepted for a completion-mode listening channel
+     * @return the non-blocking & close-on-exec socket, -1 if none was accepted(EAGAIN) OR on failure,
+     *      @c errno is saved into savedErrno
+    */
+    virtual int TakeAccepted(Channel* c, int* savedErrno);
+
+    /**
+     * Sends the iovecs asynchronously, completed with POLLOUT on the channel, see TakeSent.
+     * An empty iovec array only waits until the socket is writable.
+     * One send of a channel is in flight at most.
+     * @param holder keeps the memory of iovecs alive until the send completes, even if the channel is removed
+    */
+    virtual void SubmitSend(Channel* c, const struct iovec* iov, int iovcnt, std::shared_ptr<void> holder);
+
+    /**
+     * Takes the result of the send of channel
+     * @param result bytes sent, OR -errno on failure
+     * @return false if the send is still in flight
+    */
+    virtual bool TakeSent(Channel* c, ssize_t* result);
+
     void AssertInLoopThread();
 
+    /**
+     * Creates the IO-multiplexing backend for the specified loop.
+     * epoll(7) is used by default,
+     * set environment variable "MUDUO_POLLER=poll" to use poll(2) instead.
+     * @note the instance is allocated in the loop-level memory pool if MUDUO_USE_MEMPOOL is defined
+    */
+    static Poller* NewDefaultPoller(EventLoop* loop);
+
 private:
     EventLoop* loop_;	// Poller instance belong to an EventLoop obj
 };
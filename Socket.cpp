@@ -2,6 +2,7 @@
 #include <muduo/base/SocketOps.h>
 #include <muduo/base/Logging.h>
 #include <netinet/tcp.h>
+#include <linux/filter.h>
 
 using namespace muduo;
 
@@ -50,6 +51,54 @@ void muduo::Socket::SetTcpNoDelay(bool on) {
     }
 }
 
+bool Socket::SetZeroCopy(bool on) {
+    int optval = on ? 1 : 0;
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, static_cast<socklen_t>(sizeof optval));
+    if (ret < 0) {
+        LOG_SYSERR << "Socket::SetZeroCopy";
+        return false;
+    }
+    return true;
+}
+
+bool Socket::AttachReusePortCpuSteering(size_t group_size) {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) }, // A = current cpu
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(group_size) },             // A %= group_size
+        { BPF_RET | BPF_A, 0, 0, 0 },                                                     // index of listener
+    };
+    struct sock_fprog prog = { static_cast<unsigned short>(sizeof code / sizeof code[0]), code };
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, static_cast<socklen_t>(sizeof prog));
+    if (ret < 0) {
+        LOG_SYSERR << "Socket::AttachReusePortCpuSteering";
+        return false;
+    }
+    return true;
+#else
+    (void)group_size;
+    return false;
+#endif
+}
+
+bool Socket::SetIncomingCpu(int cpu) {
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, static_cast<socklen_t>(sizeof cpu));
+    if (ret < 0) {
+        LOG_SYSERR << "Socket::SetIncomingCpu";
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetBusyPoll(int usec) {
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, static_cast<socklen_t>(sizeof usec));
+    if (ret < 0) {
+        LOG_SYSERR << "Socket::SetBusyPoll";
+        return false;
+    }
+    return true;
+}
+
 int Socket::Accept(InetAddr* addr) {
     sockets::SockAddr sock_addr;
     std::memset(&sock_addr, 0, sizeof sock_addr);
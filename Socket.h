@@ -2,6 +2,7 @@
 #define MUDUO_SOCKET_H
 
 #include <muduo/base/allocator/Allocatable.h>
+#include <cstddef>
 
 namespace muduo {
 
@@ -33,6 +34,18 @@ public:
     void SetReusePort(bool on);
     void SetReuseAddr(bool on);
     void SetTcpNoDelay(bool on);
+    /// @return false if the kernel doesn't support SO_ZEROCOPY
+    bool SetZeroCopy(bool on);
+    /// @brief Steers the connections of the SO_REUSEPORT group of this listening socket
+    /// to the listener at (CPU handling the connection % group_size), by a classic BPF program
+    /// @return false if the kernel doesn't support SO_ATTACH_REUSEPORT_CBPF
+    bool AttachReusePortCpuSteering(size_t group_size);
+    /// @brief Prefers this listener of the SO_REUSEPORT group for the connections received on cpu(SO_INCOMING_CPU)
+    /// @return false if the kernel doesn't support it
+    bool SetIncomingCpu(int cpu);
+    /// @brief Busy-polls the device queue for up to usec microseconds when reading would block(SO_BUSY_POLL)
+    /// @return false if the kernel doesn't support it, OR usec exceeds net.core.busy_read without CAP_NET_ADMIN
+    bool SetBusyPoll(int usec);
     int Accept(InetAddr* addr);
     void ShutdownWrite();
         
@@ -0,0 +1,98 @@
+#include <muduo/SplicePipe.h>
+#include <muduo/base/SocketOps.h>
+#include <muduo/base/Logging.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <algorithm>
+
+using namespace muduo;
+
+const int SplicePipe::kPreferredCapacity;
+
+SplicePipe::SplicePipe()
+    : fds_ {-1, -1}
+    , capacity_(0)
+    , queued_(0)
+    , writerPaused_(false)
+    , readerClosed_(false)
+    , resumeCb_()
+{
+    if (::pipe2(fds_, O_NONBLOCK|O_CLOEXEC) != 0) {
+        LOG_SYSFATAL << "SplicePipe::SplicePipe - pipe2";
+    }
+    ::fcntl(fds_[1], F_SETPIPE_SZ, kPreferredCapacity);    // best effort
+    int capacity = ::fcntl(fds_[1], F_GETPIPE_SZ);
+    capacity_ = capacity > 0 ? static_cast<size_t>(capacity) : 65536;
+}
+
+SplicePipe::~SplicePipe() noexcept {
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+}
+
+ssize_t SplicePipe::SpliceFrom(int sockfd, size_t len, int* savedErrno) {
+    ssize_t n = sockets::splice(sockfd, WriteFd(), len);
+    if (n < 0) {
+        *savedErrno = errno;
+    } else {
+        queued_.fetch_add(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+SplicePipe::PauseResult SplicePipe::PauseIfFull(int sockfd, size_t queued) {
+    int available = 0;
+    if (queued == 0 || ::ioctl(sockfd, FIONREAD, &available) != 0 || available == 0) {
+        return kSourceDrained;
+    }
+    // NOTE: a page of pipe may be partially filled, so the pipe can be full before queued reaches capacity
+    writerPaused_.store(true);
+    // re-check after publishing the flag, pairs with HandleDrained.
+    // only the writer increases queued_, so a decrease means the reader drained the pipe
+    if (queued_.load() < queued) {
+        writerPaused_.store(false);
+        return kRetry;
+    }
+    return kPaused;
+}
+
+ssize_t SplicePipe::SpliceTo(int sockfd, size_t len, int* savedErrno) {
+    ssize_t n = sockets::splice(ReadFd(), sockfd, len);
+    if (n < 0) {
+        *savedErrno = errno;
+    } else if (n > 0) {
+        HandleDrained(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+void SplicePipe::Discard(size_t len) {
+    char buf[4096];
+    size_t left = len;
+    while (left > 0) {
+        ssize_t n = ::read(ReadFd(), buf, std::min(left, sizeof buf));
+        if (n <= 0) {
+            break;
+        }
+        left -= static_cast<size_t>(n);
+    }
+    HandleDrained(len - left);
+}
+
+void SplicePipe::CloseReader() {
+    if (!readerClosed_.exchange(true)) {
+        writerPaused_.store(false);
+        if (resumeCb_) {
+            resumeCb_();
+        }
+    }
+}
+
+void SplicePipe::HandleDrained(size_t len) {
+    queued_.fetch_sub(len);
+    if (writerPaused_.load() && writerPaused_.exchange(false) && resumeCb_) {
+        resumeCb_();
+    }
+}
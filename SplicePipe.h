@@ -0,0 +1,86 @@
+#if !defined(MUDUO_SPLICE_PIPE_H)
+#define MUDUO_SPLICE_PIPE_H
+
+#include <muduo/base/InlineFunction.h>
+#include <sys/types.h>
+#include <atomic>
+#include <cstddef>
+
+namespace muduo {
+
+/**
+ * Kernel pipe used to forward bytes between two sockets with splice(2),
+ * the bytes never enter user space.
+ *
+ * The writer side(source connection) splices bytes from its socket into the pipe,
+ * the reader side(output queue of target connection) splices them out to its socket,
+ * the two sides could run in different loop threads.
+ * When the pipe is full, the writer pauses and is resumed by the reader after draining.
+*/
+class SplicePipe {
+    /// non-copyable & non-moveable
+    SplicePipe(const SplicePipe&) = delete;
+    SplicePipe& operator=(const SplicePipe&) = delete;
+
+public:
+    using ResumeCallback_t = base::InlineFunction<void()>;
+
+    /// the pipe is enlarged to it if permitted(see /proc/sys/fs/pipe-max-size)
+    static const int kPreferredCapacity = 1024 * 1024;
+
+    SplicePipe();
+    ~SplicePipe() noexcept;
+
+    int ReadFd() const { return fds_[0]; }
+    int WriteFd() const { return fds_[1]; }
+    size_t Capacity() const { return capacity_; }
+    size_t QueuedBytes() const { return queued_.load(); }
+
+    /// @brief Invoked in the reader thread when a paused writer can continue
+    /// @note Must be set before splicing
+    void SetResumeCallback(ResumeCallback_t cb)
+    { resumeCb_ = std::move(cb); }
+
+    /// @brief Splices bytes from sockfd into the pipe, called by writer
+    /// @return result of splice(2), @c errno is saved into savedErrno on failure
+    ssize_t SpliceFrom(int sockfd, size_t len, int* savedErrno);
+
+    enum PauseResult {
+        kSourceDrained, // EAGAIN came from the socket
+        kPaused,        // the pipe is full, wait for the resume callback
+        kRetry          // the reader drained the pipe meanwhile
+    };
+
+    /// @brief Marks the writer as paused after SpliceFrom failed with EAGAIN, if the pipe is full
+    /// @param sockfd the source socket, the pipe is full if it still has unread bytes
+    /// @param queued QueuedBytes() observed just after the failure
+    PauseResult PauseIfFull(int sockfd, size_t queued);
+
+    /// @brief Splices at most len queued bytes out to sockfd, called by reader
+    /// @return result of splice(2), @c errno is saved into savedErrno on failure
+    ssize_t SpliceTo(int sockfd, size_t len, int* savedErrno);
+
+    /// @brief Throws away len queued bytes, e.g. the reader is closed
+    void Discard(size_t len);
+
+    /// @brief Marks that the reader side is closed, and invokes the resume callback,
+    /// so the writer learns it even if it is paused
+    void CloseReader();
+    bool ReaderClosed() const
+    { return readerClosed_.load(); }
+
+private:
+    void HandleDrained(size_t len);
+
+private:
+    int fds_[2];
+    size_t capacity_;
+    std::atomic<size_t> queued_;    // bytes in the pipe
+    std::atomic_bool writerPaused_;
+    std::atomic_bool readerClosed_;
+    ResumeCallback_t resumeCb_;
+};
+
+} // namespace muduo
+
+#endif // MUDUO_SPLICE_PIPE_H
@@ -103,16 +103,8 @@ void TcpClient::HandleConnectSuccessfully(int sockfd) {
     TcpConnectionPtr conn_ptr;
 #ifdef MUDUO_USE_MEMPOOL
     // the TcpConnection instance be allocated from memory pool of the specified loop,
-    // so it must be deallocated in the thread where the specified loop is located
-    conn_ptr = std::shared_ptr<TcpConnection>(new (loop_->GetMemoryPool()) TcpConnection(loop_, conn_name, sockfd, local_addr, remote_addr),
-        [loop = this->GetEventLoop()](TcpConnection* conn) {
-            // destroys the connection instance
-            conn->~TcpConnection();
-            // thread-safely deallocate the storage
-            loop->RunInEventLoop([loop, ptr = conn]() {
-                loop->GetMemoryPool()->deallocate(ptr, sizeof(TcpConnection));
-            });
-        });
+    // and may be freed in any thread (see base::detail::Allocatable)
+    conn_ptr = std::shared_ptr<TcpConnection>(new (loop_->GetMemoryPool()) TcpConnection(loop_, conn_name, sockfd, local_addr, remote_addr));
 #else
     // The TcpConnection instance be allocated from heap
     conn_ptr = std::make_shared<TcpConnection>(loop_, conn_name, sockfd, local_addr, remote_addr);
@@ -4,6 +4,7 @@
 
 #include <muduo/EventLoop.h>
 #include <muduo/InetAddr.h>
+#include <mutex>
 
 namespace muduo {
 
@@ -1,13 +1,47 @@
 #include <muduo/base/SocketOps.h>
 #include <muduo/base/Logging.h>
 #include <muduo/TcpConnection.h>
+#include <muduo/IdleConnectionWheel.h>
 #include <muduo/EventLoop.h>
 #include <muduo/Channel.h>
 #include <muduo/Socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
 #include <new>
 
 using namespace muduo;
 
+const size_t TcpConnection::kDefaultIoBudget;
+const size_t TcpConnection::kMinSliceBytes;
+const size_t TcpConnection::kMaxInputReserve;
+
+namespace {
+
+/// interval of reaping the completions of the zero-copy sends left by a destroyed connection
+const std::chrono::milliseconds kZeroCopyLingerInterval(10);
+
+/// the zero-copy sends of a destroyed connection, and a duplicate of its socket to read their completions
+struct ZeroCopyLinger {
+    explicit ZeroCopyLinger(int dupfd)
+        : fd(dupfd)
+        , sends()
+        , timer(-1)
+    { }
+
+    ~ZeroCopyLinger() noexcept {
+        ::close(fd);
+    }
+
+    int fd;
+    OutputQueue sends;
+    TimerId_t timer;
+};
+
+} // namespace
+
 void muduo::DefaultConnectionCallback(const TcpConnectionPtr& conn) {
     LOG_TRACE << conn->GetLocalAddr().GetIpPort() << " -> "
         << conn->GetRemoteAddr().GetIpPort() << " is "
@@ -30,21 +64,53 @@ TcpConnection::TcpConnection(EventLoop* owner, const std::string& name, int sock
     , chan_(::new Channel(owner, sockfd), [](Channel* c) {
         ::delete c;
     }) 
-    , inputBuffer_()
-    , outputBuffer_()
+    , inputBuffer_(owner->GetBufferBlockPool(), 0)  // grows on demand, see AdjustInputBuffer
+    , outputQueue_(owner->GetBufferBlockPool())
 {
+    SetupChannel();
+    LOG_DEBUG << "TcpConnection[" <<  name_ << "] is constructed at " << this << " fd=" << chan_->FileDescriptor();
+    SetKeepAlive(true);
+    owner->GetLoad().AddConnection();   // counted once assigned, so a burst of accepts sees it
+}
+
+void TcpConnection::SetupChannel() {
     chan_->SetReadCallback(std::bind(&TcpConnection::HandleRead, this, std::placeholders::_1));
     chan_->SetWriteCallback(std::bind(&TcpConnection::HandleWrite, this));
     chan_->SetCloseCallback(std::bind(&TcpConnection::HandleClose, this));
     chan_->SetErrorCallback(std::bind(&TcpConnection::HandleError, this));
-
-    LOG_DEBUG << "TcpConnection[" <<  name_ << "] is constructed at " << this << " fd=" << chan_->FileDescriptor();
-    SetKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection() noexcept {
     LOG_DEBUG << "TcpConnection[" <<  name_ << "] is being destructed at " << this << " fd=" << chan_->FileDescriptor();
     assert(state_ == disconnected);
+    if (outputQueue_.PendingZeroCopySends() > 0) {
+        outputQueue_.ReapZeroCopyCompletions(socket_->FileDescriptor());
+        if (outputQueue_.PendingZeroCopySends() > 0) {
+            LingerZeroCopySends();
+        }
+    }
+}
+
+void TcpConnection::LingerZeroCopySends() {
+    // the duplicate keeps the socket open, so closes the connection explicitly
+    int dupfd = ::fcntl(socket_->FileDescriptor(), F_DUPFD_CLOEXEC, 0);
+    if (dupfd < 0) {
+        LOG_SYSERR << "TcpConnection::LingerZeroCopySends, connection[" << name_ << "] "
+                << outputQueue_.PendingZeroCopySends() << " zero-copy sends are released before completion";
+        return;
+    }
+    ::shutdown(dupfd, SHUT_RDWR);
+    auto linger = std::make_shared<ZeroCopyLinger>(dupfd);
+    outputQueue_.HandOverZeroCopySends(&linger->sends);
+    EventLoop* loop = GetEventLoop();
+    loop->RunInEventLoop([loop, linger]() {
+        linger->timer = loop->RunEvery(kZeroCopyLingerInterval, [loop, linger]() {
+            linger->sends.ReapZeroCopyCompletions(linger->fd);
+            if (linger->sends.PendingZeroCopySends() == 0) {
+                loop->cancelTimer(linger->timer);   // releases the linger
+            }
+        });
+    });
 }
 
 void muduo::TcpConnection::SetKeepAlive(bool on) {
@@ -56,79 +122,342 @@ void muduo::TcpConnection::SetTcpNoDelay(bool on) {
 }
 
 void TcpConnection::StepIntoEstablished() {
-    loop_->AssertInLoopThread();
+    GetEventLoop()->AssertInLoopThread();
     assert(state_ == connecting);
     state_.store(connected);
     chan_->Tie(shared_from_this());
-    chan_->EnableReading();
+    if (completionIo_ && !GetEventLoop()->SupportsCompletionIo()) {
+        LOG_WARN << "TcpConnection[" << name_ << "] the poller doesn't support completion mode, "
+                "fall back to readiness mode";
+        completionIo_ = false;
+    }
+    if (completionIo_) {
+        // the poller receives and sends, there is no readiness to drain
+        chan_->EnableCompletionIo(Channel::kReceiveCompletion);
+        edgeTriggered_ = false;
+        zeroCopyThreshold_ = 0;
+    }
+    if (edgeTriggered_ && !GetEventLoop()->SupportsEdgeTriggered()) {
+        LOG_WARN << "TcpConnection[" << name_ << "] the poller doesn't support edge-triggered mode, "
+                "fall back to level-triggered mode";
+        edgeTriggered_ = false;
+    }
+    if (edgeTriggered_) {
+        // register read & write interest once, so no need to toggle writing later
+        chan_->EnableEdgeTriggered();
+        chan_->EnableReadingAndWriting();
+    } else {
+        chan_->EnableReading();
+    }
+    if (zeroCopyThreshold_ > 0 && !socket_->SetZeroCopy(true)) {
+        LOG_WARN << "TcpConnection[" << name_ << "] SO_ZEROCOPY is not supported, fall back to copying";
+        zeroCopyThreshold_ = 0;
+    }
+    outputQueue_.SetZeroCopyThreshold(zeroCopyThreshold_);
+    SetupBusyPoll();
+    if (idleWheel_) {
+        idleWheel_->Add(this);
+    }
     connectionCb_(shared_from_this());
 }
 
+void TcpConnection::SetupBusyPoll() {
+    const int usec = GetEventLoop()->GetSocketBusyPoll();
+    if (usec > 0 && !socket_->SetBusyPoll(usec)) {
+        LOG_WARN << "TcpConnection[" << name_ << "] failed to set SO_BUSY_POLL, reads wait for the interrupt";
+    }
+}
+
 void TcpConnection::StepIntoDestroyed() {
-    loop_->AssertInLoopThread();
+    GetEventLoop()->AssertInLoopThread();
     State expect = connected;
     if (state_.compare_exchange_strong(expect, disconnected)) { // CAS
         chan_->disableAllEvents();
     } 
+    CloseForwardSources();
+    if (idleWheel_) {
+        idleWheel_->Remove(this);
+    }
+    GetEventLoop()->GetLoad().SubPendingOutputBytes(reportedOutputBytes_);
+    reportedOutputBytes_ = 0;
+    GetEventLoop()->GetLoad().RemoveConnection();
     /// FIXME: When @c TcpServer instance is destroyed And the state of the @c TcpConnection is disconnecting
     ///        might abort in the function @c Channel::Remove
     connectionCb_(shared_from_this());
     chan_->Remove();
 }
 
+bool TcpConnection::MigrateInLoop(EventLoop* target, const std::shared_ptr<detail::IdleConnectionWheel>& wheel) {
+    EventLoop* source = GetEventLoop();
+    source->AssertInLoopThread();
+    if (state_ != connected || target == source || forwardPipe_ != nullptr || completionIo_
+        || (edgeTriggered_ && !target->SupportsEdgeTriggered())) {
+        return false;
+    }
+    // detaches: nothing of the source loop refers to the connection after it
+    chan_->disableAllEvents();
+    chan_->Remove();
+    if (idleWheel_) {
+        idleWheel_->Remove(this);
+        idleWheel_.reset();
+    }
+    source->GetLoad().SubPendingOutputBytes(reportedOutputBytes_);
+    reportedOutputBytes_ = 0;
+    source->GetLoad().RemoveConnection();
+    target->GetLoad().AddConnection();
+
+    // the callbacks enqueued into source from now on are forwarded to target, and run after AttachInLoop,
+    // since target is published after AttachInLoop was enqueued.
+    // In the meantime, the calls in target thread are enqueued instead of run in place, see InOwnerLoop
+    migrating_.store(true, std::memory_order_release);
+    LOG_DEBUG << "TcpConnection[" << name_ << "] migrates from loop " << source << " to " << target;
+    target->EnqueueEventLoop([self = shared_from_this(), target, wheel]() {
+        self->AttachInLoop(target, wheel);
+    });
+    loop_.store(target, std::memory_order_release);
+    return true;
+}
+
+void TcpConnection::AttachInLoop(EventLoop* target, const std::shared_ptr<detail::IdleConnectionWheel>& wheel) {
+    target->AssertInLoopThread();
+    loop_.store(target, std::memory_order_release);     // may not be published by the source thread yet
+    // the blocks are allocated in the loop thread of their pool only, and stay local to the serving thread
+    inputBuffer_.RebindPool(target->GetBufferBlockPool());
+    outputQueue_.RebindPool(target->GetBufferBlockPool());
+    chan_.reset(::new Channel(target, socket_->FileDescriptor()));
+    SetupChannel();
+    chan_->Tie(shared_from_this());
+    SetupBusyPoll();
+    migrating_.store(false, std::memory_order_release);
+
+    // the readiness gained in transit is reported once the socket is added to the poller, also in edge-triggered mode
+    if (edgeTriggered_) {
+        chan_->EnableEdgeTriggered();
+        chan_->EnableReadingAndWriting();
+    } else {
+        chan_->EnableReading();
+        if (!outputQueue_.Empty()) {
+            chan_->enableWriting();
+        }
+    }
+    ReportOutputBytes();
+    idleWheel_ = wheel;
+    if (idleWheel_) {
+        idleWheel_->Add(this);  // counts as an activity, the connection isn't evicted right after moving
+    }
+}
+
 void TcpConnection::HandleClose() {
-    loop_->AssertInLoopThread();
+    GetEventLoop()->AssertInLoopThread();
     assert(state_ == connected || state_ == disconnecting);
     chan_->disableAllEvents();  // prevent poll trigger POLLOUT again
     state_ = disconnected;
+    if (idleWheel_) {
+        idleWheel_->Remove(this);
+    }
+    CloseForwardSources();
+    if (forwardPipe_) {
+        // the forwarded bytes are queued in target before the shutdown, so they are flushed first
+        if (TcpConnectionPtr target = forwardTarget_.lock()) {
+            target->Shutdown();
+        }
+    }
     onCloseCb_(shared_from_this());
 }
 
 void TcpConnection::HandleError() {
-    loop_->AssertInLoopThread();
+    GetEventLoop()->AssertInLoopThread();
+    if (zeroCopyThreshold_ > 0) {
+        // the zero-copy completions are reported by the error queue
+        outputQueue_.ReapZeroCopyCompletions(socket_->FileDescriptor());
+    }
     int err = sockets::getSocketError(socket_->FileDescriptor());
+    if (zeroCopyWriteComplete_ && outputQueue_.Empty() && outputQueue_.PendingZeroCopySends() == 0) {
+        zeroCopyWriteComplete_ = false;
+        if (writeCompleteCb_) {
+            QueueInOwnerLoop([](TcpConnection* conn) { conn->writeCompleteCb_(conn->shared_from_this()); });
+        }
+    }
+    if (err == 0 && zeroCopyThreshold_ > 0) {
+        return;
+    }
     LOG_ERROR << "TcpConnection::HandleError[" << name_ << "] occurred a error," 
         "detail: " << strerror_thread_safe(err) << "(" << err << ")"; 
 }
 
 void TcpConnection::HandleRead(const ReceiveTimePoint_t& recv_timepoint) {
-    loop_->AssertInLoopThread();
-    int savedError = 0;
-    ssize_t ret = inputBuffer_.ReadFd(socket_->FileDescriptor(), &savedError);
-    if (ret < 0) {
-        errno = savedError;
-        LOG_SYSERR << "TcpConnection::HandleRead[" << name_ << "]";
-        HandleError();
-    } else if (ret == 0) {
-        HandleClose();  // peer sends a FIN-package, so we should close the connection. (FIXME: 没有处理客户端半关闭的情况)
-    } else {
+    GetEventLoop()->AssertInLoopThread();
+    if (forwardPipe_) {
+        HandleForwardRead(recv_timepoint);
+        return;
+    }
+    if (!edgeTriggered_) {
+        int savedError = 0;
+        ssize_t ret = ReadInput(&savedError);
+        if (ret < 0) {
+            if (savedError != EAGAIN) {    // nothing was received, e.g. completion mode reports a send only
+                errno = savedError;
+                LOG_SYSERR << "TcpConnection::HandleRead[" << name_ << "]";
+                HandleError();
+            }
+        } else if (ret == 0) {
+            HandleClose();  // peer sends a FIN-package, so we should close the connection. (FIXME: 没有处理客户端半关闭的情况)
+        } else {
+            TouchIdle();
+            onMessageCb_(shared_from_this(), &inputBuffer_, recv_timepoint);
+            AdjustInputBuffer();
+        }
+        return;
+    }
+
+    // edge-triggered mode: the socket won't be reported again until new data arrives,
+    // so drain it until EAGAIN OR the budget runs out
+    if (state_ != connected && state_ != disconnecting) {
+        return; // the connection was closed before the continuation runs
+    }
+    size_t total = 0;
+    bool peerClosed = false;
+    while (total < ioBudget_) {
+        int savedError = 0;
+        ssize_t ret = ReadInput(&savedError);
+        if (ret > 0) {
+            total += static_cast<size_t>(ret);
+        } else if (ret == 0) {
+            peerClosed = true;
+            break;
+        } else {
+            if (savedError != EAGAIN && savedError != EWOULDBLOCK) {
+                errno = savedError;
+                LOG_SYSERR << "TcpConnection::HandleRead[" << name_ << "]";
+                HandleError();
+            }
+            break;
+        }
+    }
+
+    if (total > 0) {
+        TouchIdle();
         onMessageCb_(shared_from_this(), &inputBuffer_, recv_timepoint);
+        AdjustInputBuffer();
+    }
+    if (peerClosed) {
+        if (state_ == connected || state_ == disconnecting) {
+            HandleClose();
+        }
+    } else if (total >= ioBudget_) {
+        // budget exhausted, continue reading in the next iteration of loop
+        QueueInOwnerLoop([recv_timepoint](TcpConnection* conn) { conn->HandleRead(recv_timepoint); });
+    }
+}
+
+ssize_t TcpConnection::ReadInput(int* savedErrno) {
+    if (completionIo_) {
+        // already received into the buffers of poller
+        ssize_t n = GetEventLoop()->TakeReceived(chan_.get(), &inputBuffer_, savedErrno);
+        if (n > 0) {
+            avgReadBytes_ = avgReadBytes_ - avgReadBytes_ / 8 + static_cast<size_t>(n) / 8;
+            CountIoBytes(static_cast<size_t>(n));
+        }
+        return n;
+    }
+    if (!adaptiveInputBuffer_) {
+        ssize_t n = inputBuffer_.ReadFd(socket_->FileDescriptor(), savedErrno);
+        if (n > 0) {
+            CountIoBytes(static_cast<size_t>(n));
+        }
+        return n;
+    }
+    const size_t expected = ExpectedReadSize();
+    if (expected > Buffer::kInitialSize && inputBuffer_.WriteableBytes() < expected) {
+        // large bursts are read into the input buffer directly, instead of copying from spill buffer
+        inputBuffer_.EnsureWriteableBytes(expected);
+    }
+    ssize_t n = inputBuffer_.ReadFd(socket_->FileDescriptor(),
+            GetEventLoop()->GetSpillBuffer(), EventLoop::kSpillBufferSize, savedErrno);
+    if (n > 0) {
+        avgReadBytes_ = avgReadBytes_ - avgReadBytes_ / 8 + static_cast<size_t>(n) / 8;
+        CountIoBytes(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+size_t TcpConnection::ExpectedReadSize() const {
+    // twice of the average, rounded up to power of 2
+    size_t expected = Buffer::kInitialSize;
+    while (expected < avgReadBytes_ * 2 && expected < kMaxInputReserve) {
+        expected *= 2;
+    }
+    return expected;
+}
+
+void TcpConnection::AdjustInputBuffer() {
+    if (!adaptiveInputBuffer_ || inputBuffer_.ReadableBytes() != 0) {
+        return; // keeps the partial message
+    }
+    const size_t storage = inputBuffer_.StorageBytes();
+    if (storage == 0) {
+        return;
+    }
+    const size_t expected = ExpectedReadSize();
+    if (expected <= Buffer::kInitialSize) {
+        // small messages: the next read goes to the spill buffer and only the unconsumed bytes are kept,
+        // a pooled block goes back to the pool, so an idle connection holds no storage
+        inputBuffer_.ReleaseStorage();
+    } else if (storage > expected * 4) {
+        // a large stream keeps a storage fitting its reads, the one grown by a burst is given back
+        inputBuffer_.Shrink(expected);
     }
 }
 
 void TcpConnection::HandleWrite() {
-    loop_->AssertInLoopThread();
+    GetEventLoop()->AssertInLoopThread();
+    if (completionIo_) {
+        WriteByCompletion();
+        return;
+    }
     if (chan_->IsWriting()) {
-        ssize_t n = sockets::write(chan_->FileDescriptor(), outputBuffer_.Peek(), outputBuffer_.ReadableBytes());
-        if (n >= 0) {
-            outputBuffer_.Retrieve(n);
-            if (outputBuffer_.ReadableBytes() == 0) {
-                chan_->disableWriting();
-                if (writeCompleteCb_) {
-                    loop_->EnqueueEventLoop(std::bind(writeCompleteCb_, shared_from_this()));
+        if (outputQueue_.Empty()) {
+            return; // edge-triggered mode reports writable even if nothing to send
+        }
+        size_t total = 0;
+        do {
+            int savedErrno = 0;
+            // level-triggered mode writes as much as the socket accepts in one writev(2)
+            const size_t limit = edgeTriggered_ ? ioBudget_ - total : outputQueue_.ReadableBytes();
+            ssize_t n = outputQueue_.WriteFd(chan_->FileDescriptor(), limit, &savedErrno);
+            if (n >= 0) {
+                total += static_cast<size_t>(n);
+                CountIoBytes(static_cast<size_t>(n));
+                TouchIdle();
+                ReportOutputBytes();
+                if (outputQueue_.Empty()) {
+                    HandleWriteComplete();
+                    return;
+                }
+            } else {
+                errno = savedErrno;
+                if (errno == ENODATA) {
+                    LOG_ERROR << "TcpConnection::HandleWrite[" << name_ << "] the file was truncated "
+                            "before the region was sent, close the connection";
+                    HandleClose();
+                    return;
                 }
-                if (state_ == disconnecting) {
-                    ShutdownInLoop();
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_SYSERR << "TcpConnection::HandleWrite";
+                    // The peer responds so slowly.
+                    // whether shutdown the connection directly ?
+                    // if (state_ == kDisconnecting)
+                    // {
+                    //   shutdownInLoop();
+                    // }
                 }
+                return; // edge-triggered mode waits for next writable notification
             }
-        } else {
-            LOG_SYSERR << "TcpConnection::HandleWrite";
-            // The peer responds so slowly.
-            // whether shutdown the connection directly ?
-            // if (state_ == kDisconnecting)
-            // {
-            //   shutdownInLoop();
-            // }
+        } while (edgeTriggered_ && total < ioBudget_);
+
+        if (edgeTriggered_) {
+            // budget exhausted but socket is still writable, no more notification will come
+            QueueInOwnerLoop([](TcpConnection* conn) { conn->HandleWrite(); });
         }
     } else {
         LOG_TRACE << "Connection fd=" << chan_->FileDescriptor() 
@@ -137,16 +466,110 @@ void TcpConnection::HandleWrite() {
     }
 }
 
+void TcpConnection::WriteByCompletion() {
+    EventLoop* loop = GetEventLoop();
+    loop->AssertInLoopThread();
+    if (state_ == disconnected) {
+        return; // closed by the reading of same events, the channel may be removed already
+    }
+    if (sendInFlight_) {
+        ssize_t n = 0;
+        if (!loop->TakeSent(chan_.get(), &n)) {
+            return; // the bytes queued meanwhile go with the next send
+        }
+        sendInFlight_ = false;
+        if (n > 0) {
+            outputQueue_.Retrieve(static_cast<size_t>(n));
+            CountIoBytes(static_cast<size_t>(n));
+            TouchIdle();
+            ReportOutputBytes();
+            if (outputQueue_.Empty()) {
+                HandleWriteComplete();
+                return;
+            }
+        } else if (n < 0 && n != -EAGAIN) {
+            errno = static_cast<int>(-n);
+            LOG_SYSERR << "TcpConnection::WriteByCompletion[" << name_ << "]";
+            return; // the receiving reports the reset, and closes the connection
+        }
+    }
+    if (outputQueue_.Empty()) {
+        return;
+    }
+
+    while (!outputQueue_.Empty()) {
+        struct iovec vec[EventLoop::kMaxSendIovecs];
+        const int iovcnt = outputQueue_.PeekMemory(vec, EventLoop::kMaxSendIovecs, ioBudget_);
+        if (iovcnt > 0) {
+            // the bytes stay in the output queue until the send completes
+            loop->SubmitSend(chan_.get(), vec, iovcnt, shared_from_this());
+            sendInFlight_ = true;
+            return;
+        }
+        // a file region OR a pipe at front, moved by sendfile(2) OR splice(2) in place
+        int savedErrno = 0;
+        ssize_t n = outputQueue_.WriteFd(chan_->FileDescriptor(), ioBudget_, &savedErrno);
+        if (n < 0) {
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                loop->SubmitSend(chan_.get(), nullptr, 0, shared_from_this());  // waits for writable
+                sendInFlight_ = true;
+            } else if (savedErrno == ENODATA) {
+                LOG_ERROR << "TcpConnection::WriteByCompletion[" << name_ << "] the file was truncated "
+                        "before the region was sent, close the connection";
+                HandleClose();
+            } else {
+                errno = savedErrno;
+                LOG_SYSERR << "TcpConnection::WriteByCompletion[" << name_ << "]";
+            }
+            return;
+        }
+        CountIoBytes(static_cast<size_t>(n));
+        TouchIdle();
+        ReportOutputBytes();
+    }
+    HandleWriteComplete();
+}
+
+void TcpConnection::TouchIdle() {
+    if (idleWheel_) {
+        lastActiveTick_ = idleWheel_->CurrentTick();
+    }
+}
+
+void TcpConnection::ReportOutputBytes() {
+    const size_t now = outputQueue_.ReadableBytes();
+    if (now > reportedOutputBytes_) {
+        GetEventLoop()->GetLoad().AddPendingOutputBytes(now - reportedOutputBytes_);
+    } else {
+        GetEventLoop()->GetLoad().SubPendingOutputBytes(reportedOutputBytes_ - now);
+    }
+    reportedOutputBytes_ = now;
+}
+
+void TcpConnection::HandleWriteComplete() {
+    if (!edgeTriggered_ && !completionIo_) {
+        chan_->disableWriting();
+    }
+    // the kernel may still read the pages of zero-copy slices, reported after their completions, see HandleError
+    zeroCopyWriteComplete_ = (outputQueue_.PendingZeroCopySends() > 0);
+    if (writeCompleteCb_ && !zeroCopyWriteComplete_) {
+        QueueInOwnerLoop([](TcpConnection* conn) { conn->writeCompleteCb_(conn->shared_from_this()); });
+    }
+    if (state_ == disconnecting) {
+        ShutdownInLoop();
+    }
+}
+
 void TcpConnection::Shutdown() {
     TcpConnection::State expected = connected;
     if (state_.compare_exchange_strong(expected, disconnecting)) {  // CAS
-        loop_->RunInEventLoop(std::bind(&TcpConnection::ShutdownInLoop, shared_from_this()));
+        RunInOwnerLoop([](TcpConnection* conn) { conn->ShutdownInLoop(); });
     }
 }
 
 void TcpConnection::ShutdownInLoop() {
-    loop_->AssertInLoopThread();
-    if (!chan_->IsWriting()) {
+    GetEventLoop()->AssertInLoopThread();
+    if (outputQueue_.Empty()) {
         socket_->ShutdownWrite();
     } /* else {
         This is handled by write-handler When the send-operation is complete
@@ -155,58 +578,352 @@ void TcpConnection::ShutdownInLoop() {
 
 void TcpConnection::Send(const char* buf, size_t len) {
     if (state_.load() == connected) {
-        if (loop_->IsInLoopThread()) {
+        if (InOwnerLoop()) {
             SendInLoop(buf, len);
         } else {
             // saved buf`s data, Prevent buf from being destroyed
             std::string saved(buf, len);
-            loop_->EnqueueEventLoop([savedData = std::move(saved), guard = shared_from_this()]() {
-                guard->SendInLoop(savedData.c_str(), savedData.size());
+            QueueInOwnerLoop([savedData = std::move(saved)](TcpConnection* conn) mutable {
+                conn->SendInLoop(std::move(savedData));
             });
         }
     }
 }
 
-void TcpConnection::SendInLoop(const char* buf, size_t len) {
-    loop_->AssertInLoopThread();
-    ssize_t nwrote = 0;
-    size_t remaining = len;
-    bool faultError = false;
+void TcpConnection::Send(std::string&& message) {
+    if (state_.load() == connected) {
+        if (InOwnerLoop()) {
+            SendInLoop(std::move(message));
+        } else {
+            QueueInOwnerLoop([msg = std::move(message)](TcpConnection* conn) mutable {
+                conn->SendInLoop(std::move(msg));
+            });
+        }
+    }
+}
+
+void TcpConnection::Send(Buffer&& buf) {
+    if (state_.load() == connected) {
+        if (InOwnerLoop()) {
+            SendInLoop(std::move(buf));
+        } else {
+            QueueInOwnerLoop([b = std::move(buf)](TcpConnection* conn) mutable {
+                conn->SendInLoop(std::move(b));
+            });
+        }
+    }
+}
+
+void TcpConnection::SendSlice(std::shared_ptr<const void> holder, const void* data, size_t len) {
+    if (state_.load() == connected) {
+        const char* d = static_cast<const char*>(data);
+        if (InOwnerLoop()) {
+            SendSliceInLoop(std::move(holder), d, len);
+        } else {
+            QueueInOwnerLoop([h = std::move(holder), d, len](TcpConnection* conn) mutable {
+                conn->SendSliceInLoop(std::move(h), d, len);
+            });
+        }
+    }
+}
+
+bool TcpConnection::WriteDirectly(const char* data, size_t len, size_t* remaining) {
+    GetEventLoop()->AssertInLoopThread();
+    *remaining = len;
     if (state_ == disconnected) {
         LOG_WARN << "disconnected, give up writing, connection[" << name_ << "]";
-        return;
+        return false;
+    }
+    if (completionIo_) {
+        return true;    // queued and sent by the poller, see WriteByCompletion
     }
     // if no thing in output queue, try writing directly
-    if (!chan_->IsWriting() && outputBuffer_.ReadableBytes() == 0) {
-        nwrote = sockets::write(chan_->FileDescriptor(), buf, len);
+    if (outputQueue_.Empty()) {
+        ssize_t nwrote = sockets::write(chan_->FileDescriptor(), data, len);
         if (nwrote >= 0) {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCb_) {
-                loop_->EnqueueEventLoop(std::bind(writeCompleteCb_, shared_from_this()));
+            *remaining = len - nwrote;
+            CountIoBytes(static_cast<size_t>(nwrote));
+            if (*remaining == 0 && writeCompleteCb_) {
+                QueueInOwnerLoop([](TcpConnection* conn) { conn->writeCompleteCb_(conn->shared_from_this()); });
             }
         } else {
-            nwrote = 0;
             if (errno != EWOULDBLOCK) {
                 LOG_SYSERR << "TcpConnection::SendInLoop, connection[" << name_ << "]";
                 if (errno == EPIPE || errno == ECONNRESET)
                 {
-                    faultError = true;
+                    return false;
                 }
             }
         }
     }
+    assert(*remaining <= len);
+    return true;
+}
+
+void TcpConnection::HandleQueued(size_t oldLen) {
+    size_t newLen = outputQueue_.ReadableBytes();
+    ReportOutputBytes();
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterCb_)
+    {
+        QueueInOwnerLoop([newLen](TcpConnection* conn) { conn->highWaterCb_(conn->shared_from_this(), newLen); });
+    }
+    if (completionIo_) {
+        WriteByCompletion();
+    } else if (!chan_->IsWriting()) {
+        chan_->enableWriting();
+    }
+}
 
-    assert(remaining <= len);
+void TcpConnection::SendInLoop(const char* buf, size_t len) {
+    size_t remaining = 0;
+    if (WriteDirectly(buf, len, &remaining) && remaining > 0) {
+        size_t oldLen = outputQueue_.ReadableBytes();
+        outputQueue_.Append(buf + len - remaining, remaining);
+        HandleQueued(oldLen);
+    }
+}
 
-    if (!faultError && remaining > 0) {
-        size_t oldLen = outputBuffer_.ReadableBytes();
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterCb_)
-        {
-            loop_->EnqueueEventLoop(std::bind(highWaterCb_, shared_from_this(), oldLen + remaining));
+void TcpConnection::SendInLoop(std::string&& message) {
+    if (UseZeroCopy(message.size())) {
+        auto holder = std::make_shared<const std::string>(std::move(message));
+        SendZeroCopyInLoop(holder, holder->data(), holder->size());
+        return;
+    }
+    size_t remaining = 0;
+    if (WriteDirectly(message.data(), message.size(), &remaining) && remaining > 0) {
+        size_t oldLen = outputQueue_.ReadableBytes();
+        if (remaining < kMinSliceBytes) {
+            outputQueue_.Append(message.data() + message.size() - remaining, remaining);
+        } else {
+            // NOTE: moving a short string relocates its bytes, so take the pointer after moving
+            auto holder = std::make_shared<const std::string>(std::move(message));
+            outputQueue_.AppendSlice(holder, holder->data() + holder->size() - remaining, remaining);
         }
-        outputBuffer_.Append(buf+nwrote, remaining);
-        if (!chan_->IsWriting()) {
-            chan_->enableWriting();
+        HandleQueued(oldLen);
+    }
+}
+
+void TcpConnection::SendInLoop(Buffer&& buf) {
+    if (UseZeroCopy(buf.ReadableBytes())) {
+        auto holder = std::make_shared<const Buffer>(std::move(buf));
+        SendZeroCopyInLoop(holder, holder->Peek(), holder->ReadableBytes());
+        return;
+    }
+    size_t remaining = 0;
+    if (WriteDirectly(buf.Peek(), buf.ReadableBytes(), &remaining) && remaining > 0) {
+        size_t oldLen = outputQueue_.ReadableBytes();
+        if (remaining < kMinSliceBytes) {
+            outputQueue_.Append(buf.Peek() + buf.ReadableBytes() - remaining, remaining);
+        } else {
+            auto holder = std::make_shared<const Buffer>(std::move(buf));
+            outputQueue_.AppendSlice(holder, holder->Peek() + holder->ReadableBytes() - remaining, remaining);
         }
+        HandleQueued(oldLen);
+    }
+}
+
+void TcpConnection::SendSliceInLoop(std::shared_ptr<const void>&& holder, const char* data, size_t len) {
+    if (UseZeroCopy(len)) {
+        SendZeroCopyInLoop(std::move(holder), data, len);
+        return;
+    }
+    size_t remaining = 0;
+    if (WriteDirectly(data, len, &remaining) && remaining > 0) {
+        size_t oldLen = outputQueue_.ReadableBytes();
+        outputQueue_.AppendSlice(std::move(holder), data + len - remaining, remaining);
+        HandleQueued(oldLen);
+    }
+}
+
+void TcpConnection::SendZeroCopyInLoop(std::shared_ptr<const void>&& holder, const char* data, size_t len) {
+    GetEventLoop()->AssertInLoopThread();
+    if (state_ == disconnected) {
+        LOG_WARN << "disconnected, give up writing, connection[" << name_ << "]";
+        return;
+    }
+    size_t oldLen = outputQueue_.ReadableBytes();
+    outputQueue_.AppendSlice(std::move(holder), data, len);
+    HandleQueued(oldLen);
+    if (oldLen == 0) {
+        HandleWrite();
+    }
+}
+
+void TcpConnection::SendFile(int fd, off_t offset, size_t len) {
+    if (state_.load() == connected && len > 0) {
+        // the caller may close fd once this returns
+        int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dupfd < 0) {
+            LOG_SYSERR << "TcpConnection::SendFile, connection[" << name_ << "]";
+            return;
+        }
+        if (InOwnerLoop()) {
+            SendFileInLoop(dupfd, offset, len);
+        } else {
+            QueueInOwnerLoop([dupfd, offset, len](TcpConnection* conn) {
+                conn->SendFileInLoop(dupfd, offset, len);
+            });
+        }
+    }
+}
+
+void TcpConnection::SendFileInLoop(int fd, off_t offset, size_t len) {
+    GetEventLoop()->AssertInLoopThread();
+    if (state_ == disconnected) {
+        LOG_WARN << "disconnected, give up sending file, connection[" << name_ << "]";
+        ::close(fd);
+        return;
+    }
+    size_t oldLen = outputQueue_.ReadableBytes();
+    outputQueue_.AppendFile(fd, offset, len);
+    HandleQueued(oldLen);
+    if (oldLen == 0) {
+        HandleWrite();  // no writable notification comes in edge-triggered mode
+    }
+}
+
+void TcpConnection::ForwardTo(const TcpConnectionPtr& target) {
+    GetEventLoop()->AssertInLoopThread();
+    if (completionIo_) {
+        LOG_ERROR << "TcpConnection::ForwardTo[" << name_ << "] the poller receives for a connection in completion mode, "
+                "it can't be spliced";
+        return;
+    }
+    if (!target) {
+        forwardTarget_.reset();
+        forwardPipe_.reset();   // the bytes queued by target are still sent
+        ResumeForwarding();
+        return;
+    }
+    if (inputBuffer_.ReadableBytes() > 0) {
+        target->Send(inputBuffer_.Peek(), inputBuffer_.ReadableBytes());
+        inputBuffer_.RetrieveAll();
+    }
+    forwardTarget_ = target;
+    forwardPipe_ = std::make_shared<SplicePipe>();
+    // invoked in the loop thread of target, always enqueued since the target may be handling its events
+    // and the source may close in ResumeForwarding
+    forwardPipe_->SetResumeCallback([weakSelf = std::weak_ptr<TcpConnection>(shared_from_this())]() {
+        if (TcpConnectionPtr self = weakSelf.lock()) {
+            self->QueueInOwnerLoop([](TcpConnection* conn) { conn->ResumeForwarding(); });
+        }
+    });
+    // ahead of any bytes spliced into the pipe
+    target->RunInOwnerLoop([pipe = forwardPipe_](TcpConnection* conn) { conn->AddForwardSourceInLoop(pipe); });
+}
+
+void TcpConnection::AddForwardSourceInLoop(const std::shared_ptr<SplicePipe>& pipe) {
+    GetEventLoop()->AssertInLoopThread();
+    if (state_ == disconnected) {
+        pipe->CloseReader();
+        return;
+    }
+    forwardSources_.erase(std::remove_if(forwardSources_.begin(), forwardSources_.end(),
+        [](const std::weak_ptr<SplicePipe>& p) { return p.expired(); }), forwardSources_.end());
+    forwardSources_.push_back(pipe);
+}
+
+void TcpConnection::CloseForwardSources() {
+    for (const std::weak_ptr<SplicePipe>& weakPipe : forwardSources_) {
+        if (std::shared_ptr<SplicePipe> pipe = weakPipe.lock()) {
+            pipe->CloseReader();
+        }
+    }
+    forwardSources_.clear();
+}
+
+void TcpConnection::HandleForwardTargetClosed() {
+    LOG_INFO << "TcpConnection[" << name_ << "] the forward target is closed, close the connection";
+    forwardTarget_.reset();
+    forwardPipe_.reset();
+    forwardPaused_ = false;
+    if (state_ == connected || state_ == disconnecting) {
+        HandleClose();
+    }
+}
+
+void TcpConnection::ResumeForwarding() {
+    GetEventLoop()->AssertInLoopThread();
+    if (forwardPipe_ && forwardPipe_->ReaderClosed()) {
+        HandleForwardTargetClosed();
+        return;
+    }
+    if (forwardPaused_) {
+        forwardPaused_ = false;
+        if (state_ == connected || state_ == disconnecting) {
+            chan_->EnableReading();
+        }
+    }
+}
+
+void TcpConnection::HandleForwardRead(const ReceiveTimePoint_t& recv_timepoint) {
+    if (state_ != connected && state_ != disconnecting) {
+        return;
+    }
+    TcpConnectionPtr target = forwardTarget_.lock();
+    if (!target || forwardPipe_->ReaderClosed()) {
+        HandleForwardTargetClosed();
+        return;
+    }
+
+    std::shared_ptr<SplicePipe> pipe = forwardPipe_;
+    const int fd = socket_->FileDescriptor();
+    // level-triggered mode splices once per notification like ReadFd
+    const size_t budget = edgeTriggered_ ? ioBudget_ : pipe->Capacity();
+    size_t total = 0;
+    bool peerClosed = false;
+    while (total < budget) {
+        int savedErrno = 0;
+        ssize_t n = pipe->SpliceFrom(fd, budget - total, &savedErrno);
+        if (n > 0) {
+            total += static_cast<size_t>(n);
+            if (!edgeTriggered_) {
+                break;
+            }
+        } else if (n == 0) {
+            peerClosed = true;
+            break;
+        } else {
+            if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+                errno = savedErrno;
+                LOG_SYSERR << "TcpConnection::HandleForwardRead[" << name_ << "]";
+                HandleError();
+            } else {
+                SplicePipe::PauseResult result = pipe->PauseIfFull(fd, pipe->QueuedBytes());
+                if (result == SplicePipe::kPaused) {
+                    forwardPaused_ = true;
+                    chan_->disableReading();
+                } else if (result == SplicePipe::kRetry && edgeTriggered_) {
+                    continue;   // no more notification comes for the unread bytes
+                }
+            }
+            break;
+        }
+    }
+
+    if (total > 0) {
+        TouchIdle();
+        CountIoBytes(total);
+        target->RunInOwnerLoop([pipe, total](TcpConnection* conn) { conn->AppendPipeInLoop(pipe, total); });
+    }
+    if (peerClosed) {
+        HandleClose();
+    } else if (edgeTriggered_ && total >= budget) {
+        QueueInOwnerLoop([recv_timepoint](TcpConnection* conn) { conn->HandleRead(recv_timepoint); });
+    }
+}
+
+void TcpConnection::AppendPipeInLoop(const std::shared_ptr<SplicePipe>& pipe, size_t len) {
+    GetEventLoop()->AssertInLoopThread();
+    if (state_ == disconnected) {
+        pipe->CloseReader();
+        pipe->Discard(len);
+        return;
+    }
+    size_t oldLen = outputQueue_.ReadableBytes();
+    outputQueue_.AppendPipe(pipe, len);
+    HandleQueued(oldLen);
+    if (oldLen == 0) {
+        HandleWrite();
     }
 }
@@ -3,13 +3,18 @@
 
 #include <muduo/base/allocator/Allocatable.h>
 #include <muduo/Buffer.h>
+#include <muduo/OutputQueue.h>
+#include <muduo/SplicePipe.h>
 #include <muduo/InetAddr.h>
+#include <muduo/EventLoop.h>
 #include <muduo/TcpServer.h>  // for declare friend
 #include <muduo/TcpClient.h>  // for declare friend
 #include <muduo/Callbacks.h>
 #include <functional>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 #include <any>
 
 namespace muduo {
@@ -18,6 +23,9 @@ class EventLoop;        // forward declaration
 class Channel;
 class Socket;
 class TcpClient;
+namespace detail {
+class IdleConnectionWheel;  // forward declaration
+} // namespace detail
 
 class TcpConnection : public std::enable_shared_from_this<TcpConnection>
 #ifdef MUDUO_USE_MEMPOOL
@@ -26,11 +34,18 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection>
                     {
 #endif
     friend void TcpServer::HandleNewConnection(int connfd, const InetAddr& remote_addr);
+    friend void TcpServer::HandleAcceptedBatch();
     friend void TcpServer::RemoveConnectionInLoop(const TcpConnectionPtr& conn);
     friend TcpServer::~TcpServer() noexcept;
+    friend void TcpServer::StopLoopListener(LoopListener* listener);
+    friend uint64_t TcpServer::TakeConnectionActivity(EventLoop* loop, ConnectionActivityList* served);
+    friend void TcpServer::HandleLocalConnection(LoopListener* listener, int connfd, const InetAddr& remote_addr);
+    friend void TcpServer::RemoveLocalConnection(LoopListener* listener, const TcpConnectionPtr& conn);
+    friend void TcpServer::MigrateConnectionInLoop(const TcpConnectionPtr& conn, EventLoop* target);
     friend void TcpClient::HandleRemoveConnection(const TcpConnectionPtr& conn);
     friend void TcpClient::HandleConnectSuccessfully(int sockfd);
     friend TcpClient::~TcpClient() noexcept;
+    friend class detail::IdleConnectionWheel;
 
     /* non-copyable and non-moveable*/
     TcpConnection(const TcpConnection&) = delete;
@@ -40,10 +55,17 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection>
     enum State { connecting, connected, disconnecting, disconnected };
 
 public:
+    static const size_t kDefaultIoBudget = 256 * 1024;
+    /// unsent remainder shorter than it is copied into output queue, instead of holding the owner
+    static const size_t kMinSliceBytes = 1024;
+    /// the input buffer of an adaptive connection reserves at most it for the expected read size
+    static const size_t kMaxInputReserve = 256 * 1024;
+
     TcpConnection(EventLoop* owner, const std::string& name, int sockfd, const InetAddr& local_addr, const InetAddr& remote_addr);
     ~TcpConnection() noexcept;
 
-    EventLoop* GetEventLoop() { return loop_; }
+    /// @brief The loop serving the connection, changes if it's migrated, see TcpServer::MigrateConnection
+    EventLoop* GetEventLoop() const { return loop_.load(std::memory_order_acquire); }
     const InetAddr& GetLocalAddr() const { return localAddr_; } 
     const InetAddr& GetRemoteAddr() const { return remoteAddr_; } 
     const std::string& GetName() const { return name_; }
@@ -65,6 +87,54 @@ public:
     void SetHighWaterMarkCallback(size_t mark, const HighWaterMarkCallback_t& cb)
     { highWaterMark_ = mark; highWaterCb_ = cb; }
 
+    /// @brief Uses edge-triggered notification, reads/writes until EAGAIN on each wakeup
+    /// @note Must be called before the connection is established,
+    ///     falls back to level-triggered mode if the poller of loop doesn't support it
+    void SetEdgeTriggered(bool on)
+    { assert(state_ == connecting); edgeTriggered_ = on; }
+    bool IsEdgeTriggered() const
+    { return edgeTriggered_; }
+
+    /// @brief Lets the poller receive and send for the connection(completion mode), e.g. with io_uring:
+    /// a multishot recv request fills the buffers provided by the poller, which are copied into the input buffer,
+    /// and the output queue is sent by asynchronous sends submitted with the wait of loop,
+    /// so the connection costs no read(2)/write(2) of its own. Edge-triggered mode and zero-copy don't apply then
+    /// @note Must be called before the connection is established,
+    ///     falls back to readiness mode if the poller of loop doesn't support it, see EventLoop::SupportsCompletionIo
+    void SetCompletionIo(bool on)
+    { assert(state_ == connecting); completionIo_ = on; }
+    bool IsCompletionIo() const
+    { return completionIo_; }
+
+    /// @brief Sets the maximum bytes read(or written) per wakeup in edge-triggered mode,
+    /// the remaining IO is continued in the next loop iteration, for fairness between connections
+    void SetIoBudgetPerWakeup(size_t bytes)
+    { assert(bytes > 0); ioBudget_ = bytes; }
+
+    /// @brief Sizes the input buffer by the recent read sizes(on by default).
+    /// A drained input buffer of a connection receiving small messages is released,
+    /// so an idle connection holds no input storage, the reads go to the spill buffer of loop first.
+    /// A connection receiving large bursts reserves the expected read size before reading,
+    /// and shrinks when the reads get smaller.
+    void SetAdaptiveInputBuffer(bool on)
+    { adaptiveInputBuffer_ = on; }
+
+    /// @brief Sends payloads not shorter than threshold with MSG_ZEROCOPY, 0 disables it.
+    /// Only the payloads handed over with ownership are eligible, i.e. Send(std::string&&),
+    /// Send(Buffer&&), Send(std::shared_ptr<const void>, size_t) and SendSlice,
+    /// they are released after the kernel reports the completion instead of after written.
+    /// @note Must be called before the connection is established,
+    ///     disabled if the kernel doesn't support SO_ZEROCOPY
+    void SetZeroCopyThreshold(size_t threshold)
+    { assert(state_ == connecting); zeroCopyThreshold_ = threshold; }
+    size_t GetZeroCopyThreshold() const
+    { return zeroCopyThreshold_; }
+
+    /// @return number of zero-copy sends which the kernel completed by copying, e.g. over loopback
+    /// @note Must be called in the loop thread
+    uint64_t GetZeroCopyCopiedSends() const
+    { return outputQueue_.ZeroCopyCopiedSends(); }
+
 
     /// Thread-safe, can call cross-thread
     void Shutdown();
@@ -80,6 +150,46 @@ public:
     /// Thread-safe, can call cross-thread
     void Send(const char* buf, size_t len);
 
+    /// @brief Takes the ownership of message, the bytes are never copied
+    /// Thread-safe, can call cross-thread
+    void Send(std::string&& message);
+
+    /// @brief Takes the ownership of readable bytes of buf, the bytes are never copied
+    /// Thread-safe, can call cross-thread
+    void Send(Buffer&& buf);
+
+    /// @brief Sends [data.get(), data.get()+len) without copying,
+    /// the connection shares the ownership until the bytes are sent.
+    /// So a cached blob can be sent to many connections with no per-connection copy.
+    /// @note The memory must not be modified until it is sent.
+    /// Thread-safe, can call cross-thread
+    void Send(std::shared_ptr<const void> data, size_t len) {
+        const void* p = data.get();
+        SendSlice(std::move(data), p, len);
+    }
+
+    /// @brief Sends [data, data+len) owned by holder without copying, e.g. a part of a shared std::string
+    /// @note The memory must not be modified until it is sent.
+    /// Thread-safe, can call cross-thread
+    void SendSlice(std::shared_ptr<const void> holder, const void* data, size_t len);
+
+    /// @brief Sends [offset, offset+len) of file fd by sendfile(2), the bytes never enter user space.
+    /// The region is queued in order with other sent bytes, and counted by the high watermark.
+    /// @param fd a regular file, duplicated internally, so the caller can close it after this call
+    /// @note The connection is closed if the file is truncated before the region is sent
+    /// Thread-safe, can call cross-thread
+    void SendFile(int fd, off_t offset, size_t len);
+
+    /// @brief Forwards all received bytes to target with splice(2) through a kernel pipe,
+    /// without copying to user space, e.g. for proxying.
+    /// The message callback is no longer invoked, unread bytes in input buffer are sent to target first.
+    /// Reading is paused while the pipe is full, and resumed after target drained it.
+    /// Closing this connection shuts down the writing of target after the forwarded bytes,
+    /// and this connection is closed once target is closed OR destroyed.
+    /// @param target nullptr stops forwarding
+    /// @note Must be called in the loop thread of this connection, not available in completion mode
+    void ForwardTo(const TcpConnectionPtr& target);
+
 private:
     /// @note Only used by muduo::TcpServer
     void SetOnCloseCallback(const CloseCallback_t& cb)
@@ -87,18 +197,100 @@ private:
     void StepIntoEstablished();
     void StepIntoDestroyed();
     void ShutdownInLoop();
+    void SetupChannel();
+    /// @brief Applies SO_BUSY_POLL of the serving loop, see EventLoopOptions::socketBusyPoll
+    void SetupBusyPoll();
+
+    /// @brief Detaches from the current loop and attaches to target, see TcpServer::MigrateConnection.
+    /// The channel is removed from the poller and re-created in target, the buffered bytes are moved into
+    /// the blocks of target, the idle tracking moves to wheel(of target), and the load counters follow
+    /// @note Must be called in the loop thread, out of the event handling of the connection
+    /// @return false if the connection can't move: not connected, forwarding, already in target, in completion mode
+    ///     OR edge-triggered while target doesn't support it
+    bool MigrateInLoop(EventLoop* target, const std::shared_ptr<detail::IdleConnectionWheel>& wheel);
+    void AttachInLoop(EventLoop* target, const std::shared_ptr<detail::IdleConnectionWheel>& wheel);
+
+    /// @brief Whether the caller runs in the loop thread and the connection is not in transit
+    bool InOwnerLoop() const
+    { return !migrating_.load(std::memory_order_acquire) && GetEventLoop()->IsInLoopThread(); }
+    /// @brief Enqueues f(this) into the loop of connection, if the connection migrated before f runs,
+    /// f follows it to the new loop, so f always runs in the loop thread serving the connection
+    template <typename F>
+    void QueueInOwnerLoop(F&& f) {
+        GetEventLoop()->EnqueueEventLoop([guard = shared_from_this(), fn = std::forward<F>(f)]() mutable {
+            if (guard->GetEventLoop()->IsInLoopThread()) {
+                fn(guard.get());
+            } else {
+                guard->QueueInOwnerLoop(std::move(fn));
+            }
+        });
+    }
+    /// @brief Runs f(this) in place if InOwnerLoop, otherwise enqueues it, see QueueInOwnerLoop
+    template <typename F>
+    void RunInOwnerLoop(F&& f) {
+        if (InOwnerLoop()) {
+            f(this);
+        } else {
+            QueueInOwnerLoop(std::forward<F>(f));
+        }
+    }
 
     void SendInLoop(const char* buf, size_t len);
+    void SendInLoop(std::string&& message);
+    void SendInLoop(Buffer&& buf);
+    void SendSliceInLoop(std::shared_ptr<const void>&& holder, const char* data, size_t len);
+    void SendFileInLoop(int fd, off_t offset, size_t len);
+    /// @brief Queues the slice without writing directly, so that HandleWrite sends it with MSG_ZEROCOPY
+    void SendZeroCopyInLoop(std::shared_ptr<const void>&& holder, const char* data, size_t len);
+    bool UseZeroCopy(size_t len) const
+    { return zeroCopyThreshold_ > 0 && len >= zeroCopyThreshold_; }
+    /// @brief Queues len bytes spliced into pipe by the forwarding source
+    void AppendPipeInLoop(const std::shared_ptr<SplicePipe>& pipe, size_t len);
+    void HandleForwardRead(const ReceiveTimePoint_t& recv_timepoint);
+    void ResumeForwarding();
+    /// @brief Records a pipe which a source forwards to this connection, closed with this connection
+    void AddForwardSourceInLoop(const std::shared_ptr<SplicePipe>& pipe);
+    /// @brief Closes the reader side of the pipes forwarded to this connection, so their sources close
+    void CloseForwardSources();
+    /// @brief The forward target is gone, closes this connection
+    void HandleForwardTargetClosed();
+    ssize_t ReadInput(int* savedErrno);
+    /// @brief Releases OR shrinks the input buffer after the message callback
+    void AdjustInputBuffer();
+    size_t ExpectedReadSize() const;
+    /// @brief Writes directly to socket if the output queue is empty
+    /// @param remaining receives the number of bytes which need to be queued
+    /// @return false if the data must be dropped(disconnected or the peer reset)
+    bool WriteDirectly(const char* data, size_t len, size_t* remaining);
+    /// @brief Checks the high watermark and starts watching writable event after queueing
+    void HandleQueued(size_t oldLen);
+    /// @brief Takes the result of the in-flight send and submits the next one, HandleWrite of completion mode
+    void WriteByCompletion();
+    /// @brief Records activity for the idle timeout, O(1) and allocates nothing
+    void TouchIdle();
+    /// @brief Brings the pending output bytes of the loop load up to date with the output queue
+    void ReportOutputBytes();
+    /// @brief Counts the bytes read OR written for the activity of connection, may be called in any thread
+    void CountIoBytes(size_t bytes)
+    { ioBytes_.fetch_add(bytes, std::memory_order_relaxed); }
+    /// @brief The bytes read and written since the last call, see TcpServer::RebalanceLoops
+    uint64_t TakeIoBytes()
+    { return ioBytes_.exchange(0, std::memory_order_relaxed); }
 
     /* Reactor-handlers */
     void HandleClose();
     void HandleError();
     void HandleRead(const ReceiveTimePoint_t&);
     void HandleWrite();
+    void HandleWriteComplete();
+    /// @brief Keeps the in-flight zero-copy slices and a duplicate of the socket alive in the loop
+    /// until the kernel reports their completions, called on destruction
+    void LingerZeroCopySends();
 
 
 private:
-    EventLoop* loop_;
+    std::atomic<EventLoop*> loop_;  // written by the migration only, in the loop threads
+    std::atomic_bool migrating_ {false};    // from MigrateInLoop until AttachInLoop
     std::string name_;
     InetAddr localAddr_;
     InetAddr remoteAddr_;
@@ -112,9 +304,30 @@ private:
     WriteCompleteCallback_t writeCompleteCb_ {nullptr};
     HighWaterMarkCallback_t highWaterCb_ {nullptr};
     size_t highWaterMark_ {0};
+    bool edgeTriggered_ {false};
+    bool completionIo_ {false};
+    bool sendInFlight_ {false};     // only for completion mode
+    size_t ioBudget_ {kDefaultIoBudget};  // only for edge-triggered mode
+    size_t zeroCopyThreshold_ {0};
+    bool zeroCopyWriteComplete_ {false};    // drained, the write-complete waits for the zero-copy completions
+    bool adaptiveInputBuffer_ {true};
+    size_t avgReadBytes_ {0};   // moving average of bytes per read, weight of the latest read is 1/8
+    std::atomic<uint64_t> ioBytes_ {0};    // read and written since taken by the rebalancing of TcpServer
 
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    OutputQueue outputQueue_;   // unsent bytes, flushed with writev(2)
+    size_t reportedOutputBytes_ {0};    // the part of LoopLoad::PendingOutputBytes of this connection
+    std::weak_ptr<TcpConnection> forwardTarget_;
+    std::shared_ptr<SplicePipe> forwardPipe_ {nullptr};    // not null in forwarding mode
+    bool forwardPaused_ {false};    // reading is disabled since the pipe is full
+    std::vector<std::weak_ptr<SplicePipe>> forwardSources_;   // the pipes forwarded to this connection
+
+    /* idle timeout, see TcpServer::SetIdleTimeout */
+    std::shared_ptr<detail::IdleConnectionWheel> idleWheel_ {nullptr};
+    uint64_t lastActiveTick_ {0};
+    TcpConnection* idlePrev_ {nullptr};
+    TcpConnection* idleNext_ {nullptr};
+    TcpConnection** idleSlot_ {nullptr};    // the bucket of wheel, nullptr if not tracked
 };
 
 } // namespace muduo 
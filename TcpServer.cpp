@@ -1,13 +1,60 @@
 #include <muduo/EventLoopThreadPool.h>
 #include <muduo/base/SocketOps.h>
+#include <muduo/IdleConnectionWheel.h>
 #include <muduo/TcpConnection.h>
 #include <muduo/TcpServer.h>
 #include <muduo/EventLoop.h>
 #include <muduo/Acceptor.h>
 #include <muduo/InetAddr.h>
+#include <algorithm>
+#include <future>
 
 using namespace muduo;
 
+const size_t TcpServer::kMaxMigrationsPerRebalance;
+
+namespace {
+
+/// runs cb in loop and waits until it's done
+template <typename Callback>
+void RunInLoopAndWait(EventLoop* loop, Callback&& cb) {
+    std::promise<void> done;
+    loop->RunInEventLoop([&cb, &done]() {
+        cb();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+} // namespace
+
+/// The listener of an IO-loop and the connections it accepted, in reuse-port mode.
+/// Created, accessed and destroyed only in the loop-thread.
+#ifdef MUDUO_USE_MEMPOOL
+struct TcpServer::LoopListener : public base::detail::Allocatable {
+#else
+struct TcpServer::LoopListener {
+#endif
+    LoopListener(EventLoop* owner, size_t idx, const InetAddr& addr)
+        : loop(owner)
+        , index(idx)
+#ifdef MUDUO_USE_MEMPOOL
+        , acceptor(new (owner->GetMemoryPool()) Acceptor(owner, addr, true))
+        , conns(owner->GetMemoryPool())
+#else
+        , acceptor(std::make_unique<Acceptor>(owner, addr, true))
+        , conns()
+#endif
+    { }
+
+    EventLoop* const loop;
+    const size_t index;     // of the loop, and of the listener in the reuse-port group
+    std::unique_ptr<Acceptor> acceptor;
+    ConnectionsMap conns;
+    std::shared_ptr<detail::IdleConnectionWheel> idleWheel;
+    uint64_t nextConnID {0};
+};
+
 std::unique_ptr<TcpServer> TcpServer::Create(EventLoop* loop, const InetAddr& addr, const std::string& name) {
 #ifdef MUDUO_USE_MEMPOOL
     return std::unique_ptr<TcpServer>(new (loop->GetMemoryPool()) TcpServer(loop, addr, name));
@@ -24,19 +71,31 @@ TcpServer::TcpServer(EventLoop* loop, const InetAddr& addr, const std::string& n
     , acceptor_(new (loop_->GetMemoryPool()) Acceptor(loop_, addr_, true))   // FIXME: set "option reuse-port" by evnironment-variable  
     , ioThreadPool_(new (loop_->GetMemoryPool()) EventLoopThreadPool(loop_, name_))
     , conns_(loop_->GetMemoryPool())
+    , idleWheels_(loop_->GetMemoryPool())
+    , loopListeners_(loop_->GetMemoryPool())
+    , pendingEstablishments_(loop_->GetMemoryPool())
+    , loopBusyTimes_(loop_->GetMemoryPool())
 #else
     , acceptor_(std::make_unique<Acceptor>(loop_, addr_, true))   // FIXME: set "option reuse-port" by evnironment-variable  
     , ioThreadPool_(std::make_unique<EventLoopThreadPool>(loop, name_))
     , conns_()
+    , idleWheels_()
+    , loopListeners_()
+    , pendingEstablishments_()
+    , loopBusyTimes_()
 #endif
+    , ioBudget_(TcpConnection::kDefaultIoBudget)
+    , maxAcceptsPerWakeup_(Acceptor::kDefaultMaxAcceptsPerWakeup)
 {
 #ifdef MUDUO_USE_MEMPOOL
     // the TcpServer instance must be constructed in the thread which equal to the thread of specific EventLoop,
     // so that thread-safely use mempool of loop
     loop->AssertInLoopThread();
 #endif
+    addr_ = acceptor_->GetListeningAddr();   // the reuse-port listeners of IO-loops bind the same port
     acceptor_->SetNewConnectionCallback(std::bind(&TcpServer::HandleNewConnection, this,
         std::placeholders::_1, std::placeholders::_2));    
+    acceptor_->SetAcceptedBatchCallback(std::bind(&TcpServer::HandleAcceptedBatch, this));
 }
 
 TcpServer::~TcpServer() noexcept {
@@ -46,10 +105,23 @@ TcpServer::~TcpServer() noexcept {
     loop_->AssertInLoopThread();
     
     LOG_TRACE << "TcpServer[" << this << "] is destructing";
+    if (rebalanceTimer_ >= 0) {
+        loop_->cancelTimer(rebalanceTimer_);
+    }
+    for (auto& item : idleWheels_) {
+        item.second->Stop();    // the wheel lives on until its connections are destroyed
+    }
     for (auto& item : conns_) {
         TcpConnectionPtr cur_conn(item.second);
         item.second.reset();
-        cur_conn->GetEventLoop()->RunInEventLoop(std::bind(&TcpConnection::StepIntoDestroyed, cur_conn));
+        cur_conn->RunInOwnerLoop([](TcpConnection* conn) { conn->StepIntoDestroyed(); });
+    }
+    // waits, so no listener calls back into this TcpServer after it's gone
+    for (auto& listener : loopListeners_) {
+        RunInLoopAndWait(listener->loop, [this, &listener]() {
+            StopLoopListener(listener.get());
+            listener.reset();
+        });
     }
 }
 
@@ -61,43 +133,95 @@ std::string TcpServer::GetIpPort() const {
     return acceptor_->GetIpPort();
 }
 
+const InetAddr& TcpServer::GetListeningAddr() const {
+    return acceptor_->GetListeningAddr();
+}
+
+#ifdef MUDUO_USE_MEMPOOL
+base::MemoryPoolStats TcpServer::GetMemoryPoolStats() const {
+    return ioThreadPool_->GetMemoryPoolStats();
+}
+#endif
+
 void TcpServer::HandleNewConnection(int connfd, const InetAddr& remote_addr) {
     loop_->AssertInLoopThread();
     std::string new_conn_name = name_ + remote_addr.GetIpPort() + "@" + std::to_string(nextConnID_++); 
+    EventLoop* next_loop = nullptr;
+    switch (ioThreadPool_->GetLoopSelection()) {
+    case LoopSelection::kHashHint:
+        next_loop = ioThreadPool_->GetNextLoop(remote_addr.GetIpHash());
+        break;
+    case LoopSelection::kIncomingCpu:
+        next_loop = ioThreadPool_->GetNextLoop(static_cast<size_t>(sockets::getIncomingCpu(connfd)));
+        break;
+    default:
+        next_loop = ioThreadPool_->GetNextLoop();
+    }
+    TcpConnectionPtr new_conn_ptr = NewConnection(loop_, next_loop, new_conn_name, connfd, remote_addr);
+
+    LOG_INFO << "TcpServer::HandleNewConnection: new connection [" << new_conn_name << "] from " << remote_addr.GetIpPort();
+    conns_[new_conn_name] = new_conn_ptr;   // add current connection to list
+    new_conn_ptr->SetOnCloseCallback(std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1));
+    if (idleTimeout_ > Interval_t::zero()) {
+        new_conn_ptr->idleWheel_ = GetIdleWheel(next_loop);
+    }
+
+    // established by HandleAcceptedBatch, after the acceptor drained the wakeup
+    auto it = std::find_if(pendingEstablishments_.begin(), pendingEstablishments_.end(),
+        [next_loop](const PendingEstablishments::value_type& item) { return item.first == next_loop; });
+    if (it == pendingEstablishments_.end()) {
+#ifdef MUDUO_USE_MEMPOOL
+        pendingEstablishments_.emplace_back(next_loop, ConnectionList(loop_->GetMemoryPool()));
+#else
+        pendingEstablishments_.emplace_back(next_loop, ConnectionList());
+#endif
+        it = pendingEstablishments_.end() - 1;
+    }
+    it->second.push_back(std::move(new_conn_ptr));
+}
+
+void TcpServer::HandleAcceptedBatch() {
+    loop_->AssertInLoopThread();
+    for (auto& item : pendingEstablishments_) {
+        // a single cross-thread enqueue(and wakeup) per loop for the whole batch
+        item.first->RunInEventLoop([conns = std::move(item.second)]() {
+            for (const TcpConnectionPtr& conn : conns) {
+                conn->StepIntoEstablished();
+            }
+        });
+    }
+    pendingEstablishments_.clear();
+}
+
+TcpConnectionPtr TcpServer::NewConnection(EventLoop* accept_loop, EventLoop* io_loop, const std::string& name,
+                                          int connfd, const InetAddr& remote_addr) {
+    accept_loop->AssertInLoopThread();
     InetAddr local_addr(sockets::getLocalAddr(connfd));
-    EventLoop* next_loop = ioThreadPool_->GetNextLoop();
 
     TcpConnectionPtr new_conn_ptr;
 #ifdef MUDUO_USE_MEMPOOL
-    assert(loop_->GetMemoryPool());
-    // the TcpConnection instance be allocated from memory pool of master-reactor,
-    // so it must be deallocated in the thread where the master-reactor is located
-    new_conn_ptr = std::shared_ptr<muduo::TcpConnection>(new (loop_->GetMemoryPool()) TcpConnection(next_loop, new_conn_name, connfd, local_addr, remote_addr),
-        [main_loop = loop_](TcpConnection* conn) {
-            // destroys the connection instance
-            conn->~TcpConnection();
-            // thread-safely deallocate the storage
-            main_loop->RunInEventLoop([main_loop, ptr = conn]() {
-                main_loop->GetMemoryPool()->deallocate(ptr, sizeof(TcpConnection));
-            });
-        });
+    assert(accept_loop->GetMemoryPool());
+    // the TcpConnection instance be allocated from memory pool of the accepting loop,
+    // the io-loop frees it to the remote list of the pool directly, without waking up the accepting loop
+    new_conn_ptr = std::shared_ptr<muduo::TcpConnection>(new (accept_loop->GetMemoryPool()) TcpConnection(io_loop, name, connfd, local_addr, remote_addr));
 #else
     // The TcpConnection instance be allocated from heap
-    new_conn_ptr = std::make_shared<TcpConnection>(next_loop, new_conn_name, connfd, local_addr, remote_addr);
+    new_conn_ptr = std::make_shared<TcpConnection>(io_loop, name, connfd, local_addr, remote_addr);
 #endif
 
-    LOG_INFO << "TcpServer::HandleNewConnection: new connection [" << new_conn_name << "] from " << remote_addr.GetIpPort();
-    conns_[new_conn_name] = new_conn_ptr;   // add current connection to list
     new_conn_ptr->SetConnectionCallback(connectionCb_);
     new_conn_ptr->SetOnMessageCallback(messageCb_);
-    new_conn_ptr->SetOnCloseCallback(std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1));
     new_conn_ptr->SetWriteCompleteCallback(writeCompleteCb_);
-    
-    next_loop->RunInEventLoop(std::bind(&TcpConnection::StepIntoEstablished, new_conn_ptr));
+    new_conn_ptr->SetEdgeTriggered(edgeTriggered_);
+    new_conn_ptr->SetCompletionIo(completionIo_);
+    new_conn_ptr->SetIoBudgetPerWakeup(ioBudget_);
+    new_conn_ptr->SetZeroCopyThreshold(zeroCopyThreshold_);
+    return new_conn_ptr;
 }
 
 void TcpServer::RemoveConnection(const TcpConnectionPtr& conn) {
-    loop_->RunInEventLoop(std::bind(&TcpServer::RemoveConnectionInLoop, this, conn));
+    // closing goes ahead of the pending callbacks, it releases the connection sooner
+    loop_->RunInEventLoop(std::bind(&TcpServer::RemoveConnectionInLoop, this, conn), CallbackPriority::kHigh);
 }
 
 void TcpServer::RemoveConnectionInLoop(const TcpConnectionPtr& conn) {
@@ -106,7 +230,220 @@ void TcpServer::RemoveConnectionInLoop(const TcpConnectionPtr& conn) {
         << "] - connection [" << conn->GetName() << "]";
     int ret = conns_.erase(conn->GetName());
     assert(ret == 1); (void)ret;
-    conn->GetEventLoop()->RunInEventLoop(std::bind(&TcpConnection::StepIntoDestroyed, conn));
+    conn->RunInOwnerLoop([](TcpConnection* c) { c->StepIntoDestroyed(); });
+}
+
+void TcpServer::MigrateConnection(const TcpConnectionPtr& conn, EventLoop* target) {
+    loop_->RunInEventLoop([this, conn, target]() { MigrateConnectionInLoop(conn, target); });
+}
+
+void TcpServer::MigrateConnectionInLoop(const TcpConnectionPtr& conn, EventLoop* target) {
+    loop_->AssertInLoopThread();
+    auto it = conns_.find(conn->GetName());
+    if (it == conns_.end() || it->second != conn) {
+        return; // closed, OR accepted by a reuse-port listener
+    }
+    std::shared_ptr<detail::IdleConnectionWheel> wheel;
+    if (idleTimeout_ > Interval_t::zero()) {
+        wheel = GetIdleWheel(target);
+    }
+    // always enqueued, so the connection leaves its loop out of its event handling
+    conn->QueueInOwnerLoop([target, wheel](TcpConnection* c) {
+        if (!c->MigrateInLoop(target, wheel)) {
+            LOG_DEBUG << "TcpServer::MigrateConnection - connection [" << c->GetName() << "] stays in its loop";
+        }
+    });
+}
+
+void TcpServer::RebalanceLoops() {
+    loop_->AssertInLoopThread();
+    using namespace std::chrono;
+    const std::vector<EventLoop*> io_loops = ioThreadPool_->GetAllLoops();
+    const TimePoint_t now = steady_clock::now();
+    const nanoseconds period = duration_cast<nanoseconds>(now - lastRebalance_);
+    const bool sampled = loopBusyTimes_.size() == io_loops.size();
+    lastRebalance_ = now;
+    loopBusyTimes_.resize(io_loops.size());
+
+    size_t busiest = 0;
+    size_t idlest = 0;
+    nanoseconds busiest_busy = nanoseconds::min();
+    nanoseconds idlest_busy = nanoseconds::max();
+    for (size_t i = 0; i < io_loops.size(); i++) {
+        const nanoseconds total = io_loops[i]->GetLoad().BusyTime();
+        const nanoseconds busy = total - loopBusyTimes_[i];
+        loopBusyTimes_[i] = total;
+        if (busy > busiest_busy) {
+            busiest = i;
+            busiest_busy = busy;
+        }
+        if (busy < idlest_busy) {
+            idlest = i;
+            idlest_busy = busy;
+        }
+    }
+    if (!sampled || period <= nanoseconds::zero()) {
+        TakeConnectionActivity(nullptr, nullptr);
+        return; // the first round takes the samples only
+    }
+    const double gap = static_cast<double>((busiest_busy - idlest_busy).count()) / static_cast<double>(period.count());
+    const size_t busiest_conns = io_loops[busiest]->GetLoad().Connections();
+    if (gap <= rebalanceThreshold_ || busiest_conns < 2) {
+        TakeConnectionActivity(nullptr, nullptr);
+        return; // moving the only connection just moves the hot spot
+    }
+
+#ifdef MUDUO_USE_MEMPOOL
+    ConnectionActivityList candidates(loop_->GetMemoryPool());
+#else
+    ConnectionActivityList candidates;
+#endif
+    const uint64_t busiest_bytes = TakeConnectionActivity(io_loops[busiest], &candidates);
+    // moving this part of the load evens the two loops out
+    const double part = static_cast<double>((busiest_busy - idlest_busy).count()) / (2.0 * static_cast<double>(busiest_busy.count()));
+    size_t moves = 0;
+    if (busiest_bytes > 0) {
+        // the most active connections first, each one which fits in the part of bytes to move.
+        // A connection carrying more than the part alone stays, moving it just moves the hot spot
+        std::sort(candidates.begin(), candidates.end(),
+                [](const ConnectionActivity& a, const ConnectionActivity& b) { return a.first > b.first; });
+        const uint64_t budget = static_cast<uint64_t>(static_cast<double>(busiest_bytes) * part);
+        uint64_t moved_bytes = 0;
+        for (const ConnectionActivity& candidate : candidates) {
+            if (moves == kMaxMigrationsPerRebalance || candidate.first == 0) {
+                break;
+            }
+            if (moved_bytes + candidate.first <= budget) {
+                MigrateConnectionInLoop(candidate.second, io_loops[idlest]);
+                moved_bytes += candidate.first;
+                moves++;
+            }
+        }
+    } else {
+        // the loop is busy with anything but the IO of its connections(e.g. timers), which can't be told apart,
+        // supposing they load their loop equally
+        moves = static_cast<size_t>(static_cast<double>(busiest_conns) * part);
+        moves = std::min(std::max(moves, size_t(1)), std::min(candidates.size(), kMaxMigrationsPerRebalance));
+        for (size_t i = 0; i < moves; i++) {
+            MigrateConnectionInLoop(candidates[i].second, io_loops[idlest]);
+        }
+    }
+    LOG_INFO << "TcpServer::RebalanceLoops [" << name_ << "] moves " << moves << " connections from loop "
+        << busiest << " to " << idlest << ", busy share gap " << gap << ", " << busiest_bytes << " bytes of IO";
+}
+
+uint64_t TcpServer::TakeConnectionActivity(EventLoop* loop, ConnectionActivityList* served) {
+    // taken from every connection in each round, so the bytes never pile up over rounds
+    uint64_t total = 0;
+    for (auto& item : conns_) {
+        const uint64_t bytes = item.second->TakeIoBytes();
+        if (served != nullptr && item.second->GetEventLoop() == loop) {
+            served->emplace_back(bytes, item.second);
+            total += bytes;
+        }
+    }
+    return total;
+}
+
+const std::shared_ptr<detail::IdleConnectionWheel>& TcpServer::GetIdleWheel(EventLoop* loop) {
+    loop_->AssertInLoopThread();
+    auto it = idleWheels_.find(loop);
+    if (it == idleWheels_.end()) {
+        it = idleWheels_.emplace(loop, detail::IdleConnectionWheel::Create(loop, idleTimeout_)).first;
+    }
+    return it->second;
+}
+
+void TcpServer::StartListening() {
+    loop_->AssertInLoopThread();
+    const std::vector<EventLoop*> io_loops = ioThreadPool_->GetAllLoops();
+    if (!reusePortListeners_ || io_loops.front() == loop_) {
+        acceptor_->SetMaxAcceptsPerWakeup(maxAcceptsPerWakeup_);
+        acceptor_->SetCompletionIo(completionIo_);
+        acceptor_->Listen();
+        if (rebalanceInterval_ > Interval_t::zero() && io_loops.size() > 1) {
+            RebalanceLoops();   // takes the first samples
+            rebalanceTimer_ = loop_->RunEvery(rebalanceInterval_, std::bind(&TcpServer::RebalanceLoops, this));
+        }
+        return;
+    }
+
+    // the base acceptor keeps the address bound but never listens, so it isn't a member of the reuse-port group.
+    // The listeners join the group one by one in the order of loops, so the index of a listener in the group is its loop's
+    for (size_t i = 0; i < io_loops.size(); i++) {
+        EventLoop* io_loop = io_loops[i];
+        LoopListener* listener = nullptr;
+        RunInLoopAndWait(io_loop, [this, io_loop, i, &io_loops, &listener]() {
+#ifdef MUDUO_USE_MEMPOOL
+            listener = new (io_loop->GetMemoryPool()) LoopListener(io_loop, i, addr_);
+#else
+            listener = new LoopListener(io_loop, i, addr_);
+#endif
+            StartLoopListener(listener, io_loops.size(), ioThreadPool_->GetLoopCpu(i));
+        });
+        loopListeners_.emplace_back(listener);
+    }
+}
+
+void TcpServer::StartLoopListener(LoopListener* listener, size_t group_size, int cpu) {
+    listener->loop->AssertInLoopThread();
+    listener->acceptor->SetNewConnectionCallback(std::bind(&TcpServer::HandleLocalConnection, this, listener,
+        std::placeholders::_1, std::placeholders::_2));
+    if (idleTimeout_ > Interval_t::zero()) {
+        listener->idleWheel = detail::IdleConnectionWheel::Create(listener->loop, idleTimeout_);
+    }
+    listener->acceptor->SetMaxAcceptsPerWakeup(maxAcceptsPerWakeup_);
+    listener->acceptor->SetCompletionIo(completionIo_);
+    if (reusePortIncomingCpu_ && cpu >= 0 && !listener->acceptor->SetIncomingCpu(cpu)) {
+        LOG_WARN << "TcpServer[" << name_ << "] failed to align the listener of loop " << listener->index
+            << " with cpu " << cpu;
+    }
+    listener->acceptor->Listen();
+    // the program is shared by the group, attaches it once all the listeners joined
+    if (reusePortCpuSteering_ && listener->index + 1 == group_size) {
+        if (!listener->acceptor->AttachReusePortCpuSteering(group_size)) {
+            LOG_WARN << "TcpServer[" << name_ << "] failed to attach CPU steering to the reuse-port listeners, "
+                "fall back to the kernel's hashing";
+        }
+    }
+}
+
+void TcpServer::StopLoopListener(LoopListener* listener) {
+    listener->loop->AssertInLoopThread();
+    listener->acceptor.reset();
+    if (listener->idleWheel) {
+        listener->idleWheel->Stop();
+    }
+    for (auto& item : listener->conns) {
+        TcpConnectionPtr cur_conn(item.second);
+        item.second.reset();
+        cur_conn->StepIntoDestroyed();
+    }
+    listener->conns.clear();
+}
+
+void TcpServer::HandleLocalConnection(LoopListener* listener, int connfd, const InetAddr& remote_addr) {
+    listener->loop->AssertInLoopThread();
+    std::string new_conn_name = name_ + remote_addr.GetIpPort() + "@"
+        + std::to_string(listener->index) + "." + std::to_string(listener->nextConnID++);
+    // allocated from the pool of the IO-loop, which is also the one freeing it
+    TcpConnectionPtr new_conn_ptr = NewConnection(listener->loop, listener->loop, new_conn_name, connfd, remote_addr);
+
+    LOG_INFO << "TcpServer::HandleLocalConnection: new connection [" << new_conn_name << "] from " << remote_addr.GetIpPort();
+    listener->conns[new_conn_name] = new_conn_ptr;
+    new_conn_ptr->SetOnCloseCallback(std::bind(&TcpServer::RemoveLocalConnection, this, listener, std::placeholders::_1));
+    new_conn_ptr->idleWheel_ = listener->idleWheel;
+    new_conn_ptr->StepIntoEstablished();
+}
+
+void TcpServer::RemoveLocalConnection(LoopListener* listener, const TcpConnectionPtr& conn) {
+    listener->loop->AssertInLoopThread();
+    LOG_INFO << "TcpServer::RemoveLocalConnection [" << name_
+        << "] - connection [" << conn->GetName() << "]";
+    size_t ret = listener->conns.erase(conn->GetName());
+    assert(ret == 1); (void)ret;
+    // not in place, it's called back by TcpConnection::HandleClose
+    conn->QueueInOwnerLoop([](TcpConnection* c) { c->StepIntoDestroyed(); });
 }
 
 void TcpServer::ListenAndServe() {
@@ -116,7 +453,7 @@ void TcpServer::ListenAndServe() {
         loop_->RunInEventLoop(std::bind(&EventLoopThreadPool::BuildAndRun, ioThreadPool_.get()));
 
         // start listening
-        loop_->RunInEventLoop(std::bind(&Acceptor::Listen, acceptor_.get()));
+        loop_->RunInEventLoop(std::bind(&TcpServer::StartListening, this));
     }
 }
 
@@ -128,3 +465,22 @@ void TcpServer::SetIoThreadNum(int n) {
 void TcpServer::SetIothreadInitCallback(const IoThreadInitCallback_t& cb) {
     ioThreadPool_->SetThreadInitCallback(cb);
 }
+
+void TcpServer::SetLoopSelection(LoopSelection selection) {
+    assert(!serving_);
+    ioThreadPool_->SetLoopSelection(selection);
+}
+
+void TcpServer::SetIoThreadCpus(const std::vector<int>& cpus) {
+    assert(!serving_);
+    ioThreadPool_->SetThreadCpus(cpus);
+}
+
+void TcpServer::SetIoThreadNumaLocalMemory(bool on) {
+    assert(!serving_);
+    ioThreadPool_->SetNumaLocalMemory(on);
+}
+
+void TcpServer::SetIoLoopOptions(const EventLoopOptions& options) {
+    ioThreadPool_->SetLoopOptions(options);
+}
@@ -5,39 +5,74 @@
 #include <muduo/base/allocator/sgi_stl_alloc.h>
 #include <muduo/InetAddr.h>
 #include <muduo/Callbacks.h>
+#include <muduo/EventLoopOptions.h>
+#include <muduo/EventLoopThreadPool.h>
+#include <muduo/TimerType.h>
 #include <unordered_map>
+#include <cassert>
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <vector>
 
 namespace muduo {
 
 class EventLoop;        // forward declaration
 class Acceptor;         // forward declaration
 class TcpConnection;    // forward declaration
-class EventLoopThreadPool;  // forward declaration
+namespace detail {
+class IdleConnectionWheel;  // forward declaration
+} // namespace detail
 
 /// @brief A non-copyable TCP-Server
 /// single-Reactor mode, Acceptor and IO-handler run in same thread
+/// with IO-threads, the base loop accepts and hands connections to the IO-loops by default,
+/// or each IO-loop accepts its own, see TcpServer::SetReusePortListeners
 #ifdef MUDUO_USE_MEMPOOL
 class TcpServer : public base::detail::Allocatable {
+    struct LoopListener;    // the listener and connections of an IO-loop, see SetReusePortListeners
     using ConnectionsMap = std::unordered_map<std::string, TcpConnectionPtr, 
                                             std::hash<std::string>, std::equal_to<std::string>,
                                             base::allocator<std::pair<const std::string, TcpConnectionPtr>>>;
+    using IdleWheelMap = std::unordered_map<EventLoop*, std::shared_ptr<detail::IdleConnectionWheel>,
+                                            std::hash<EventLoop*>, std::equal_to<EventLoop*>,
+                                            base::allocator<std::pair<EventLoop* const, std::shared_ptr<detail::IdleConnectionWheel>>>>;
+    using LoopListenerList = std::vector<std::unique_ptr<LoopListener>, base::allocator<std::unique_ptr<LoopListener>>>;
+    using ConnectionList = std::vector<TcpConnectionPtr, base::allocator<TcpConnectionPtr>>;
+    using PendingEstablishments = std::vector<std::pair<EventLoop*, ConnectionList>,
+                                            base::allocator<std::pair<EventLoop*, ConnectionList>>>;
+    using BusyTimeList = std::vector<std::chrono::nanoseconds, base::allocator<std::chrono::nanoseconds>>;
+    using ConnectionActivity = std::pair<uint64_t, TcpConnectionPtr>;     // bytes of IO since the last rebalancing
+    using ConnectionActivityList = std::vector<ConnectionActivity, base::allocator<ConnectionActivity>>;
 #else
 class TcpServer {
+    struct LoopListener;    // the listener and connections of an IO-loop, see SetReusePortListeners
     using ConnectionsMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using IdleWheelMap = std::unordered_map<EventLoop*, std::shared_ptr<detail::IdleConnectionWheel>>;
+    using LoopListenerList = std::vector<std::unique_ptr<LoopListener>>;
+    using ConnectionList = std::vector<TcpConnectionPtr>;
+    using PendingEstablishments = std::vector<std::pair<EventLoop*, ConnectionList>>;
+    using BusyTimeList = std::vector<std::chrono::nanoseconds>;
+    using ConnectionActivity = std::pair<uint64_t, TcpConnectionPtr>;     // bytes of IO since the last rebalancing
+    using ConnectionActivityList = std::vector<ConnectionActivity>;
 #endif
     friend TcpConnection;
     TcpServer(const TcpServer&) = delete;
     TcpServer& operator=(const TcpServer&) = delete;
 
 public:
+    /// the connections moved by a round of rebalancing at most, see SetRebalanceInterval
+    static const size_t kMaxMigrationsPerRebalance = 16;
+    static constexpr double kDefaultRebalanceThreshold = 0.2;
+
     static std::unique_ptr<TcpServer> Create(EventLoop* loop, const InetAddr& addr, const std::string& name);
 
     explicit TcpServer(EventLoop* loop, const InetAddr& addr, const std::string& name);
     ~TcpServer() noexcept;  // force out-line dtor, for std::unique_ptr members.
     std::string GetIp() const;
     std::string GetIpPort() const;
+    /// @brief The address listened on, a listening port 0 reads back the one chosen by the kernel
+    const InetAddr& GetListeningAddr() const;
 
     /// start io-threads and listening 
     /// @note Enables cross-thread invocation and utilizes Compare-and-Swap (CAS) internally,
@@ -50,6 +85,10 @@ public:
     /// must call before TcpServer::ListenAndServe
     void SetIothreadInitCallback(const IoThreadInitCallback_t& cb);
 
+    /// @brief Settings of the loops of IO-threads, e.g. the timer backend
+    /// must call before TcpServer::ListenAndServe
+    void SetIoLoopOptions(const EventLoopOptions& options);
+
     void SetConnectionCallback(const ConnectionCallback_t& cb)
     { connectionCb_ = cb; }
     void SetOnMessageCallback(const MessageCallback_t& cb)
@@ -57,10 +96,132 @@ public:
     void SetOnWriteCompleteCallback(const WriteCompleteCallback_t& cb)
     { writeCompleteCb_ = cb; }
 
+    /// @brief New connections use edge-triggered mode, see TcpConnection::SetEdgeTriggered
+    void SetEdgeTriggered(bool on)
+    { edgeTriggered_ = on; }
+
+    /// @brief The listeners accept and the new connections receive and send by the poller(e.g. io_uring),
+    /// see Acceptor::SetCompletionIo and TcpConnection::SetCompletionIo.
+    /// The connections in completion mode aren't moved by the rebalancing
+    /// @note must call before TcpServer::ListenAndServe
+    void SetCompletionIo(bool on)
+    { assert(!serving_); completionIo_ = on; }
+
+    /// @brief Sets per-wakeup IO budget of new connections, see TcpConnection::SetIoBudgetPerWakeup
+    void SetIoBudgetPerWakeup(size_t bytes)
+    { ioBudget_ = bytes; }
+
+    /// @brief Sets zero-copy threshold of new connections, see TcpConnection::SetZeroCopyThreshold
+    void SetZeroCopyThreshold(size_t threshold)
+    { zeroCopyThreshold_ = threshold; }
+
+    /// @brief Closes the connections which neither read nor wrote anything for longer than timeout,
+    /// zero(by default) disables it.
+    /// Each IO-loop tracks its connections with a bucketed wheel of timeout/8 granularity,
+    /// so a connection is closed within (timeout, timeout + timeout/8],
+    /// and the activity of a connection costs O(1) without any timer per connection.
+    /// @note must call before TcpServer::ListenAndServe
+    void SetIdleTimeout(const detail::Interval_t& timeout)
+    { assert(!serving_); idleTimeout_ = timeout; }
+
+    /// @brief How the IO-loop of a new connection is picked, round-robin by default.
+    /// With LoopSelection::kHashHint, the connections from the same host go to the same loop,
+    /// with LoopSelection::kIncomingCpu, a connection goes to the loop pinned to the CPU receiving its packets
+    /// @note must call before TcpServer::ListenAndServe
+    void SetLoopSelection(LoopSelection selection);
+
+    /// @brief Pins the IO-threads to the CPUs, see EventLoopThreadPool::SetThreadCpus
+    /// must call before TcpServer::ListenAndServe
+    void SetIoThreadCpus(const std::vector<int>& cpus);
+
+    /// @brief see EventLoopThreadPool::SetNumaLocalMemory
+    /// must call before TcpServer::ListenAndServe
+    void SetIoThreadNumaLocalMemory(bool on);
+
+    /// @brief The connections accepted per wakeup of a listener at most, see Acceptor::SetMaxAcceptsPerWakeup
+    /// @note must call before TcpServer::ListenAndServe
+    void SetMaxAcceptsPerWakeup(size_t n)
+    { assert(!serving_); assert(n > 0); maxAcceptsPerWakeup_ = n; }
+
+    /// @brief Each IO-loop listens on the address with its own SO_REUSEPORT socket
+    /// and establishes the connections it accepts in place, so accepting neither funnels through the base loop
+    /// nor hops across threads, the kernel spreads the incoming connections over the listeners.
+    /// No effect without IO-threads.
+    /// @note must call before TcpServer::ListenAndServe
+    void SetReusePortListeners(bool on)
+    { assert(!serving_); reusePortListeners_ = on; }
+
+    /// @brief With SetReusePortListeners, a connection goes to the listener of loop (CPU receiving it % IO-threads),
+    /// the IO-thread i is expected to run on the CPU i(see SetIothreadInitCallback) to keep the connections CPU-local.
+    /// Falls back to the kernel's hashing if the steering program can't be attached.
+    /// @note must call before TcpServer::ListenAndServe
+    void SetReusePortCpuSteering(bool on)
+    { assert(!serving_); reusePortCpuSteering_ = on; }
+
+    /// @brief With SetReusePortListeners and SetIoThreadCpus, the listener of each loop sets SO_INCOMING_CPU
+    /// to the CPU of its thread, so the kernel prefers it for the connections received on that CPU.
+    /// Unlike SetReusePortCpuSteering, any mapping of loops to CPUs works, but the kernel honors it
+    /// in the reuse-port group since Linux 6.2
+    /// @note must call before TcpServer::ListenAndServe
+    void SetReusePortIncomingCpu(bool on)
+    { assert(!serving_); reusePortIncomingCpu_ = on; }
+
+    /// @brief Moves an established connection to target, an IO-loop of this server.
+    /// Its channel, buffered bytes, idle tracking and load counters move along, the callbacks and context are kept,
+    /// and the calls of the connection made in transit are delivered to target in order.
+    /// Nothing happens if the connection is closed(OR closing), forwarding, already served by target,
+    /// OR accepted by a reuse-port listener, which keeps it local to the loop it arrived at.
+    /// @note Thread-safe, the connection moves asynchronously, see TcpConnection::GetEventLoop
+    void MigrateConnection(const TcpConnectionPtr& conn, EventLoop* target);
+
+    /// @brief Rebalances the connections between IO-loops every interval, zero(by default) disables it.
+    /// Each round compares the busy time of the loops in the last interval(see LoopLoad::BusyTime),
+    /// if the share of the busiest loop exceeds the idlest one's by more than the threshold,
+    /// the connections carrying the part of its load which evens them out(at most kMaxMigrationsPerRebalance)
+    /// move to the idlest. The load of a connection is the bytes it read and wrote since the last round,
+    /// the most active ones which fit in the part go first, a connection carrying more than the part alone stays.
+    /// The bytes only approximate the cost: the connections of cheap bulk transfers look heavier than the ones of
+    /// expensive small requests. If the connections did no IO, the busy time is supposed to be theirs equally.
+    /// No effect in reuse-port mode
+    /// @note must call before TcpServer::ListenAndServe
+    void SetRebalanceInterval(const detail::Interval_t& interval)
+    { assert(!serving_); rebalanceInterval_ = interval; }
+
+    /// @param threshold difference of busy shares(0, 1) which triggers moving, kDefaultRebalanceThreshold by default
+    /// @note must call before TcpServer::ListenAndServe
+    void SetRebalanceThreshold(double threshold)
+    { assert(!serving_); assert(threshold > 0 && threshold < 1); rebalanceThreshold_ = threshold; }
+
+#ifdef MUDUO_USE_MEMPOOL
+    /// @brief The memory pool statistics summed up over the loops of the server, may be called in any thread
+    /// @see EventLoopThreadPool::GetMemoryPoolStats
+    base::MemoryPoolStats GetMemoryPoolStats() const;
+#endif
+
 private:
+    void StartListening();
     void HandleNewConnection(int connfd, const InetAddr& remote_addr);
+    /// @brief Hands the connections accepted in a wakeup to their IO-loops, with one enqueue per loop
+    void HandleAcceptedBatch();
     void RemoveConnection(const TcpConnectionPtr& conn);
     void RemoveConnectionInLoop(const TcpConnectionPtr& conn);
+    /// @brief Builds a connection served by io_loop, except its close callback and idle wheel
+    /// @param accept_loop the loop of the calling thread, allocates the connection
+    TcpConnectionPtr NewConnection(EventLoop* accept_loop, EventLoop* io_loop, const std::string& name,
+                                   int connfd, const InetAddr& remote_addr);
+    /* reuse-port mode, in the loop-thread of listener */
+    void StartLoopListener(LoopListener* listener, size_t group_size, int cpu);
+    void StopLoopListener(LoopListener* listener);
+    void HandleLocalConnection(LoopListener* listener, int connfd, const InetAddr& remote_addr);
+    void RemoveLocalConnection(LoopListener* listener, const TcpConnectionPtr& conn);
+    void MigrateConnectionInLoop(const TcpConnectionPtr& conn, EventLoop* target);
+    void RebalanceLoops();
+    /// @brief Takes the bytes of IO since the last round from every connection
+    /// @param served receives the connections served by loop with their bytes, if not null
+    /// @return the bytes of the connections served by loop
+    uint64_t TakeConnectionActivity(EventLoop* loop, ConnectionActivityList* served);
+    /// @return the idle wheel of loop, created on first use
+    const std::shared_ptr<detail::IdleConnectionWheel>& GetIdleWheel(EventLoop* loop);
 
 private:
     EventLoop* loop_;
@@ -69,12 +230,29 @@ private:
     std::unique_ptr<Acceptor> acceptor_;
     std::unique_ptr<EventLoopThreadPool> ioThreadPool_;
     ConnectionsMap conns_;
+    IdleWheelMap idleWheels_;   // wheel per IO-loop, the map is only accessed in loop-thread
+    LoopListenerList loopListeners_;  // reuse-port mode, one per IO-loop
+    PendingEstablishments pendingEstablishments_;   // accepted in the current wakeup, by IO-loop
+    BusyTimeList loopBusyTimes_;    // of the IO-loops at the last round of rebalancing
     std::atomic_bool serving_ {false};
 
     /* Callbacks for custom logic */
     ConnectionCallback_t connectionCb_ {DefaultConnectionCallback};
     MessageCallback_t messageCb_ {DefaultMessageCallback};
     WriteCompleteCallback_t writeCompleteCb_ {nullptr};
+    bool edgeTriggered_ {false};
+    bool completionIo_ {false};
+    size_t ioBudget_;
+    size_t zeroCopyThreshold_ {0};
+    detail::Interval_t idleTimeout_ {0};
+    size_t maxAcceptsPerWakeup_;
+    bool reusePortListeners_ {false};
+    bool reusePortCpuSteering_ {false};
+    bool reusePortIncomingCpu_ {false};
+    detail::Interval_t rebalanceInterval_ {0};
+    double rebalanceThreshold_ {kDefaultRebalanceThreshold};
+    detail::TimerId_t rebalanceTimer_ {-1};
+    detail::TimePoint_t lastRebalance_ {};
     /* always in loop-thread */
     uint64_t nextConnID_ {0};
 };
@@ -24,6 +24,7 @@ Watcher::Watcher(TimerQueue* owner)
     , watcherChannel_(std::make_unique<Channel>(owner_->Owner(), CreateTimerfd()))
 #endif
 {
+    watcherChannel_->EnableEdgeTriggered();    // reading the timerfd resets it, see Watcher::ReadTimerfd
     watcherChannel_->EnableReading();
     watcherChannel_->SetReadCallback(std::bind(&Watcher::HandleExpiredTimers, this));
     // watcherChannel_->SetReadCallback([this](Channel::ReceiveTimePoint_t t) {
@@ -13,31 +13,69 @@
 namespace muduo {
 using namespace detail;
 
+namespace detail {
+class TimerHeap;    // forward declaration
+class TimingWheel;  // forward declaration
+class TimerPool;    // forward declaration
+} // namespace detail
+
 class Timer {
     // noncopyable & nonmoveable
     Timer(const Timer&) = delete;
     Timer(Timer&&) = delete;
 
+    /* the stores link timers intrusively, so add/cancel allocates nothing */
+    friend class detail::TimerHeap;
+    friend class detail::TimingWheel;
+    friend class detail::TimerPool;
+
 public:
-    Timer(const TimePoint_t& time_point, const Interval_t& interval_us, const TimeoutCb_t& cb, const TimerId_t id)
-        : cb_(cb)
+    Timer(const TimePoint_t& time_point, const Interval_t& interval_us, TimeoutCb_t cb, const TimerId_t id,
+            const Interval_t& slack = Interval_t::zero())
+        : cb_(std::move(cb))
         , expiration_(time_point)
         , interval_(interval_us)
+        , slack_(slack)
         , id_(id)
         { }
 
     void Run() const { cb_(); }
     TimePoint_t ExpirationTime() const { return expiration_; }
     Interval_t Interval() const { return interval_; }
+    /// @brief The timer may be delayed by at most slack after its expiration time, to fire along with other timers
+    Interval_t Slack() const { return slack_; }
+    /// @brief The latest time at which the timer must fire
+    TimePoint_t Deadline() const { return expiration_ + slack_; }
     TimerId_t GetId() const { return id_; }
     bool Repeat() const { return interval_ != Interval_t::zero(); }
-    const TimeoutCb_t& GetPendingCallback() const { return cb_; }
+    /// @brief Reuses the timer(and its callback) for next expiration of repeating timer
+    void Restart(const TimePoint_t& time_point) { expiration_ = time_point; }
+
+    /// @brief Whether the timer is in the TimerStore, false while it's expired and running
+    bool InStore() const { return inStore_; }
+    void SetInStore(bool in) { inStore_ = in; }
+    /// @brief Canceled while it's running, destroyed after running
+    bool Canceled() const { return canceled_; }
+    void Cancel() { canceled_ = true; }
 
 private:
     TimeoutCb_t cb_;
     TimePoint_t expiration_;
     Interval_t interval_;
+    Interval_t slack_;
     TimerId_t id_;
+    bool inStore_ {false};
+    bool canceled_ {false};
+
+    /* hook of TimerPool */
+    Timer* hashNext_ {nullptr};
+    /* hooks of TimerHeap */
+    size_t heapIndex_ {0};
+    /* hooks of TimingWheel */
+    uint64_t tick_ {0};
+    Timer* prev_ {nullptr};
+    Timer* next_ {nullptr};
+    Timer** slot_ {nullptr};
 };
 
 /*************************************************************************************************/
@@ -3,12 +3,11 @@
 
 #include <muduo/base/allocator/Allocatable.h>
 #include <muduo/TimerType.h>
+#include <muduo/TimerStore.h>
 #include <chrono>
 #include <memory>
-#include <vector>
 #include <atomic>
 #include <functional>
-#include <unordered_map>
 
 namespace muduo {
 using namespace detail;
@@ -16,6 +15,9 @@ using namespace detail;
 class EventLoop;    // forward declaration
 class Watcher;      // forward declaration
 class Timer;        // forward declaration
+namespace detail {
+class TimerPool;    // forward declaration
+} // namespace detail
 
 #ifdef MUDUO_USE_MEMPOOL
 class TimerQueue : public base::detail::Allocatable {
@@ -28,17 +30,16 @@ class TimerQueue {
     // non-copyable & non-moveable
     TimerQueue(const TimerQueue&) = delete;
     TimerQueue operator=(const TimerQueue) = delete;
-    
-    class TimerMinHeap;
 
 public:
-    TimerQueue(EventLoop* owner);
+    TimerQueue(EventLoop* owner, TimerBackend backend = TimerBackend::kDefault);
     ~TimerQueue() noexcept;
 
     /** 
      * thread-safe
     */
-    detail::TimerId_t AddTimer(const TimePoint_t& when, const Interval_t& interval, const TimeoutCb_t& cb);
+    detail::TimerId_t AddTimer(const TimePoint_t& when, const Interval_t& interval, TimeoutCb_t cb,
+                               const Interval_t& slack = Interval_t::zero());
     void CancelTimer(const detail::TimerId_t id);
     
     /**
@@ -49,19 +50,32 @@ public:
 
     void HandleExpiredTimers();
 
+    /// @brief Number of pending timers
+    /// @note Must be called in the loop thread
+    size_t Size() const;
+
+    /// @brief Number of timerfd_settime(2) calls
+    /// @note Must be called in the loop thread
+    uint64_t TimerfdResets() const { return timerfdResets_; }
+
 private:
-    void AddTimerInLoop(std::unique_ptr<Timer>& t_p);
+    void AddTimerInLoop(const TimePoint_t& when, const Interval_t& interval, TimeoutCb_t cb,
+                        const detail::TimerId_t id, const Interval_t& slack);
     void CancelTimerInLoop(const detail::TimerId_t id);
     void ResetTimerfd();
-    using ExpiredTimerList = std::vector<std::unique_ptr<Timer>>; 
-    ExpiredTimerList GetExpiredTimers();
+    /// @brief Puts the expired repeating timers back, destroys the others and the ones canceled in callbacks
+    void RestartRepeatingTimers(const TimePoint_t& now);
 
 private:
     EventLoop* const owner_;
     std::unique_ptr<Watcher> watcher_;
-    std::unique_ptr<TimerMinHeap> heap_;
+    std::unique_ptr<TimerStore> store_; // orders the timers, doesn't own them
+    std::unique_ptr<detail::TimerPool> timers_; // owns all timers, including the running ones
+    TimerStore::ExpiredTimerList expired_;  // reused for every expiration
     TimerId nextTimerId_;
-    TimePoint_t latestTime_;
+    TimePoint_t latestTime_;            // the time armed in timerfd, may be earlier than the next deadline
+    bool callingExpiredTimers_;
+    uint64_t timerfdResets_;
 };
 
 } // namespace muduo 
@@ -0,0 +1,71 @@
+#if !defined(MUDUO_TIMER_STORE_H)
+#define MUDUO_TIMER_STORE_H
+
+#include <muduo/base/allocator/Allocatable.h>
+#include <muduo/base/allocator/sgi_stl_alloc.h>
+#include <muduo/TimerType.h>
+#include <vector>
+
+namespace muduo {
+
+class EventLoop;    // forward declaration
+class Timer;        // forward declaration
+
+/**
+ * abstract base class for the data structure which orders the timers of a TimerQueue by deadline,
+ * i.e. the expiration time plus the slack of a timer.
+ * this class doesn`t own the Timer objects, TimerQueue owns them
+*/
+#ifdef MUDUO_USE_MEMPOOL
+class TimerStore : public base::detail::Allocatable {
+public:
+    using ExpiredTimerList = std::vector<Timer*, base::allocator<Timer*>>;
+#else
+class TimerStore {
+public:
+    using ExpiredTimerList = std::vector<Timer*>;
+#endif
+protected:
+    TimerStore() = default;
+    TimerStore(const TimerStore&) = delete; // non-copyable
+    TimerStore(TimerStore&&) = delete;      // non-moveable
+
+public:
+    virtual ~TimerStore() noexcept = default;
+
+    virtual void Add(Timer* t) = 0;
+
+    /**
+     * Removes a timer in the store,
+     * NextExpiration never gets earlier by it
+    */
+    virtual void Remove(Timer* t) = 0;
+
+    /**
+     * Moves all timers whose deadline is reached at now out of the store, in the order of deadline.
+     * The timers whose expiration time is reached but deadline isn't may be moved out too,
+     * so they are coalesced into the current wakeup
+    */
+    virtual void PopExpired(const detail::TimePoint_t& now, ExpiredTimerList* expired) = 0;
+
+    /**
+     * @return The earliest deadline, OR an earlier time point at which the store needs to be checked,
+     *  TimePoint_t::max() if the store is empty
+    */
+    virtual detail::TimePoint_t NextExpiration() const = 0;
+
+    virtual size_t Size() const = 0;
+    bool Empty() const { return Size() == 0; }
+
+    /**
+     * Creates the timer store for the specified loop.
+     * TimerBackend::kDefault uses binary heap,
+     * set environment variable "MUDUO_TIMER=wheel" to use timing wheel instead.
+     * @note the instance is allocated in the loop-level memory pool if MUDUO_USE_MEMPOOL is defined
+    */
+    static TimerStore* NewTimerStore(EventLoop* loop, TimerBackend backend);
+};
+
+} // namespace muduo
+
+#endif // MUDUO_TIMER_STORE_H
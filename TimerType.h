@@ -2,17 +2,25 @@
 #define MUDUO_TIMER_TYPE_H
 
 #include <chrono>
-#include <functional>
+#include <muduo/base/InlineFunction.h>
 
 namespace muduo {
 namespace detail {
 
     using TimerId_t = int;
-    using TimeoutCb_t = std::function<void()>;
+    using TimeoutCb_t = base::InlineFunction<void()>;
     using TimePoint_t = std::chrono::steady_clock::time_point;
     using Interval_t = std::chrono::milliseconds;
 
 } // namespace detail 
+
+/// @brief Data structure which orders the timers of a loop
+enum class TimerBackend {
+    kDefault,   // decided by environment variable "MUDUO_TIMER", heap if unset
+    kHeap,      // binary min-heap, O(log n) add/cancel, exact expiration
+    kWheel,     // hierarchical timing wheel, O(1) add/cancel, millisecond ticks
+};
+
 } // namespace muduo 
 
 #endif // MUDUO_TIMER_TYPE_H
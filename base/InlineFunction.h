@@ -0,0 +1,186 @@
+#if !defined(MUDUO_BASE_INLINE_FUNCTION_H)
+#define MUDUO_BASE_INLINE_FUNCTION_H
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <new>
+
+namespace muduo {
+namespace base {
+
+template <typename Signature, size_t Capacity = 64>
+class InlineFunction;   // undefined
+
+/**
+ * Move-only replacement of std::function with small-buffer storage.
+ * A callable whose size is not greater than Capacity(and nothrow-move-constructible)
+ * is stored inside the object, so wrapping it never allocates,
+ * otherwise it falls back to the heap like std::function.
+ *
+ * Being move-only, it can hold move-only captures(e.g. std::unique_ptr),
+ * and the callbacks flow through the EventLoop without copying their captures.
+*/
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+    static_assert(Capacity >= sizeof(void*), "the storage must be able to hold a pointer for heap fallback");
+
+    struct Ops {
+        R (*invoke)(void* storage, Args&&... args);
+        /// move-constructs the callable into dst and destroys the one in src
+        void (*relocate)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static R Invoke(void* s, Args&&... args)
+        { return (*static_cast<F*>(s))(std::forward<Args>(args)...); }
+
+        static void Relocate(void* dst, void* src) noexcept {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        static void Destroy(void* s) noexcept
+        { static_cast<F*>(s)->~F(); }
+
+        static constexpr Ops kOps {&Invoke, &Relocate, &Destroy};
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static F*& Pointer(void* s)
+        { return *static_cast<F**>(s); }
+
+        static R Invoke(void* s, Args&&... args)
+        { return (*Pointer(s))(std::forward<Args>(args)...); }
+
+        static void Relocate(void* dst, void* src) noexcept
+        { ::new (dst) F*(Pointer(src)); }
+
+        static void Destroy(void* s) noexcept
+        { delete Pointer(s); }
+
+        static constexpr Ops kOps {&Invoke, &Relocate, &Destroy};
+    };
+
+    template <typename F>
+    using EnableIfCallable = std::enable_if_t<
+        !std::is_same<std::decay_t<F>, InlineFunction>::value
+            && std::is_invocable_r<R, std::decay_t<F>&, Args...>::value>;
+
+public:
+    static constexpr size_t kCapacity = Capacity;
+
+    /// @brief Whether a callable of type F is stored without heap allocation
+    template <typename F>
+    static constexpr bool StoresInline() {
+        using Fn = std::decay_t<F>;
+        return sizeof(Fn) <= Capacity
+            && alignof(Fn) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    InlineFunction() noexcept
+        : ops_(nullptr)
+        { }
+
+    InlineFunction(std::nullptr_t) noexcept
+        : ops_(nullptr)
+        { }
+
+    template <typename F, typename = EnableIfCallable<F>>
+    InlineFunction(F&& f)
+        : ops_(nullptr)
+    {
+        using Fn = std::decay_t<F>;
+        using Arg = std::remove_cv_t<std::remove_reference_t<F>>;  // a function reference is never null
+        if constexpr (std::is_pointer<Arg>::value || std::is_member_pointer<Arg>::value) {
+            if (f == nullptr) {
+                return;
+            }
+        }
+        if constexpr (StoresInline<Fn>()) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+            ops_ = &InlineOps<Fn>::kOps;
+        } else {
+            ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(f)));
+            ops_ = &HeapOps<Fn>::kOps;
+        }
+    }
+
+    InlineFunction(InlineFunction&& other) noexcept
+        : ops_(other.ops_)
+    {
+        if (ops_ != nullptr) {
+            ops_->relocate(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            if (other.ops_ != nullptr) {
+                other.ops_->relocate(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    template <typename F, typename = EnableIfCallable<F>>
+    InlineFunction& operator=(F&& f) {
+        return *this = InlineFunction(std::forward<F>(f));
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() noexcept
+    { Reset(); }
+
+    explicit operator bool() const noexcept
+    { return ops_ != nullptr; }
+
+    /// @throw std::bad_function_call if empty, same as std::function
+    R operator()(Args... args) const {
+        if (ops_ == nullptr) {
+            throw std::bad_function_call();
+        }
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    void Reset() noexcept {
+        if (ops_ != nullptr) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    const Ops* ops_;
+    alignas(std::max_align_t) mutable unsigned char storage_[Capacity];
+};
+
+template <typename R, typename... Args, size_t Capacity>
+bool operator==(const InlineFunction<R(Args...), Capacity>& f, std::nullptr_t) noexcept
+{ return !f; }
+
+template <typename R, typename... Args, size_t Capacity>
+bool operator!=(const InlineFunction<R(Args...), Capacity>& f, std::nullptr_t) noexcept
+{ return static_cast<bool>(f); }
+
+} // namespace base
+} // namespace muduo
+
+#endif // MUDUO_BASE_INLINE_FUNCTION_H
@@ -0,0 +1,123 @@
+#if !defined(MUDUO_BASE_MPSC_QUEUE_H)
+#define MUDUO_BASE_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace muduo {
+namespace base {
+
+/// Intrusive hook of MpscQueue, embeds it into the element type
+struct MpscNode {
+    std::atomic<MpscNode*> next {nullptr};
+};
+
+/**
+ * Intrusive multi-producer single-consumer queue (Dmitry Vyukov's algorithm).
+ * Push is wait-free: a single atomic exchange, no matter how many producers contend.
+ * Pop is lock-free and may only be called by the single consumer.
+ *
+ * The queue never owns the nodes, the caller manages their lifetime.
+ * @note Pop() returns nullptr when a producer is in the middle of Push(),
+ *       the consumer must be notified again by that producer (e.g. via a wakeup) to not miss the node.
+*/
+class MpscQueue {
+    /// noncopyable & nonmoveable
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+public:
+    MpscQueue()
+        : head_(&stub_)
+        , tail_(&stub_)
+        { }
+
+    /// @note Safe to call from any thread
+    void Push(MpscNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        // [window] the consumer can not see the node until the link below is stored
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /// @note Only called by consumer
+    MpscNode* Pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr; // a producer is linking its node
+        }
+        // the last node can be popped only if there is a successor, re-push the stub as the successor
+        Push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    /// @return whether no node is queued, nor being pushed
+    /// @note Only called by consumer
+    bool Empty() const
+    { return tail_ == &stub_ && head_.load(std::memory_order_acquire) == &stub_; }
+
+    /**
+     * Pops the nodes which were pushed before the call and passes them to handler in FIFO order,
+     * the nodes pushed during consuming are left for next call, so a handler which pushes again can not starve the consumer.
+     * @param handler invoked as handler(MpscNode*), could free the node,
+     *  if it returns bool, false stops consuming after the node, and the rest are left for next call
+     * @return number of consumed nodes
+     * @note Only called by consumer
+    */
+    template <typename Handler>
+    size_t Consume(Handler&& handler) {
+        MpscNode* const last = head_.load(std::memory_order_acquire);
+        size_t count = 0;
+        for (;;) {
+            if (last == &stub_ && tail_ == &stub_) {
+                break;  // all the nodes in front of stub are consumed
+            }
+            MpscNode* node = Pop();
+            if (node == nullptr) {
+                break;
+            }
+            count += 1;
+            const bool isLast = (node == last);
+            if constexpr (std::is_same<decltype(handler(node)), bool>::value) {
+                if (!handler(node)) {
+                    break;
+                }
+            } else {
+                handler(node);
+            }
+            if (isLast) {
+                break;
+            }
+        }
+        return count;
+    }
+
+private:
+    alignas(64) std::atomic<MpscNode*> head_;   // written by producers
+    alignas(64) MpscNode* tail_;                // owned by consumer
+    MpscNode stub_;
+};
+
+} // namespace base
+} // namespace muduo
+
+#endif // MUDUO_BASE_MPSC_QUEUE_H
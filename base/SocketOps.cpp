@@ -3,6 +3,9 @@
 #include <muduo/base/Endian.h>
 #include <cassert>
 #include <unistd.h>
+#include <fcntl.h>          // for splice(2)
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>   // for zero-copy completion
 
 /// @note The actual structure passed for the addr argument will depend on the address family of socket,
 /// So, for support IPv6, should Use 'sockaddr_in6'&'sizeof(sockaddr_in6)' in related operations
@@ -49,7 +52,9 @@ int sockets::accept(int listener, struct sockaddr_in6* addr) {
     int sockfd = ::accept4(listener, sockets::sockaddr_cast(addr), &len, SOCK_NONBLOCK|SOCK_CLOEXEC);
     if (sockfd < 0) {
         int savederrno = errno;
-        LOG_SYSERR << "sockets::accept";
+        if (savederrno != EAGAIN) {   // the backlog is drained, not an error
+            LOG_SYSERR << "sockets::accept";
+        }
         switch (savederrno) {
         case EAGAIN:
         case EINTR:
@@ -105,6 +110,16 @@ int sockets::getSocketError(int sockfd) {
     }
 }
 
+int sockets::getIncomingCpu(int sockfd) {
+    int cpu = -1;
+    socklen_t len = static_cast<socklen_t>(sizeof cpu);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) {
+        LOG_SYSERR << "sockets::getIncomingCpu";
+        return -1;
+    }
+    return cpu;
+}
+
 
                     /* addr convert helpers */
 const struct sockaddr* sockets::address::sockaddr_cast(const struct sockaddr_in* addr) {
@@ -208,4 +223,44 @@ union sockets::SockAddr sockets::address::getRemoteAddr(int sockfd) {
 
 ssize_t sockets::readv(int sockfd, const struct iovec *iov, int iovcnt) {
     return ::readv(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt) {
+    return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int filefd, off_t* offset, size_t count) {
+    return ::sendfile(sockfd, filefd, offset, count);
+}
+
+ssize_t sockets::splice(int fd_in, int fd_out, size_t len) {
+    return ::splice(fd_in, nullptr, fd_out, nullptr, len, SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+}
+
+ssize_t sockets::sendZeroCopy(int sockfd, const void* buf, size_t len) {
+    return ::send(sockfd, buf, len, MSG_ZEROCOPY);
+}
+
+bool sockets::recvZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied) {
+    char control[128];
+    struct msghdr msg {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    while (::recvmsg(sockfd, &msg, MSG_ERRQUEUE) >= 0) {
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            const struct sock_extended_err* serr = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno == 0 && serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                *lo = serr->ee_info;
+                *hi = serr->ee_data;
+                *copied = (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+                return true;
+            }
+        }
+        msg.msg_controllen = sizeof control;    // skip other queued errors
+    }
+    return false;
 }
\ No newline at end of file
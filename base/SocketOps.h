@@ -3,7 +3,7 @@
 #include <muduo/InetAddr.h>
 #include <arpa/inet.h>
 #include <cstddef>
-#include <sys/uio.h>    // for readv(2)
+#include <sys/uio.h>    // for readv(2)/writev(2)
 
 namespace muduo {
 namespace sockets {
@@ -37,7 +37,28 @@ extern void shutdownWrite(int sockfd);
 /// @return Return error code 
 extern int getSocketError(int sockfd);
 
+/// @return the CPU which processed the packets of the socket lately(SO_INCOMING_CPU), -1 if unknown
+extern int getIncomingCpu(int sockfd);
+
 extern ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
+extern ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+
+/// @brief Copies count bytes of filefd from *offset to sockfd in kernel, *offset is advanced
+extern ssize_t sendfile(int sockfd, int filefd, off_t* offset, size_t count);
+/// @brief Moves at most len bytes between fds without copying to user space, one of them must be a pipe
+/// @note Never blocks on the pipe
+extern ssize_t splice(int fd_in, int fd_out, size_t len);
+
+/// @brief Sends with MSG_ZEROCOPY, buf must not be modified until the completion is reported
+/// @note SO_ZEROCOPY must be set on sockfd
+extern ssize_t sendZeroCopy(int sockfd, const void* buf, size_t len);
+/**
+ * @brief Reads one zero-copy completion from the error queue of socket
+ * @param lo, hi the sends whose ids are in [lo, hi] were completed
+ * @param copied the kernel fell back to copying the payload(e.g. loopback)
+ * @return false if no more completion is queued
+ */
+extern bool recvZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied);
 
 namespace address {
 
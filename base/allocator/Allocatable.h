@@ -15,25 +15,35 @@ struct Allocatable {
     /// @brief Use specified @c muduo::base::MemoryPool to allocate the storage 
     /// @note The method will hide the global operator new for this class
     static void* operator new(size_t size, base::MemoryPool* pool) {
-        return pool->allocate(size);
+        void* p = pool->allocate(size + sizeof(Cookie));
+        ::new (p) Cookie{pool, size};
+        return static_cast<Cookie*>(p) + 1;
     };
 
     /// @brief The method corresponds to @c operator new(size_t size, base::MemoryPool* pool),
     /// Only will be invoked When the key @c new throws a exception by C++ Runtime System
-    static void operator delete(void* p, base::MemoryPool* pool) {
-        /// FIXME: use allocate-with-cookie OR CRTP to implement
-        ///     pool->deallocate(p, sizeof(Derive));
-        LOG_FATAL << "Unexpected invoke operator delete(void* p, base::MemoryPool* pool)";
+    static void operator delete(void* p, base::MemoryPool* /* pool */) {
+        Cookie* cookie = static_cast<Cookie*>(p) - 1;
+        cookie->pool->deallocate(cookie, cookie->size + sizeof(Cookie));
     }
 
     /// @brief Explicitly delete the normal class-specific @c operator-new
     static void* operator new(size_t size) = delete;
 
-    /// @brief Use Loop-level mempool to deallocate the storage 
-    /// @note Must be invoked in the thread where the parameter @c ptr was allocated, for thread-safe
+    /// @brief Returns the storage to the mempool which allocated it
+    /// @note May be invoked in any thread, the storage freed by a foreign thread goes to the remote list of the mempool
     static void operator delete(void* ptr, size_t size) {
-        MemoryPool::GetCurrentThreadMempool()->deallocate(ptr, size);
+        Cookie* cookie = static_cast<Cookie*>(ptr) - 1;
+        assert(cookie->size == size);
+        cookie->pool->deallocate(cookie, size + sizeof(Cookie));
     }
+
+private:
+    /// The header in front of the object, records which mempool the storage belongs to
+    struct Cookie {
+        base::MemoryPool* pool;
+        size_t size;
+    };
 };
 
 } // namespace detail 
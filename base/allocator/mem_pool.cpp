@@ -7,12 +7,15 @@
 
 using namespace muduo::base::detail;
 
+const size_t mem_pool::kClassesNum;
+
 namespace {
     thread_local muduo::base::MemoryPool* tl_mempool_inThisThread = {nullptr};
 } // namespace 
 
-mem_pool::mem_pool(EventLoop* loop)
+mem_pool::mem_pool(EventLoop* loop, const mem_pool_options& options)
     : loop_(loop)
+    , spans(options.max_bytes, options.release_idle_spans, options.huge_pages)
 {
     if (tl_mempool_inThisThread != nullptr) {
         LOG_FATAL << "Another Mempool instance " << tl_mempool_inThisThread
@@ -32,13 +35,86 @@ muduo::base::detail::mem_pool::~mem_pool() {
     tl_mempool_inThisThread = nullptr;
 }
 
+mem_pool_stats mem_pool::stats() const {
+    mem_pool_stats result;
+    for (size_t i = 0; i < kClassesNum; i++) {
+        const class_counters& c = counters[i];
+        mem_pool_stats::size_class& s = result.classes[i];
+        // reads frees before allocations, so that live_blocks never underflows if they are updated meanwhile
+        const size_t remote_frees = c.remote_frees.load(std::memory_order_relaxed);
+        const size_t frees = c.frees.get();
+        s.allocations = c.allocations.get();
+        s.remote_frees = remote_frees;
+        s.live_blocks = s.allocations >= frees + remote_frees ? s.allocations - frees - remote_frees : 0;
+        s.high_water = c.high_water.get();
+        if (i < kFreeListsNum) {
+            s.block_size = (i + 1) * kALIGN;
+            s.free_blocks = c.carved.get();
+        } else {
+            s.block_size = span_alloc::class_size(i - kFreeListsNum);
+            s.free_blocks = spans.class_blocks(i - kFreeListsNum);
+        }
+        s.free_blocks = s.free_blocks >= s.live_blocks ? s.free_blocks - s.live_blocks : 0;
+    }
+    result.os_bytes = chunk_bytes.get() + spans.mapped_bytes();
+    result.released_bytes = spans.released_spans() * span_alloc::kSpanBytes;
+    result.fallback_allocations = fallback_allocations.load(std::memory_order_relaxed);
+    result.fallback_bytes = fallback_bytes.load(std::memory_order_relaxed);
+    result.pools = 1;
+    return result;
+}
+
+size_t mem_pool_stats::live_bytes() const {
+    size_t bytes = fallback_bytes;
+    for (const size_class& c : classes) {
+        bytes += c.live_blocks * c.block_size;
+    }
+    return bytes;
+}
+
+size_t mem_pool_stats::free_bytes() const {
+    size_t bytes = 0;
+    for (const size_class& c : classes) {
+        bytes += c.free_blocks * c.block_size;
+    }
+    return bytes;
+}
+
+mem_pool_stats& mem_pool_stats::operator+=(const mem_pool_stats& other) {
+    for (size_t i = 0; i < mem_pool::kClassesNum; i++) {
+        classes[i].block_size = other.classes[i].block_size;
+        classes[i].live_blocks += other.classes[i].live_blocks;
+        classes[i].free_blocks += other.classes[i].free_blocks;
+        classes[i].high_water += other.classes[i].high_water;
+        classes[i].allocations += other.classes[i].allocations;
+        classes[i].remote_frees += other.classes[i].remote_frees;
+    }
+    os_bytes += other.os_bytes;
+    released_bytes += other.released_bytes;
+    fallback_allocations += other.fallback_allocations;
+    fallback_bytes += other.fallback_bytes;
+    pools += other.pools;
+    return *this;
+}
+
 mem_pool* mem_pool::GetCurrentThreadMempool() {
     return tl_mempool_inThisThread;
 }
 
 void* mem_pool::allocate(size_t n) {
     if (n > static_cast<size_t>(kMax_Bytes)) {
-        return detail::master_alloc::allocate(n);
+        if (n > spans.max_bytes()) {
+            fallback_allocations.fetch_add(1, std::memory_order_relaxed);
+            fallback_bytes.fetch_add(n, std::memory_order_relaxed);
+            return detail::master_alloc::allocate(n);
+        }
+        loop_->AssertInLoopThread();
+        const size_t index = span_alloc::class_index(n);
+        if (remote_span_frees[index].load(std::memory_order_relaxed) != nullptr) {
+            drain_remote_spans(index);
+        }
+        count_allocation(kFreeListsNum + index);
+        return spans.allocate(n);
     }
 
     loop_->AssertInLoopThread();
@@ -46,10 +122,14 @@ void* mem_pool::allocate(size_t n) {
     list_header_t target_list = nullptr;
     obj* result;
 
+    count_allocation(GET_FREELIST_INDEX(n));
     target_list = free_lists + GET_FREELIST_INDEX(n);    // Get target list
     result = *target_list;
-        
+
     if (result == nullptr) {    // The list has`t available space
+        result = drain_remote(GET_FREELIST_INDEX(n));
+    }
+    if (result == nullptr) {    // Neither the remote list
         void* r = refill(ROUND_UP(n));
         return r;
     }
@@ -59,24 +139,81 @@ void* mem_pool::allocate(size_t n) {
 }
 
 void mem_pool::deallocate(void* ptr, size_t n) {
-    if (n > static_cast<size_t>(kMax_Bytes)) {
+    if (n > spans.max_bytes() && n > static_cast<size_t>(kMax_Bytes)) {
+        fallback_bytes.fetch_sub(n, std::memory_order_relaxed);
         detail::master_alloc::deallocate(ptr, n);
         return;
     }
     
-    loop_->AssertInLoopThread();
-
     obj* recycle = static_cast<obj*>(ptr);
+    const size_t index = n > static_cast<size_t>(kMax_Bytes)
+            ? kFreeListsNum + span_alloc::class_index(n)
+            : GET_FREELIST_INDEX(n);
+
+    if (!loop_->IsInLoopThread()) {
+        counters[index].remote_frees.fetch_add(1, std::memory_order_relaxed);
+        // push to the remote list without waking up the loop, the loop drains it when it needs
+        std::atomic<obj*>& remote_list = index >= kFreeListsNum
+                ? remote_span_frees[index - kFreeListsNum]
+                : remote_frees[index];
+        obj* head = remote_list.load(std::memory_order_relaxed);
+        do {
+            recycle->next = head;
+        } while (!remote_list.compare_exchange_weak(head, recycle, std::memory_order_release, std::memory_order_relaxed));
+        return;
+    }
+
+    counters[index].frees.add(1);
+    if (index >= kFreeListsNum) {
+        spans.deallocate(ptr, n);
+        return;
+    }
+
     list_header_t target_list = nullptr;
 
-    target_list = free_lists + GET_FREELIST_INDEX(n);
+    target_list = free_lists + index;
     recycle->next = *target_list;
     *target_list = recycle;
 }
 
+void mem_pool::count_allocation(size_t index) {
+    class_counters& c = counters[index];
+    c.allocations.add(1);
+    c.high_water.update_max(c.allocations.get() - c.frees.get() - c.remote_frees.load(std::memory_order_relaxed));
+}
+
+mem_pool::obj* mem_pool::drain_remote(size_t index) {
+    // only the loop thread pops, and it takes the whole list at once, so there is no ABA problem
+    obj* result = remote_frees[index].exchange(nullptr, std::memory_order_acquire);
+    if (result != nullptr) {
+        free_lists[index] = result->next;
+    }
+    return result;
+}
+
+void mem_pool::drain_remote_spans(size_t index) {
+    obj* block = remote_span_frees[index].exchange(nullptr, std::memory_order_acquire);
+    const size_t size = span_alloc::class_size(index);
+    while (block != nullptr) {
+        obj* next = block->next;
+        spans.deallocate(block, size);
+        block = next;
+    }
+}
+
+void mem_pool::drain_remote_spans() {
+    loop_->AssertInLoopThread();
+    for (size_t i = 0; i < span_alloc::kClassesNum; i++) {
+        if (remote_span_frees[i].load(std::memory_order_relaxed) != nullptr) {
+            drain_remote_spans(i);
+        }
+    }
+}
+
 void* mem_pool::refill(size_t n) {
     int n_objs = 20;
     char* chunk = chunk_alloc(n, &n_objs);
+    counters[GET_FREELIST_INDEX(n)].carved.add(n_objs);
 
     if (n_objs == 1) {
         return chunk;
@@ -121,6 +258,7 @@ char* mem_pool::chunk_alloc(size_t size, int* n_objs) {
         if (left_size > 0) {    // 内存池内还有残余空间，将其编入合适的list中
             assert(left_size % kALIGN == 0);    // 断言剩余的内存大小一定是kALIGN的整数倍
             list_header_t target_list = free_lists + GET_FREELIST_INDEX(left_size);
+            counters[GET_FREELIST_INDEX(left_size)].carved.add(1);
             static_cast<obj*>(static_cast<void*>(begin_free))->next = *target_list;
             *target_list = static_cast<obj*>(static_cast<void*>(begin_free));
         }
@@ -141,6 +279,7 @@ char* mem_pool::chunk_alloc(size_t size, int* n_objs) {
                 ptr = *target_list;
                 if (ptr != nullptr) {
                     *target_list = ptr->next;
+                    counters[GET_FREELIST_INDEX(i)].carved.sub(1);
                     begin_free = static_cast<char*>(static_cast<void*>(ptr));
                     end_free = begin_free + i; 
                     return chunk_alloc(size, n_objs);
@@ -152,6 +291,7 @@ char* mem_pool::chunk_alloc(size_t size, int* n_objs) {
             begin_free = static_cast<char*>(master_alloc::allocate(bytes_to_get));
         }
         heap_size += bytes_to_get;
+        chunk_bytes.add(bytes_to_get);
         end_free = begin_free + bytes_to_get;
         return chunk_alloc(size, n_objs);
     }
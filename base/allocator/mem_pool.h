@@ -4,8 +4,12 @@
 #include <muduo/config.h>
 
 #ifdef MUDUO_USE_MEMPOOL
+#include <muduo/base/allocator/span_alloc.h>
+#include <muduo/base/allocator/stat_counter.h>
 #include <functional>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <list>
 #include <new>
@@ -76,7 +80,25 @@ using master_alloc = malloc_alloc<0>;
 
 /* ======================================================================================== */
 
-/// @note All the operations are not thread-safe
+struct mem_pool_options {
+    /// the blocks larger than it are allocated by @c master_alloc,
+    /// the ones in (mem_pool::kMax_Bytes, max_bytes] by @c span_alloc
+    size_t max_bytes {64 * 1024};
+    /// returns the pages of the spans which drain empty to the OS
+    bool release_idle_spans {true};
+    /// the blocks of spans freed by foreign threads are drained by the loop so often,
+    /// so their spans drain empty even if their classes never allocate again. 0 disables it
+    std::chrono::milliseconds remote_drain_interval {1000};
+    /// backs the spans with transparent huge pages
+    bool huge_pages {false};
+};
+
+struct mem_pool_stats;  // forward declaration
+
+/// @note @c allocate must be invoked in the loop thread;
+///     @c deallocate may be invoked in any thread: a block freed by a foreign thread is pushed to
+///     the lock-free remote list of its size class, which the loop thread drains in a batch
+///     when the local free list runs out
 /// non-copyable & non-moveable(might move, but hasn't implement)
 class mem_pool {
     mem_pool(const mem_pool&) = delete;
@@ -108,7 +130,7 @@ private:
     { return (((bytes) + kALIGN-1) / kALIGN - 1); }
 
 public:
-    mem_pool(EventLoop* loop);
+    mem_pool(EventLoop* loop, const mem_pool_options& options = mem_pool_options());
 
     void* allocate(size_t n);
 
@@ -117,6 +139,19 @@ public:
     /// 向操作系统归还已分配的内存区域
     ~mem_pool() noexcept;
 
+    /// @brief Takes a snapshot of the statistics, may be invoked in any thread
+    /// @note The counters are updated by the loop thread without synchronization,
+    ///     so a snapshot taken in another thread is consistent per counter but not across counters
+    mem_pool_stats stats() const;
+
+    /// @brief Returns the blocks of all span classes freed by foreign threads to their spans,
+    ///     the spans drained empty meanwhile are released if @c mem_pool_options::release_idle_spans
+    /// @note must be invoked in the loop thread, the EventLoop does it every @c mem_pool_options::remote_drain_interval
+    void drain_remote_spans();
+
+    /// The number of size classes, @c kFreeListsNum ones of 8 bytes step, then the ones of @c span_alloc
+    static const size_t kClassesNum = kFreeListsNum + span_alloc::kClassesNum;
+
 private:
     /// @brief allocate a chunk that can accommodate @c n_objs @c sub_alloc<unused>::obj of size @c size.
     /// @note size 必须是 @c mem_pool::kALIGN 的倍数
@@ -128,21 +163,75 @@ private:
     /// @note n 必须是 @c mem_pool::kALIGN 的倍数
     void* refill(size_t n);
 
+    /// @brief Takes all the blocks freed by foreign threads into the local free list @c index
+    /// @return The first block taken, nullptr if there is none
+    obj* drain_remote(size_t index);
+
+    /// @brief Returns all the blocks of span class @c index freed by foreign threads to their spans
+    void drain_remote_spans(size_t index);
+
+    void count_allocation(size_t index);
+
 private:
+    /// counters of a size class, written by the loop thread except @c remote_frees
+    struct class_counters {
+        stat_counter allocations;
+        stat_counter frees;
+        std::atomic<size_t> remote_frees {0};
+        stat_counter high_water;
+        stat_counter carved;    // the blocks cut from chunks, only for the classes <= kMax_Bytes
+    };
+
     using list_header_t = obj* volatile *; 
 
     EventLoop* loop_;
     obj* volatile free_lists[kFreeListsNum] {};
+    std::atomic<obj*> remote_frees[kFreeListsNum] {};  // MPSC stacks, pushed by foreign threads
+    std::atomic<obj*> remote_span_frees[span_alloc::kClassesNum] {};
+    span_alloc spans;
     char* begin_free {nullptr};
     char* end_free {nullptr};
     size_t heap_size {0};
 
     std::list<void*> allocated_area;
+
+    class_counters counters[kClassesNum];
+    stat_counter chunk_bytes;   // the bytes malloc'ed for chunks
+    std::atomic<size_t> fallback_allocations {0};   // the blocks larger than the max bytes of spans
+    std::atomic<size_t> fallback_bytes {0};
+};
+
+/// @brief A snapshot of @c mem_pool::stats(), the ones of several pools can be summed up by @c operator+=
+struct mem_pool_stats {
+    struct size_class {
+        size_t block_size {0};
+        size_t live_blocks {0};     // handed out and not freed yet
+        size_t free_blocks {0};     // carved for the class but not handed out, fragmentation if it stays high
+        size_t high_water {0};      // the max of live_blocks, summed up when merged
+        size_t allocations {0};     // in total
+        size_t remote_frees {0};    // freed by foreign threads, in total
+    };
+
+    size_class classes[mem_pool::kClassesNum];
+    size_t os_bytes {0};            // malloc'ed for chunks and mapped for spans
+    size_t released_bytes {0};      // of the idle spans which were returned to the OS
+    size_t fallback_allocations {0};    // forwarded to malloc, in total
+    size_t fallback_bytes {0};      // forwarded to malloc and not freed yet
+    size_t pools {0};               // the number of pools summed up
+
+    /// @brief The bytes handed out and not freed yet(including fallback_bytes)
+    size_t live_bytes() const;
+    /// @brief The bytes carved for size classes but not handed out
+    size_t free_bytes() const;
+
+    mem_pool_stats& operator+=(const mem_pool_stats& other);
 };
 
 } // namespace detail 
 
 using MemoryPool = detail::mem_pool;
+using MemoryPoolOptions = detail::mem_pool_options;
+using MemoryPoolStats = detail::mem_pool_stats;
 
 } // namespace base 
 } // namespace muduo
@@ -0,0 +1,203 @@
+#include <muduo/base/allocator/span_alloc.h>
+
+#ifdef MUDUO_USE_MEMPOOL
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace muduo::base::detail;
+
+const size_t span_alloc::kMin_Bytes;
+const size_t span_alloc::kMax_Bytes;
+const size_t span_alloc::kSpanBytes;
+const size_t span_alloc::kClassesNum;
+
+namespace {
+const size_t kHeaderBytes = 64;
+const size_t kMinClassShift = 9;    // log2(span_alloc::kMin_Bytes)
+} // namespace
+
+/// The header at the beginning of a span
+struct alignas(kHeaderBytes) span_alloc::span {
+    enum state_t : uint8_t { kCurrent, kPartial, kFull, kReleased };
+
+    span* all_next;     // in span_alloc::allSpans_
+    span* prev;         // in size_class::partial
+    span* next;         // in size_class::partial or span_alloc::releasedList_
+    void* free;         // the blocks freed, linked by their first word
+    char* bump;         // the blocks never handed out are [bump, end)
+    char* end;
+    uint32_t index;     // of the size class
+    uint32_t live;      // the number of blocks handed out
+    state_t state;
+};
+
+span_alloc::span_alloc(size_t max_bytes, bool release_idle_spans, bool huge_pages)
+    : maxBytes_(max_bytes <= kMin_Bytes ? 0 : class_size(class_index(max_bytes < kMax_Bytes ? max_bytes : kMax_Bytes)))
+    , releaseIdleSpans_(release_idle_spans)
+    , hugePages_(huge_pages)
+{
+    static_assert(sizeof(span) == kHeaderBytes, "the span header must fit a cache line");
+}
+
+span_alloc::~span_alloc() noexcept {
+    span* s = allSpans_;
+    while (s != nullptr) {
+        span* next = s->all_next;
+        ::munmap(s, kSpanBytes);
+        s = next;
+    }
+}
+
+size_t span_alloc::class_index(size_t n) {
+    assert(n > kMin_Bytes && n <= kMax_Bytes);
+    // n is in (2^k, 2^(k+1)], which is split to 4 classes of step 2^(k-2)
+    const size_t k = 63 - __builtin_clzll(n - 1);
+    const size_t step = ((n - 1 - (size_t(1) << k)) >> (k - 2));
+    return (k - kMinClassShift) * 4 + step;
+}
+
+size_t span_alloc::class_size(size_t index) {
+    assert(index < kClassesNum);
+    const size_t k = index / 4 + kMinClassShift;
+    return (size_t(1) << k) + (index % 4 + 1) * (size_t(1) << (k - 2));
+}
+
+span_alloc::span* span_alloc::span_of(void* ptr) {
+    return reinterpret_cast<span*>(reinterpret_cast<uintptr_t>(ptr) & ~(kSpanBytes - 1));
+}
+
+void* span_alloc::allocate(size_t n) {
+    assert(n <= maxBytes_);
+    const size_t index = class_index(n);
+    const size_t size = class_size(index);
+    size_class* c = classes_ + index;
+
+    span* s = c->current;
+    if (s == nullptr || (s->free == nullptr && s->bump == s->end)) {
+        if (s != nullptr) {
+            s->state = span::kFull;     // back to partial when a block of it is freed
+        }
+        if (c->partial != nullptr) {
+            s = c->partial;
+            unlink_partial(c, s);
+        } else {
+            s = acquire_span(index);
+        }
+        s->state = span::kCurrent;
+        c->current = s;
+    }
+
+    void* result;
+    if (s->free != nullptr) {
+        result = s->free;
+        s->free = *static_cast<void**>(result);
+    } else {
+        result = s->bump;
+        s->bump += size;
+    }
+    s->live += 1;
+    return result;
+}
+
+void span_alloc::deallocate(void* ptr, size_t n) {
+    span* s = span_of(ptr);
+    assert(s->index == class_index(n));
+    assert(s->live > 0);
+    (void)n;
+
+    *static_cast<void**>(ptr) = s->free;
+    s->free = ptr;
+    s->live -= 1;
+
+    size_class* c = classes_ + s->index;
+    if (s->state == span::kFull) {
+        link_partial(c, s);
+    }
+    if (s->live == 0 && s->state == span::kPartial && releaseIdleSpans_) {
+        unlink_partial(c, s);
+        release_span(s);
+    }
+}
+
+span_alloc::span* span_alloc::acquire_span(size_t index) {
+    span* s = releasedList_;
+    if (s != nullptr) {
+        // the pages returned are faulted in again(zero-filled) on demand
+        releasedList_ = s->next;
+        releasedSpans_.sub(1);
+    } else {
+        // maps twice the size to cut an aligned span out of it
+        const size_t len = 2 * kSpanBytes;
+        void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        const uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+        const uintptr_t aligned = (addr + kSpanBytes - 1) & ~(kSpanBytes - 1);
+        if (aligned > addr) {
+            ::munmap(p, aligned - addr);
+        }
+        if (addr + len > aligned + kSpanBytes) {
+            ::munmap(reinterpret_cast<void*>(aligned + kSpanBytes), addr + len - aligned - kSpanBytes);
+        }
+        if (hugePages_) {
+            ::madvise(reinterpret_cast<void*>(aligned), kSpanBytes, MADV_HUGEPAGE);
+        }
+        s = reinterpret_cast<span*>(aligned);
+        s->all_next = allSpans_;
+        allSpans_ = s;
+        mappedSpans_.add(1);
+    }
+
+    const size_t size = class_size(index);
+    char* begin = reinterpret_cast<char*>(s) + kHeaderBytes;
+    s->prev = nullptr;
+    s->next = nullptr;
+    s->free = nullptr;
+    s->bump = begin;
+    s->end = begin + (kSpanBytes - kHeaderBytes) / size * size;
+    s->index = static_cast<uint32_t>(index);
+    s->live = 0;
+    classBlocks_[index].add((s->end - s->bump) / size);
+    return s;
+}
+
+void span_alloc::release_span(span* s) {
+    // keeps the page of header
+    static const size_t kPageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    ::madvise(reinterpret_cast<char*>(s) + kPageSize, kSpanBytes - kPageSize, MADV_DONTNEED);
+    classBlocks_[s->index].sub((s->end - (reinterpret_cast<char*>(s) + kHeaderBytes)) / class_size(s->index));
+    s->state = span::kReleased;
+    s->next = releasedList_;
+    releasedList_ = s;
+    releasedSpans_.add(1);
+}
+
+void span_alloc::link_partial(size_class* c, span* s) {
+    s->prev = nullptr;
+    s->next = c->partial;
+    if (c->partial != nullptr) {
+        c->partial->prev = s;
+    }
+    c->partial = s;
+    s->state = span::kPartial;
+}
+
+void span_alloc::unlink_partial(size_class* c, span* s) {
+    if (s->prev != nullptr) {
+        s->prev->next = s->next;
+    } else {
+        c->partial = s->next;
+    }
+    if (s->next != nullptr) {
+        s->next->prev = s->prev;
+    }
+    s->prev = nullptr;
+    s->next = nullptr;
+}
+
+#endif
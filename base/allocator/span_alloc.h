@@ -0,0 +1,93 @@
+#if !defined(MUDUO_BASE_ALLOCATOR_SPAN_ALLOC_H)
+#define MUDUO_BASE_ALLOCATOR_SPAN_ALLOC_H
+
+#include <muduo/config.h>
+
+#ifdef MUDUO_USE_MEMPOOL
+#include <muduo/base/allocator/stat_counter.h>
+#include <cstddef>
+
+namespace muduo {
+namespace base {
+namespace detail {
+
+/// @brief Allocator of the blocks larger than @c mem_pool::kMax_Bytes
+///
+/// The sizes are rounded up to classes of 4 steps per power of 2(640, 768, 896, 1024, 1280, ...),
+/// each class carves its blocks from spans: @c kSpanBytes regions mapped from the OS and aligned to their size,
+/// so the span of a block is found by masking its address.
+/// A span which drains empty returns its pages to the OS(madvise(MADV_DONTNEED)) and is kept for any class to reuse,
+/// except the span the class currently allocates from.
+/// @note not thread-safe, see @c mem_pool for the cross-thread deallocation
+/// non-copyable & non-moveable
+class span_alloc {
+    span_alloc(const span_alloc&) = delete;
+    span_alloc& operator=(const span_alloc&) = delete;
+
+public:
+    static const size_t kMin_Bytes = 512;           // exclusive
+    static const size_t kMax_Bytes = 256 * 1024;    // the limit of configured max bytes
+    static const size_t kSpanBytes = 2 * 1024 * 1024;   // the size of a huge page on x86-64
+    static const size_t kClassesNum = 36;           // 4 classes per power of 2 in (kMin_Bytes, kMax_Bytes]
+
+    /// @param max_bytes The largest block served, rounded up to a class and clamped to @c kMax_Bytes,
+    ///     no block is served if it's not greater than @c kMin_Bytes
+    /// @param release_idle_spans Whether returns the pages of empty spans to the OS
+    /// @param huge_pages Whether advises the kernel to back the spans with transparent huge pages
+    span_alloc(size_t max_bytes, bool release_idle_spans, bool huge_pages);
+
+    /// unmaps all the spans
+    ~span_alloc() noexcept;
+
+    /// @brief The largest block served, 0 if none is
+    size_t max_bytes() const { return maxBytes_; }
+
+    /// @pre kMin_Bytes < n <= kMax_Bytes
+    static size_t class_index(size_t n);
+    static size_t class_size(size_t index);
+
+    /// @pre kMin_Bytes < n <= max_bytes()
+    void* allocate(size_t n);
+    /// @pre @c ptr was allocated by @c allocate(n)
+    void deallocate(void* ptr, size_t n);
+
+    /* the statistics may be read in any thread */
+    /// @brief The bytes of address space mapped from the OS
+    size_t mapped_bytes() const { return mappedSpans_.get() * kSpanBytes; }
+    /// @brief The number of empty spans whose pages were returned to the OS
+    size_t released_spans() const { return releasedSpans_.get(); }
+    /// @brief The number of blocks the spans of class @c index can hold
+    size_t class_blocks(size_t index) const { return classBlocks_[index].get(); }
+
+private:
+    struct span;
+    struct size_class {
+        span* current {nullptr};    // the span allocating from
+        span* partial {nullptr};    // the other spans having free blocks, doubly linked
+    };
+
+    static span* span_of(void* ptr);
+    span* acquire_span(size_t index);
+    void release_span(span* s);
+    void link_partial(size_class* c, span* s);
+    void unlink_partial(size_class* c, span* s);
+
+private:
+    const size_t maxBytes_;
+    const bool releaseIdleSpans_;
+    const bool hugePages_;
+    size_class classes_[kClassesNum] {};
+    span* allSpans_ {nullptr};      // every span mapped, to be unmapped in destructor
+    span* releasedList_ {nullptr};  // the empty spans whose pages were returned
+    stat_counter mappedSpans_;
+    stat_counter releasedSpans_;
+    stat_counter classBlocks_[kClassesNum];
+};
+
+} // namespace detail
+} // namespace base
+} // namespace muduo
+
+#endif
+
+#endif // MUDUO_BASE_ALLOCATOR_SPAN_ALLOC_H
@@ -0,0 +1,39 @@
+#if !defined(MUDUO_BASE_ALLOCATOR_STAT_COUNTER_H)
+#define MUDUO_BASE_ALLOCATOR_STAT_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace muduo {
+namespace base {
+namespace detail {
+
+/// @brief A statistic counter written by a single thread and read by any thread
+/// @note The update is a plain load and store(no locked instruction), so it's as cheap as a non-atomic counter,
+///     and the readers never see a torn value
+class stat_counter {
+public:
+    void add(size_t n)
+    { value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    void sub(size_t n)
+    { value_.store(value_.load(std::memory_order_relaxed) - n, std::memory_order_relaxed); }
+
+    void update_max(size_t n) {
+        if (n > value_.load(std::memory_order_relaxed)) {
+            value_.store(n, std::memory_order_relaxed);
+        }
+    }
+
+    size_t get() const
+    { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> value_ {0};
+};
+
+} // namespace detail
+} // namespace base
+} // namespace muduo
+
+#endif // MUDUO_BASE_ALLOCATOR_STAT_COUNTER_H
@@ -0,0 +1,41 @@
+#include <muduo/Poller.h>
+#include <muduo/poller/PollPoller.h>
+#include <muduo/poller/EpollPoller.h>
+#include <muduo/poller/UringPoller.h>
+#include <muduo/base/Logging.h>
+#include <cstdlib>
+#include <cstring>
+
+using namespace muduo;
+
+Poller* Poller::NewDefaultPoller(EventLoop* loop) {
+    const char* backend = ::getenv("MUDUO_POLLER");
+    if (backend != nullptr && std::strcmp(backend, "poll") == 0) {
+        LOG_DEBUG << "EventLoop " << loop << " uses poll(2) as IO-multiplexing";
+#ifdef MUDUO_USE_MEMPOOL
+        return new (loop->GetMemoryPool()) detail::PollPoller(loop);
+#else
+        return new detail::PollPoller(loop);
+#endif
+    }
+
+    if (backend != nullptr && std::strcmp(backend, "uring") == 0) {
+        if (detail::UringPoller::IsSupported()) {
+            LOG_DEBUG << "EventLoop " << loop << " uses io_uring(7) as IO-multiplexing";
+#ifdef MUDUO_USE_MEMPOOL
+            return new (loop->GetMemoryPool()) detail::UringPoller(loop);
+#else
+            return new detail::UringPoller(loop);
+#endif
+        }
+        LOG_WARN << "io_uring(7) is unsupported by the running kernel, fall back to epoll(7)";
+    } else if (backend != nullptr && std::strcmp(backend, "epoll") != 0) {
+        LOG_WARN << "Unknown MUDUO_POLLER=" << backend << ", use epoll(7) by default";
+    }
+    LOG_DEBUG << "EventLoop " << loop << " uses epoll(7) as IO-multiplexing";
+#ifdef MUDUO_USE_MEMPOOL
+    return new (loop->GetMemoryPool()) detail::EpollPoller(loop);
+#else
+    return new detail::EpollPoller(loop);
+#endif
+}
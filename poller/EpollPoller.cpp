@@ -0,0 +1,185 @@
+#include <muduo/poller/EpollPoller.h>
+#include <muduo/base/Logging.h>
+#include <muduo/Channel.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+// Channel uses the poll(2) event-bits, make sure that epoll(7) shares the same values
+static_assert(EPOLLIN == POLLIN,        "epoll uses same flag values as poll");
+static_assert(EPOLLPRI == POLLPRI,      "epoll uses same flag values as poll");
+static_assert(EPOLLOUT == POLLOUT,      "epoll uses same flag values as poll");
+static_assert(EPOLLRDHUP == POLLRDHUP,  "epoll uses same flag values as poll");
+static_assert(EPOLLERR == POLLERR,      "epoll uses same flag values as poll");
+static_assert(EPOLLHUP == POLLHUP,      "epoll uses same flag values as poll");
+
+namespace {
+    /// the state of channel in epoll instance, saved in Channel::Index()
+    const int kNew = -1;    // never been added
+    const int kAdded = 1;   // is being monitored
+    const int kDeleted = 2; // had been removed from epoll instance, but still in channel-map
+} // namespace
+
+using namespace muduo;
+using namespace muduo::detail;
+
+#ifdef MUDUO_USE_MEMPOOL
+    EpollPoller::EpollPoller(EventLoop* loop)
+        : Poller(loop)
+        , epollfd_(::epoll_create1(EPOLL_CLOEXEC))
+        , events_(kInitEventListSize, epoll_event(), loop->GetMemoryPool())
+        , channels_(loop->GetMemoryPool())
+    {
+        if (epollfd_ < 0) {
+            LOG_SYSFATAL << "EpollPoller::EpollPoller";
+        }
+    }
+#else
+    EpollPoller::EpollPoller(EventLoop* loop)
+        : Poller(loop)
+        , epollfd_(::epoll_create1(EPOLL_CLOEXEC))
+        , events_(kInitEventListSize)
+        , channels_()
+    {
+        if (epollfd_ < 0) {
+            LOG_SYSFATAL << "EpollPoller::EpollPoller";
+        }
+    }
+#endif
+
+EpollPoller::~EpollPoller() noexcept {
+    ::close(epollfd_);
+}
+
+Poller::ReceiveTimePoint_t EpollPoller::Poll(const TimeoutDuration_t& timeout, ChannelList* activeChannels) {
+    int numReady = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), static_cast<int>(timeout.count()));
+    int savedErrno = errno;
+    // Get now-timestamp when epoll_wait(2) is awaked
+    auto now = std::chrono::system_clock::now();
+    if (numReady > 0) {
+        LOG_TRACE << numReady << " events happened.";
+        FillActiveChannels(numReady, activeChannels);
+        if (static_cast<EventList::size_type>(numReady) == events_.size()) {
+            // the event-list is full, so enlarge it for next polling
+            events_.resize(events_.size() * 2);
+        }
+    } else if (numReady == 0) {
+        LOG_TRACE << numReady << " nothing happened";
+    } else {
+        if (savedErrno != EINTR) {
+            errno = savedErrno;
+            LOG_SYSERR << "EpollPoller::Poll - " << muduo::strerror_thread_safe(savedErrno);
+        }
+    }
+    return now;
+}
+
+void EpollPoller::FillActiveChannels(int numReadyEvents, ChannelList* activeChannels) const {
+    assert(static_cast<EventList::size_type>(numReadyEvents) <= events_.size());
+    for (int i = 0; i < numReadyEvents; i++) {
+        Channel* current_target_channel = static_cast<Channel*>(events_[i].data.ptr);
+#ifndef NDEBUG
+        auto target_pair = channels_.find(current_target_channel->FileDescriptor());
+        assert(target_pair != channels_.end());
+        assert(target_pair->second == current_target_channel);
+#endif
+        current_target_channel->Set_REvent(static_cast<int>(events_[i].events));
+#ifdef MUDUO_USE_MEMPOOL
+        activeChannels->push_front(current_target_channel);
+#else
+        activeChannels->push_back(current_target_channel);
+#endif
+    }
+}
+
+void EpollPoller::UpdateChannel(Channel* c) {
+    Poller::AssertInLoopThread();
+    const int state = c->Index();
+    const int fd = c->FileDescriptor();
+    LOG_TRACE << "Update channel fd=" << fd << ", events=" << c->CurrentEvent() << ", state=" << state;
+
+    if (state == kNew || state == kDeleted) {
+        if (state == kNew) {    // a new channel, put it into the channel-map
+            assert(channels_.find(fd) == channels_.end());
+            channels_[fd] = c;
+        } else {    // state == kDeleted
+            assert(channels_.find(fd) != channels_.end());
+            assert(channels_[fd] == c);
+        }
+        // 不关注任何事件的通道无需加入epoll实例
+        if (c->IsNoneEvent()) {
+            c->SetIndex(kDeleted);
+            return;
+        }
+        c->SetIndex(kAdded);
+        Update(EPOLL_CTL_ADD, c);
+    } else {    // the channel is being monitored, update it with EPOLL_CTL_MOD/DEL
+        assert(state == kAdded);
+        assert(channels_.find(fd) != channels_.end());
+        assert(channels_[fd] == c);
+        if (c->IsNoneEvent()) {
+            // 将一个通道暂时更改为不关注事件，从epoll实例中删除，但保留在channel-map中
+            Update(EPOLL_CTL_DEL, c);
+            c->SetIndex(kDeleted);
+        } else {
+            Update(EPOLL_CTL_MOD, c);
+        }
+    }
+}
+
+void EpollPoller::RemoveChannel(Channel* c) {
+    Poller::AssertInLoopThread();
+    const int fd = c->FileDescriptor();
+    const int state = c->Index();
+    LOG_TRACE << "Remove channel fd=" << fd;
+    assert(channels_.find(fd) != channels_.end());
+    assert(channels_[fd] == c);
+    assert(c->IsNoneEvent()); // NOTE:只有当前channel不关注任何事件才可以被remove
+    assert(state == kAdded || state == kDeleted);
+
+    auto ret = channels_.erase(fd);
+    assert(ret == 1); (void)ret;
+
+    if (state == kAdded) {
+        Update(EPOLL_CTL_DEL, c);
+    }
+    c->SetIndex(kNew);
+}
+
+void EpollPoller::Update(int operation, Channel* c) {
+    struct epoll_event event;
+    ::memset(&event, 0, sizeof event);
+    event.events = static_cast<uint32_t>(c->CurrentEvent());
+    if (c->IsEdgeTriggered()) {
+        event.events |= EPOLLET;
+    }
+    event.data.ptr = c;
+    const int fd = c->FileDescriptor();
+    LOG_TRACE << "epoll_ctl op=" << OperationToString(operation)
+            << " fd=" << fd << " event={ " << c->EventTostring() << "}";
+
+    if (::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
+        if (operation == EPOLL_CTL_DEL) {
+            LOG_SYSERR << "epoll_ctl op=" << OperationToString(operation) << " fd=" << fd;
+        } else {
+            LOG_SYSFATAL << "epoll_ctl op=" << OperationToString(operation) << " fd=" << fd;
+        }
+    }
+}
+
+const char* EpollPoller::OperationToString(int op) {
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        return "ADD";
+    case EPOLL_CTL_DEL:
+        return "DEL";
+    case EPOLL_CTL_MOD:
+        return "MOD";
+    default:
+        assert(false && "ERROR op");
+        return "Unknown Operation";
+    }
+}
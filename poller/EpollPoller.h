@@ -0,0 +1,54 @@
+#if !defined(MUDUO_POLLER_EPOLLPOLLER_H)
+#define MUDUO_POLLER_EPOLLPOLLER_H
+
+#include <muduo/Poller.h>
+#include <unordered_map>
+
+struct epoll_event; // forward declaration for struct epoll_event in header file sys/epoll.h
+
+namespace muduo {
+namespace detail {
+
+/**
+ * IO Multiplexing with epoll(7).
+ * Use Channel::Index() to save the state of channel in epoll instance(new/added/deleted)
+*/
+class EpollPoller : public Poller {
+#ifdef MUDUO_USE_MEMPOOL
+private:
+    using EventList = std::vector<struct epoll_event, base::allocator<struct epoll_event>>;
+    using ChannelMap = std::unordered_map<int, Channel*, std::hash<int>, std::equal_to<int>, base::allocator<std::pair<const int, Channel*>>>;
+#else
+private:
+    using EventList = std::vector<struct epoll_event>;
+    using ChannelMap = std::unordered_map<int, Channel*>;
+#endif
+
+public:
+    /// Constructor
+    EpollPoller(EventLoop* loop);
+    virtual ~EpollPoller() noexcept override;
+
+    virtual ReceiveTimePoint_t Poll(const TimeoutDuration_t& timeout, ChannelList* activeChannels) override;
+    virtual void UpdateChannel(Channel* c) override;
+    virtual void RemoveChannel(Channel* c) override;
+    virtual bool SupportsEdgeTriggered() const override { return true; }
+
+private:
+    static const int kInitEventListSize = 16;
+
+    void FillActiveChannels(int numReadyEvents, ChannelList* activeChannels) const;
+    /// @brief Invokes epoll_ctl(2) with the specified operation
+    void Update(int operation, Channel* c);
+    static const char* OperationToString(int op);
+
+private:
+    int epollfd_;
+    EventList events_;  // receive ready events from epoll_wait(2)
+    ChannelMap channels_;
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_POLLER_EPOLLPOLLER_H
@@ -44,6 +44,8 @@ void muduo::detail::PollPoller::UpdateChannel(Channel* c) {
         assert(channels_[c->FileDescriptor()] == c);
         assert(c->Index() >= 0 && static_cast<size_t>(c->Index()) < pollfds_.size());
         struct pollfd* pfd = &pollfds_[c->Index()]; 
+        assert(pfd->fd == c->FileDescriptor() || pfd->fd == -(c->FileDescriptor()) - 1);
+        pfd->fd = c->FileDescriptor();  // 恢复之前可能被忽略的fd
         pfd->events = static_cast<decltype(pollfd::events)>(c->CurrentEvent());
         pfd->revents = 0;
 
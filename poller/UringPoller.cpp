@@ -0,0 +1,958 @@
+#include <muduo/poller/UringPoller.h>
+#include <muduo/base/Logging.h>
+#include <muduo/Channel.h>
+#include <muduo/Buffer.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+namespace {
+
+int io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t argsz) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+/// the features which UringPoller depends on
+const unsigned kRequiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+/// SQ and CQ rings which share one mapping(IORING_FEAT_SINGLE_MMAP), and the SQE array
+struct RingMapping {
+    void* rings;
+    size_t ringsSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+};
+
+/// @return false on failure, @c errno is set
+bool MapRing(int ringfd, const struct io_uring_params& p, RingMapping* mapping) {
+    const size_t sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    const size_t cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    mapping->ringsSize = std::max(sqRingSize, cqRingSize);
+    mapping->rings = ::mmap(nullptr, mapping->ringsSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+    if (mapping->rings == MAP_FAILED) {
+        return false;
+    }
+    mapping->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = ::mmap(nullptr, mapping->sqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringfd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        int savedErrno = errno;
+        ::munmap(mapping->rings, mapping->ringsSize);
+        errno = savedErrno;
+        return false;
+    }
+    mapping->sqes = static_cast<struct io_uring_sqe*>(sqes);
+    return true;
+}
+
+void UnmapRing(const RingMapping& mapping) {
+    ::munmap(mapping.sqes, mapping.sqesSize);
+    ::munmap(mapping.rings, mapping.ringsSize);
+}
+
+/// @brief Submits sqe with a scratch ring and waits for its first completion
+/// @return false if nothing was completed
+bool SubmitAndWait(int ringfd, const struct io_uring_params& p, const RingMapping& mapping,
+        const struct io_uring_sqe& sqe, struct io_uring_cqe* cqe) {
+    char* ring = static_cast<char*>(mapping.rings);
+    unsigned* sqTail = reinterpret_cast<unsigned*>(ring + p.sq_off.tail);
+    const unsigned sqMask = *reinterpret_cast<unsigned*>(ring + p.sq_off.ring_mask);
+    unsigned* sqArray = reinterpret_cast<unsigned*>(ring + p.sq_off.array);
+    const unsigned index = *sqTail & sqMask;
+    mapping.sqes[index] = sqe;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+
+    if (io_uring_enter(ringfd, 1, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+        return false;
+    }
+    unsigned* cqHead = reinterpret_cast<unsigned*>(ring + p.cq_off.head);
+    const unsigned* cqTail = reinterpret_cast<unsigned*>(ring + p.cq_off.tail);
+    const unsigned cqMask = *reinterpret_cast<unsigned*>(ring + p.cq_off.ring_mask);
+    const struct io_uring_cqe* cqes = reinterpret_cast<struct io_uring_cqe*>(ring + p.cq_off.cqes);
+    if (*cqHead == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *cqe = cqes[*cqHead & cqMask];
+    __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Submits a multishot poll request on a readable eventfd with a scratch ring.
+ * The kernels before 5.13 reject the request with -EINVAL, the newer ones complete it with IORING_CQE_F_MORE
+*/
+bool ProbeMultishotPoll() {
+    struct io_uring_params p;
+    ::memset(&p, 0, sizeof p);
+    int ringfd = io_uring_setup(2, &p);
+    if (ringfd < 0) {
+        return false;
+    }
+    bool multishot = false;
+    RingMapping mapping;
+    int evfd = ::eventfd(1, EFD_CLOEXEC|EFD_NONBLOCK);  // readable already, so the request completes at once
+    if (evfd >= 0 && MapRing(ringfd, p, &mapping)) {
+        struct io_uring_sqe sqe;
+        ::memset(&sqe, 0, sizeof sqe);
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.fd = evfd;
+        sqe.poll32_events = POLLIN;
+        sqe.len = IORING_POLL_ADD_MULTI;
+        sqe.user_data = 1;
+        struct io_uring_cqe cqe;
+        if (SubmitAndWait(ringfd, p, mapping, sqe, &cqe)) {
+            multishot = (cqe.res > 0) && (cqe.flags & IORING_CQE_F_MORE);
+        }
+        UnmapRing(mapping);
+    }
+    if (evfd >= 0) {
+        ::close(evfd);
+    }
+    ::close(ringfd);    // cancels the request
+    return multishot;
+}
+
+/**
+ * Receives a byte from a socket pair with a multishot recv request which picks a provided buffer, with a scratch ring.
+ * Multishot recv needs 6.0, the older kernels reject it. Multishot accept(5.19), SENDMSG and ASYNC_CANCEL are older.
+ * @param ring provides the buffer by a registered buffer ring(5.19), otherwise by IORING_OP_PROVIDE_BUFFERS
+*/
+bool ProbeMultishotRecv(bool ring) {
+    struct io_uring_params p;
+    ::memset(&p, 0, sizeof p);
+    int ringfd = io_uring_setup(4, &p);
+    if (ringfd < 0) {
+        return false;
+    }
+    bool supported = false;
+    RingMapping mapping;
+    int fds[2] = {-1, -1};
+    const long pageSize = ::sysconf(_SC_PAGESIZE);
+    void* bufRing = ::mmap(nullptr, pageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    char data[16];
+    if (bufRing != MAP_FAILED
+        && ::socketpair(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0, fds) == 0
+        && MapRing(ringfd, p, &mapping)) {
+        struct io_uring_sqe sqe;
+        struct io_uring_cqe cqe;
+        bool provided = false;
+        if (ring) {
+            struct io_uring_buf_reg reg;
+            ::memset(&reg, 0, sizeof reg);
+            reg.ring_addr = reinterpret_cast<uint64_t>(bufRing);
+            reg.ring_entries = 1;
+            reg.bgid = 0;
+            if (io_uring_register(ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0) {
+                struct io_uring_buf_ring* br = static_cast<struct io_uring_buf_ring*>(bufRing);
+                br->bufs[0].addr = reinterpret_cast<uint64_t>(data);
+                br->bufs[0].len = sizeof data;
+                br->bufs[0].bid = 0;
+                __atomic_store_n(&br->tail, 1, __ATOMIC_RELEASE);
+                provided = true;
+            }
+        } else {
+            ::memset(&sqe, 0, sizeof sqe);
+            sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe.fd = 1;     // number of buffers
+            sqe.addr = reinterpret_cast<uint64_t>(data);
+            sqe.len = sizeof data;
+            sqe.buf_group = 0;
+            sqe.off = 0;    // first buffer id
+            sqe.user_data = 2;
+            provided = SubmitAndWait(ringfd, p, mapping, sqe, &cqe) && cqe.res >= 0;
+        }
+
+        if (provided && ::write(fds[1], "x", 1) == 1) {
+            ::memset(&sqe, 0, sizeof sqe);
+            sqe.opcode = IORING_OP_RECV;
+            sqe.fd = fds[0];
+            sqe.ioprio = IORING_RECV_MULTISHOT;
+            sqe.flags = IOSQE_BUFFER_SELECT;
+            sqe.buf_group = 0;
+            sqe.user_data = 1;
+            if (SubmitAndWait(ringfd, p, mapping, sqe, &cqe)) {
+                supported = (cqe.res == 1) && (cqe.flags & IORING_CQE_F_BUFFER) && (cqe.flags & IORING_CQE_F_MORE);
+            }
+        }
+        UnmapRing(mapping);
+    }
+    ::close(ringfd);    // cancels the request, before the buffer is gone
+    if (fds[0] >= 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+    if (bufRing != MAP_FAILED) {
+        ::munmap(bufRing, pageSize);
+    }
+    return supported;
+}
+
+struct ProbeResult {
+    bool supported;
+    bool multishot;
+    bool completion;
+    bool bufferRing;    // provides the buffers of completion mode by a registered ring
+};
+
+ProbeResult ProbeKernel() {
+    struct io_uring_params p;
+    ::memset(&p, 0, sizeof p);
+    int fd = io_uring_setup(1, &p);
+    if (fd < 0) {
+        LOG_DEBUG << "io_uring is unavailable, detail: " << strerror_thread_safe(errno);
+        return ProbeResult {false, false, false, false};
+    }
+    ::close(fd);
+    const bool supported = (p.features & kRequiredFeatures) == kRequiredFeatures;
+    if (!supported) {
+        return ProbeResult {false, false, false, false};
+    }
+    // some kernels accept the registration of a buffer ring but never pick its buffers, fall back to the older interface
+    const bool bufferRing = ProbeMultishotRecv(true);
+    return ProbeResult {true, ProbeMultishotPoll(), bufferRing || ProbeMultishotRecv(false), bufferRing};
+}
+
+const ProbeResult& GetProbeResult() {
+    static const ProbeResult result = ProbeKernel();  // thread-safe since C++ 11
+    return result;
+}
+
+} // namespace
+
+const unsigned UringPoller::kRingEntries;
+const unsigned UringPoller::kRecvBufferCount;
+const unsigned UringPoller::kRecvBufferSize;
+const uint16_t UringPoller::kRecvBufferGroup;
+const uint32_t UringPoller::kNoBuffer;
+
+bool UringPoller::IsSupported() {
+    return GetProbeResult().supported;
+}
+
+UringPoller::UringPoller(EventLoop* loop)
+    : Poller(loop)
+    , ringfd_(-1)
+    , multishotSupported_(GetProbeResult().multishot)
+    , completionSupported_(GetProbeResult().completion)
+    , bufferRing_(GetProbeResult().bufferRing)
+    , sqRing_(nullptr)
+    , sqRingSize_(0)
+    , cqRing_(nullptr)
+    , cqRingSize_(0)
+    , sqes_(nullptr)
+    , sqesSize_(0)
+    , localSqTail_(0)
+    , toSubmit_(0)
+    , pollRound_(0)
+#ifdef MUDUO_USE_MEMPOOL
+    , slots_(loop->GetMemoryPool())
+    , freeSlots_(loop->GetMemoryPool())
+    , dirtySlots_(loop->GetMemoryPool())
+    , readySlots_(loop->GetMemoryPool())
+    , starvedSlots_(loop->GetMemoryPool())
+#endif
+    , bufRing_(nullptr)
+    , bufRingSize_(0)
+    , recvBuffers_(nullptr)
+    , bufRingTail_(0)
+    , freeBuffers_(0)
+#ifdef MUDUO_USE_MEMPOOL
+    , nextBuffer_(loop->GetMemoryPool())
+    , bufferBytes_(loop->GetMemoryPool())
+    , recycledBuffers_(loop->GetMemoryPool())
+#endif
+{
+    assert(IsSupported());
+    SetupRing();
+}
+
+UringPoller::~UringPoller() noexcept {
+    ::munmap(sqes_, sqesSize_);
+    if (cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    ::munmap(sqRing_, sqRingSize_);
+    ::close(ringfd_);   // cancels the in-flight requests, so the buffers and iovecs are released after it
+    if (recvBuffers_ != nullptr) {
+        ::munmap(recvBuffers_, static_cast<size_t>(kRecvBufferCount) * kRecvBufferSize);
+    }
+    if (bufRing_ != nullptr) {
+        ::munmap(bufRing_, bufRingSize_);
+    }
+    for (Slot& slot : slots_) {
+        for (int fd : slot.accepted) {
+            ::close(fd);
+        }
+    }
+}
+
+void UringPoller::SetupRing() {
+    struct io_uring_params p;
+    ::memset(&p, 0, sizeof p);
+    ringfd_ = io_uring_setup(kRingEntries, &p);
+    if (ringfd_ < 0) {
+        LOG_SYSFATAL << "UringPoller::SetupRing - io_uring_setup";
+    }
+    ::fcntl(ringfd_, F_SETFD, FD_CLOEXEC);
+
+    RingMapping mapping;
+    if (!MapRing(ringfd_, p, &mapping)) {
+        LOG_SYSFATAL << "UringPoller::SetupRing - mmap";
+    }
+    // IORING_FEAT_SINGLE_MMAP: SQ and CQ rings are mapped with a single mmap(2) call
+    sqRing_ = cqRing_ = mapping.rings;
+    sqRingSize_ = cqRingSize_ = mapping.ringsSize;
+    sqes_ = mapping.sqes;
+    sqesSize_ = mapping.sqesSize;
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    localSqTail_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+}
+
+void UringPoller::SetupRecvBuffers() {
+    if (recvBuffers_ != nullptr) {
+        return;
+    }
+    void* buffers = ::mmap(nullptr, static_cast<size_t>(kRecvBufferCount) * kRecvBufferSize,
+            PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) {
+        LOG_SYSFATAL << "UringPoller::SetupRecvBuffers - mmap";
+    }
+    if (bufferRing_) {
+        bufRingSize_ = kRecvBufferCount * sizeof(struct io_uring_buf);
+        void* ring = ::mmap(nullptr, bufRingSize_, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            LOG_SYSFATAL << "UringPoller::SetupRecvBuffers - mmap";
+        }
+        struct io_uring_buf_reg reg;
+        ::memset(&reg, 0, sizeof reg);
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = kRecvBufferCount;
+        reg.bgid = kRecvBufferGroup;
+        if (io_uring_register(ringfd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            LOG_SYSFATAL << "UringPoller::SetupRecvBuffers - io_uring_register";
+        }
+        bufRing_ = static_cast<struct io_uring_buf_ring*>(ring);
+    }
+    recvBuffers_ = static_cast<char*>(buffers);
+    nextBuffer_.assign(kRecvBufferCount, kNoBuffer);
+    bufferBytes_.assign(kRecvBufferCount, 0);
+    for (uint32_t bid = 0; bid < kRecvBufferCount; bid++) {
+        RecycleBuffer(bid);
+    }
+    ProvideRecycledBuffers();   // ahead of the first recv request
+}
+
+void UringPoller::RecycleBuffer(uint32_t bid) {
+    freeBuffers_ += 1;
+    if (!bufferRing_) {
+        recycledBuffers_.push_back(bid);
+        return;
+    }
+    struct io_uring_buf* buf = &bufRing_->bufs[bufRingTail_ & (kRecvBufferCount - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+    buf->len = kRecvBufferSize;
+    buf->bid = static_cast<uint16_t>(bid);
+    bufRingTail_ += 1;
+    __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+}
+
+void UringPoller::ProvideRecycledBuffers() {
+    if (recycledBuffers_.empty()) {
+        return;
+    }
+    std::sort(recycledBuffers_.begin(), recycledBuffers_.end());
+    SlotIndexList::size_type first = 0;
+    for (SlotIndexList::size_type i = 1; i <= recycledBuffers_.size(); i++) {
+        if (i < recycledBuffers_.size() && recycledBuffers_[i] == recycledBuffers_[i - 1] + 1) {
+            continue;
+        }
+        const uint32_t bid = recycledBuffers_[first];
+        struct io_uring_sqe* sqe = GetSqe();
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int>(i - first);  // number of buffers
+        sqe->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+        sqe->len = kRecvBufferSize;
+        sqe->buf_group = kRecvBufferGroup;
+        sqe->off = bid;
+        sqe->user_data = 0;
+        first = i;
+    }
+    recycledBuffers_.clear();
+}
+
+Poller::ReceiveTimePoint_t UringPoller::Poll(const TimeoutDuration_t& timeout, ChannelList* activeChannels) {
+    // the recv requests starved of buffers retry, the buffers taken since last polling are back in the ring
+    for (uint32_t idx : starvedSlots_) {
+        MarkDirty(idx);
+    }
+    starvedSlots_.clear();
+    // ahead of the recv requests re-armed below, the SQEs are issued in order
+    ProvideRecycledBuffers();
+    // re-arm the poll requests which were changed OR completed since last polling
+    SlotIndexList::size_type n = dirtySlots_.size();
+    for (SlotIndexList::size_type i = 0; i < n; i++) {
+        SyncSlot(dirtySlots_[i]);
+    }
+    dirtySlots_.clear();
+    // the results not taken are reported again, so don't wait for new completions then
+    PruneReadySlots();
+    const bool waiting = timeout.count() > 0 && readySlots_.empty();
+
+    // submits the prepared SQEs and waits for completions in one system call
+    int ret = Enter(waiting ? 1 : 0, IORING_ENTER_GETEVENTS, &timeout);
+    int savedErrno = errno;
+    // Get now-timestamp when io_uring_enter(2) is awaked
+    auto now = std::chrono::system_clock::now();
+    if (ret < 0 && savedErrno != ETIME && savedErrno != EINTR && savedErrno != EBUSY) {
+        errno = savedErrno;
+        LOG_SYSERR << "UringPoller::Poll - " << muduo::strerror_thread_safe(savedErrno);
+    }
+    FillActiveChannels(activeChannels);
+    return now;
+}
+
+void UringPoller::FillActiveChannels(ChannelList* activeChannels) {
+    pollRound_ += 1;
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    int numEvents = 0;
+    for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &cqes_[head & cqMask_];
+        const uint64_t token = cqe->user_data;
+        if (token == 0) {
+            continue;   // completion of poll-remove OR cancel request
+        }
+        const uint32_t idx = static_cast<uint32_t>(token & 0x0fffffffu) - 1;
+        const RequestOp op = static_cast<RequestOp>((token >> 28) & 0xfu);
+        const uint32_t generation = static_cast<uint32_t>(token >> 32);
+        if (op == kSendOp || op == kWritableOp) {
+            SendState* send = idx < slots_.size() ? slots_[idx].send.get() : nullptr;
+            if (send == nullptr || !send->inFlight || send->token != token) {
+                HandleStaleCompletion(token, op, cqe);  // the channel was removed
+                continue;
+            }
+            send->inFlight = false;
+            send->completed = true;
+            send->result = (op == kWritableOp && cqe->res > 0) ? 0 : cqe->res;
+            releasedHolders_.push_back(std::move(send->holder));
+            Activate(&slots_[idx], POLLOUT, activeChannels, &numEvents);
+            continue;
+        }
+        if (idx >= slots_.size() || slots_[idx].channel == nullptr || slots_[idx].generation != generation) {
+            HandleStaleCompletion(token, op, cqe);  // of a removed OR replaced request
+            continue;
+        }
+        if (op != kPollOp) {
+            HandleCompletion(idx, op, cqe);     // reported with the other ready slots below
+            continue;
+        }
+
+        Slot& slot = slots_[idx];
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            // the poll request is terminated, re-arm it before next waiting if still interested
+            slot.armed = false;
+            MarkDirty(idx);
+        }
+        if (cqe->res < 0) {
+            if (cqe->res == -ECANCELED) {
+                continue;
+            }
+            LOG_ERROR << "UringPoller: poll request of fd=" << slot.channel->FileDescriptor()
+                    << " failed, detail: " << strerror_thread_safe(-cqe->res);
+            if (slot.multishot && cqe->res == -EINVAL) {
+                multishotSupported_ = false;    // the kernel rejects multishot poll
+            }
+            continue;
+        }
+        Activate(&slot, cqe->res, activeChannels, &numEvents);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    // the received OR accepted results of this round, and the ones left by the previous rounds
+    for (uint32_t idx : readySlots_) {
+        Slot& slot = slots_[idx];
+        if (slot.channel != nullptr && (slot.channel->CurrentEvent() & POLLIN)) {
+            Activate(&slot, POLLIN, activeChannels, &numEvents);
+        }
+    }
+    releasedHolders_.clear();
+
+    if (numEvents > 0) {
+        LOG_TRACE << numEvents << " events happened.";
+    } else {
+        LOG_TRACE << numEvents << " nothing happened";
+    }
+}
+
+void UringPoller::Activate(Slot* slot, int revents, ChannelList* activeChannels, int* numEvents) {
+    if (slot->activeStamp != pollRound_) {
+        slot->activeStamp = pollRound_;
+        slot->revents = revents;
+        *numEvents += 1;
+#ifdef MUDUO_USE_MEMPOOL
+        activeChannels->push_front(slot->channel);
+#else
+        activeChannels->push_back(slot->channel);
+#endif
+    } else {
+        slot->revents |= revents;   // multishot request completes more than once
+    }
+    slot->channel->Set_REvent(slot->revents);
+}
+
+void UringPoller::HandleCompletion(uint32_t idx, RequestOp op, const struct io_uring_cqe* cqe) {
+    Slot& slot = slots_[idx];
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        // the multishot request is terminated, re-armed before next waiting if still interested
+        slot.armed = false;
+        slot.cancelling = false;
+        MarkDirty(idx);
+    }
+    if (op == kRecvOp) {
+        if (cqe->res > 0) {
+            assert(cqe->flags & IORING_CQE_F_BUFFER);
+            const uint32_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            freeBuffers_ -= 1;
+            bufferBytes_[bid] = static_cast<uint32_t>(cqe->res);
+            nextBuffer_[bid] = kNoBuffer;
+            if (slot.recvTail == kNoBuffer) {
+                slot.recvHead = bid;
+            } else {
+                nextBuffer_[slot.recvTail] = bid;
+            }
+            slot.recvTail = bid;
+        } else if (cqe->res == 0) {
+            slot.recvState = kEofPending;   // not re-armed
+        } else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+            // reported before the end of file, see TakeReceived
+            slot.recvError = -cqe->res;
+            slot.recvState = kEofPending;
+        }   // -ENOBUFS: all buffers are held by the slots, re-armed once there are free ones
+    } else {
+        assert(op == kAcceptOp);
+        if (cqe->res >= 0) {
+            slot.accepted.push_back(cqe->res);
+        } else if (cqe->res != -ECANCELED) {
+            slot.acceptError = -cqe->res;
+        }
+    }
+    if (HasPending(slot)) {
+        MarkReady(idx);
+    }
+}
+
+void UringPoller::HandleStaleCompletion(uint64_t token, RequestOp op, const struct io_uring_cqe* cqe) {
+    switch (op) {
+    case kRecvOp:
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            freeBuffers_ -= 1;
+            RecycleBuffer(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+        break;
+    case kAcceptOp:
+        if (cqe->res >= 0) {
+            ::close(cqe->res);  // nobody takes it
+        }
+        break;
+    case kSendOp:
+    case kWritableOp: {
+        auto it = std::find_if(retiredSends_.begin(), retiredSends_.end(),
+            [token](const std::unique_ptr<SendState>& send) { return send->token == token; });
+        if (it != retiredSends_.end()) {
+            releasedHolders_.push_back(std::move((*it)->holder));
+            retiredSends_.erase(it);
+        }
+        break;
+    }
+    case kPollOp:
+        break;
+    }
+}
+
+bool UringPoller::HasPending(const Slot& slot) {
+    return slot.recvHead != kNoBuffer || slot.recvState == kEofPending || slot.recvError != 0
+        || !slot.accepted.empty() || slot.acceptError != 0;
+}
+
+void UringPoller::MarkReady(uint32_t idx) {
+    if (!slots_[idx].ready) {
+        slots_[idx].ready = true;
+        readySlots_.push_back(idx);
+    }
+}
+
+void UringPoller::PruneReadySlots() {
+    auto end = std::remove_if(readySlots_.begin(), readySlots_.end(), [this](uint32_t idx) {
+        Slot& slot = slots_[idx];
+        if (slot.channel != nullptr && HasPending(slot) && (slot.channel->CurrentEvent() & POLLIN)) {
+            return false;
+        }
+        slot.ready = false; // marked again by the next result, OR when the reading is enabled again
+        return true;
+    });
+    readySlots_.erase(end, readySlots_.end());
+}
+
+void UringPoller::UpdateChannel(Channel* c) {
+    Poller::AssertInLoopThread();
+    LOG_TRACE << "Update channel fd=" << c->FileDescriptor() << ", events=" << c->CurrentEvent();
+    if (c->Index() < 0) {   // a new channel, assign a slot for it
+        uint32_t idx = 0;
+        if (!freeSlots_.empty()) {
+            idx = freeSlots_.back();
+            freeSlots_.pop_back();
+        } else {
+            idx = static_cast<uint32_t>(slots_.size());
+            assert(idx + 1 < (1u << 28));   // fits the token
+            slots_.emplace_back();
+        }
+        Slot& slot = slots_[idx];
+        assert(slot.channel == nullptr && !slot.armed && !HasPending(slot));
+        slot.channel = c;
+        slot.activeStamp = 0;
+        slot.op = kPollOp;
+        slot.cancelling = false;
+        c->SetIndex(idx);
+    }
+    assert(static_cast<size_t>(c->Index()) < slots_.size());
+    assert(slots_[c->Index()].channel == c);
+    // the change takes effect before next waiting, so the changes in one iteration are batched
+    MarkDirty(static_cast<uint32_t>(c->Index()));
+    if (HasPending(slots_[c->Index()])) {
+        MarkReady(static_cast<uint32_t>(c->Index()));   // the reading may be enabled again
+    }
+}
+
+void UringPoller::RemoveChannel(Channel* c) {
+    Poller::AssertInLoopThread();
+    LOG_TRACE << "Remove channel fd=" << c->FileDescriptor();
+    assert(c->IsNoneEvent()); // NOTE:只有当前channel不关注任何事件才可以被remove
+    assert(c->Index() >= 0 && static_cast<size_t>(c->Index()) < slots_.size());
+    const uint32_t idx = static_cast<uint32_t>(c->Index());
+    Slot& slot = slots_[idx];
+    assert(slot.channel == c);
+
+    // the in-flight requests hold a reference of the file until cancelled,
+    // the cancellations are submitted with the wait of next Poll, so removing costs no system call.
+    // Their completions carry the old generation, and are ignored
+    if (slot.armed) {
+        if (slot.op == kPollOp) {
+            PrepPollRemove(idx);
+        } else if (!slot.cancelling) {
+            PrepCancel(SlotToken(idx));
+        }
+    }
+    if (slot.send && slot.send->inFlight) {
+        // the kernel may still read the iovecs, they are kept with their holder until the completion
+        PrepCancel(slot.send->token);
+        retiredSends_.push_back(std::move(slot.send));
+    } else if (slot.send) {
+        slot.send->completed = false;   // the result is never taken
+    }
+    ReleasePending(&slot);
+    slot.channel = nullptr;
+    slot.generation += 1;
+    slot.armed = false;
+    freeSlots_.push_back(idx);
+    c->SetIndex(-1);
+}
+
+void UringPoller::ReleasePending(Slot* slot) {
+    while (slot->recvHead != kNoBuffer) {
+        const uint32_t bid = slot->recvHead;
+        slot->recvHead = nextBuffer_[bid];
+        RecycleBuffer(bid);
+    }
+    slot->recvTail = kNoBuffer;
+    slot->recvState = kReceiving;
+    slot->recvError = 0;
+    for (int fd : slot->accepted) {
+        ::close(fd);
+    }
+    slot->accepted.clear();
+    slot->acceptError = 0;
+}
+
+ssize_t UringPoller::TakeReceived(Channel* c, Buffer* buf, int* savedErrno) {
+    Poller::AssertInLoopThread();
+    Slot& slot = slots_[c->Index()];
+    assert(slot.channel == c);
+    size_t total = 0;
+    while (slot.recvHead != kNoBuffer) {
+        const uint32_t bid = slot.recvHead;
+        buf->Append(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize, bufferBytes_[bid]);
+        total += bufferBytes_[bid];
+        slot.recvHead = nextBuffer_[bid];
+        RecycleBuffer(bid);
+    }
+    slot.recvTail = kNoBuffer;
+    if (total > 0) {
+        return static_cast<ssize_t>(total);
+    }
+    if (slot.recvError != 0) {
+        *savedErrno = slot.recvError;
+        slot.recvError = 0;
+        return -1;
+    }
+    if (slot.recvState != kReceiving) {
+        slot.recvState = kEofTaken;
+        return 0;
+    }
+    *savedErrno = EAGAIN;
+    return -1;
+}
+
+int UringPoller::TakeAccepted(Channel* c, int* savedErrno) {
+    Poller::AssertInLoopThread();
+    Slot& slot = slots_[c->Index()];
+    assert(slot.channel == c);
+    if (!slot.accepted.empty()) {
+        int fd = slot.accepted.front();
+        slot.accepted.pop_front();
+        return fd;
+    }
+    if (slot.acceptError != 0) {
+        *savedErrno = slot.acceptError;
+        slot.acceptError = 0;
+        return -1;
+    }
+    *savedErrno = EAGAIN;
+    return -1;
+}
+
+void UringPoller::SubmitSend(Channel* c, const struct iovec* iov, int iovcnt, std::shared_ptr<void> holder) {
+    Poller::AssertInLoopThread();
+    assert(iovcnt >= 0 && iovcnt <= EventLoop::kMaxSendIovecs);
+    const uint32_t idx = static_cast<uint32_t>(c->Index());
+    Slot& slot = slots_[idx];
+    assert(slot.channel == c);
+    if (!slot.send) {
+        slot.send = std::make_unique<SendState>();
+    }
+    SendState* send = slot.send.get();
+    assert(!send->inFlight && !send->completed);
+    std::copy(iov, iov + iovcnt, send->iov);
+    ::memset(&send->msg, 0, sizeof send->msg);
+    send->msg.msg_iov = send->iov;
+    send->msg.msg_iovlen = static_cast<size_t>(iovcnt);
+    send->holder = std::move(holder);
+    send->token = MakeToken(idx, slot.generation, iovcnt > 0 ? kSendOp : kWritableOp);
+    send->inFlight = true;
+    PrepSend(idx);  // submitted by next Poll, with the other sends of this iteration
+}
+
+bool UringPoller::TakeSent(Channel* c, ssize_t* result) {
+    Poller::AssertInLoopThread();
+    Slot& slot = slots_[c->Index()];
+    assert(slot.channel == c);
+    if (!slot.send || !slot.send->completed) {
+        return false;
+    }
+    slot.send->completed = false;
+    *result = slot.send->result;
+    return true;
+}
+
+void UringPoller::MarkDirty(uint32_t idx) {
+    if (!slots_[idx].dirty) {
+        slots_[idx].dirty = true;
+        dirtySlots_.push_back(idx);
+    }
+}
+
+void UringPoller::SyncSlot(uint32_t idx) {
+    Slot& slot = slots_[idx];
+    slot.dirty = false;
+    if (slot.channel == nullptr) {
+        return; // the channel was removed after marking
+    }
+    const Channel::CompletionIo mode = completionSupported_ ? slot.channel->GetCompletionIo() : Channel::kNoCompletion;
+    if (mode != Channel::kNoCompletion) {
+        SyncCompletionSlot(idx, mode);
+        return;
+    }
+    const int desired = slot.channel->CurrentEvent();
+    const bool multishot = slot.channel->IsEdgeTriggered() && multishotSupported_;
+    if (slot.armed && (slot.armedEvents != desired || slot.multishot != multishot)) {
+        PrepPollRemove(idx);
+        slot.generation += 1;   // ignores completions of the old request
+        slot.armed = false;
+    }
+    if (!slot.armed && desired != 0) {
+        slot.armedEvents = desired;
+        slot.multishot = multishot;
+        slot.armed = true;
+        PrepPollAdd(idx);
+    }
+}
+
+void UringPoller::SyncCompletionSlot(uint32_t idx, Channel::CompletionIo mode) {
+    Slot& slot = slots_[idx];
+    assert(!slot.armed || slot.op != kPollOp);  // the mode is chosen before the channel is enabled
+    const bool reading = (slot.channel->CurrentEvent() & POLLIN) != 0;
+    if (slot.armed) {
+        if (!reading && !slot.cancelling) {
+            // the results completed before the cancellation are still kept, so the generation isn't changed
+            PrepCancel(SlotToken(idx));
+            slot.cancelling = true;
+        }
+        return; // re-armed after the termination if reading again
+    }
+    if (!reading) {
+        return;
+    }
+    if (mode == Channel::kReceiveCompletion) {
+        if (slot.recvState != kReceiving) {
+            return; // end of file OR failed, nothing more to receive
+        }
+        SetupRecvBuffers();
+        if (freeBuffers_ == 0) {
+            starvedSlots_.push_back(idx);
+            return;
+        }
+        slot.op = kRecvOp;
+        PrepRecv(idx);
+    } else {
+        slot.op = kAcceptOp;
+        PrepAccept(idx);
+    }
+    slot.armedEvents = POLLIN;
+    slot.multishot = true;
+    slot.armed = true;
+}
+
+void UringPoller::PrepPollAdd(uint32_t idx) {
+    const Slot& slot = slots_[idx];
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = slot.channel->FileDescriptor();
+    sqe->poll32_events = static_cast<uint32_t>(slot.armedEvents);
+    sqe->len = slot.multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = SlotToken(idx);
+}
+
+void UringPoller::PrepPollRemove(uint32_t idx) {
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = SlotToken(idx);
+    sqe->user_data = 0;
+}
+
+void UringPoller::PrepRecv(uint32_t idx) {
+    const Slot& slot = slots_[idx];
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot.channel->FileDescriptor();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;   // each completion picks a buffer from the ring
+    sqe->buf_group = kRecvBufferGroup;
+    sqe->user_data = SlotToken(idx);
+}
+
+void UringPoller::PrepAccept(uint32_t idx) {
+    const Slot& slot = slots_[idx];
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = slot.channel->FileDescriptor();
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = SlotToken(idx);
+}
+
+void UringPoller::PrepSend(uint32_t idx) {
+    const Slot& slot = slots_[idx];
+    const SendState* send = slot.send.get();
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->fd = slot.channel->FileDescriptor();
+    if (send->msg.msg_iovlen > 0) {
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = reinterpret_cast<uint64_t>(&send->msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLOUT;
+    }
+    sqe->user_data = send->token;
+}
+
+void UringPoller::PrepCancel(uint64_t token) {
+    struct io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = token;
+    sqe->user_data = 0;
+}
+
+struct io_uring_sqe* UringPoller::GetSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (localSqTail_ - head >= sqEntries_) {
+        // the submission queue is full, flush it first
+        if (Enter(0, 0, nullptr) < 0) {
+            LOG_SYSFATAL << "UringPoller::GetSqe - io_uring_enter";
+        }
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        assert(localSqTail_ - head < sqEntries_);
+    }
+    const unsigned index = localSqTail_ & sqMask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    ::memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    localSqTail_ += 1;
+    toSubmit_ += 1;
+    return sqe;
+}
+
+int UringPoller::Enter(unsigned min_complete, unsigned flags, const TimeoutDuration_t* timeout) {
+    // publish the prepared SQEs to kernel
+    __atomic_store_n(sqTail_, localSqTail_, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    ::memset(&arg, 0, sizeof arg);
+    if (timeout != nullptr && min_complete > 0) {
+        using namespace std::chrono;
+        auto sec = duration_cast<seconds>(*timeout);
+        ts.tv_sec = sec.count();
+        ts.tv_nsec = duration_cast<nanoseconds>(*timeout - sec).count();
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret = io_uring_enter(ringfd_, toSubmit_, min_complete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    if (ret >= 0) {
+        toSubmit_ -= std::min(toSubmit_, static_cast<unsigned>(ret));
+    }
+    return ret;
+}
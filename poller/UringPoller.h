@@ -0,0 +1,206 @@
+#if !defined(MUDUO_POLLER_URINGPOLLER_H)
+#define MUDUO_POLLER_URINGPOLLER_H
+
+#include <muduo/Poller.h>
+#include <muduo/Channel.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cstdint>
+#include <deque>
+
+struct io_uring_sqe;    // forward declaration for struct io_uring_sqe in header file linux/io_uring.h
+struct io_uring_cqe;    // forward declaration for struct io_uring_cqe in header file linux/io_uring.h
+struct io_uring_buf_ring;   // forward declaration for struct io_uring_buf_ring in header file linux/io_uring.h
+
+namespace muduo {
+namespace detail {
+
+/**
+ * IO Multiplexing with io_uring(7) poll requests.
+ * All registration changes made during one loop iteration are queued as SQEs
+ * and submitted together with the wait for completions, so each Poll() costs one io_uring_enter(2).
+ *
+ * Edge-triggered channels use multishot poll requests which stay armed,
+ * level-triggered channels use one-shot poll requests, which are re-armed(one SQE in the same submission)
+ * after each completion only, since a multishot request doesn't report the data left unread.
+ * The internal channels of EventLoop drain their fd on each event, so they are edge-triggered.
+ * Use Channel::Index() to save the slot of channel in the slot-table.
+ *
+ * Completion mode(see Channel::EnableCompletionIo) takes the IO itself off the loop:
+ *  - a listening channel is served by a multishot accept request, the accepted sockets are queued in its slot;
+ *  - a connection is served by a multishot recv request which picks the buffers from a provided buffer ring
+ *    registered by the poller, the filled buffers are queued in its slot until taken, and then recycled to the ring.
+ *    Where the ring isn't usable, the buffers are provided by IORING_OP_PROVIDE_BUFFERS,
+ *    the recycled ones are provided again by the next submission;
+ *  - sends are SENDMSG requests, prepared during the iteration and submitted by the next Poll();
+ * so the IO of all connections in an iteration shares the single io_uring_enter(2) with the wait.
+ * A slot holding results not taken yet is reported again without waiting, like a level-triggered poll.
+*/
+class UringPoller : public Poller {
+    /// the kinds of request, distinguish the completions of the lanes of a slot
+    enum RequestOp { kPollOp, kRecvOp, kAcceptOp, kSendOp, kWritableOp };
+    /// reading state of a completion-mode receiving slot
+    enum RecvState { kReceiving, kEofPending, kEofTaken };
+
+    static const unsigned kRingEntries = 1024;
+    /// provided buffers of the recv requests in completion mode, count must be a power of 2
+    static const unsigned kRecvBufferCount = 128;
+    static const unsigned kRecvBufferSize = 16 * 1024;
+    static const uint16_t kRecvBufferGroup = 0;
+    static const uint32_t kNoBuffer = UINT32_MAX;
+
+    /// the send lane of a slot, separately allocated so the msghdr stays put until the kernel took it
+    struct SendState {
+        struct msghdr msg;
+        struct iovec iov[EventLoop::kMaxSendIovecs];
+        std::shared_ptr<void> holder;   // keeps the memory of iovecs alive
+        uint64_t token;         // of the in-flight request
+        ssize_t result;         // bytes sent OR -errno
+        bool inFlight;
+        bool completed;         // result is not taken yet
+    };
+
+    struct Slot {
+        Channel* channel {nullptr};     // nullptr represents the slot is free
+        uint32_t generation {0};        // distinguishes stale completions of the slot
+        int armedEvents {0};            // interested events of in-flight poll request
+        int revents {0};                // events received in current Poll()
+        bool armed {false};             // whether a poll(OR recv/accept in completion mode) request is in-flight
+        bool multishot {false};
+        bool dirty {false};             // whether the slot is in dirtySlots_
+        uint64_t activeStamp {0};       // the Poll() round in which the channel was put into active list
+
+        /* completion mode */
+        RequestOp op {kPollOp};         // of the armed request
+        bool cancelling {false};        // the cancellation of armed request was queued
+        bool ready {false};             // whether the slot is in readySlots_
+        uint32_t recvHead {kNoBuffer};  // received buffers not taken yet, chained by nextBuffer_
+        uint32_t recvTail {kNoBuffer};
+        RecvState recvState {kReceiving};
+        int recvError {0};
+        std::deque<int> accepted;       // accepted sockets not taken yet
+        int acceptError {0};
+        std::unique_ptr<SendState> send;
+    };
+
+#ifdef MUDUO_USE_MEMPOOL
+    using SlotList = std::vector<Slot, base::allocator<Slot>>;
+    using SlotIndexList = std::vector<uint32_t, base::allocator<uint32_t>>;
+#else
+    using SlotList = std::vector<Slot>;
+    using SlotIndexList = std::vector<uint32_t>;
+#endif
+
+public:
+    /// @brief Whether the running kernel provides the io_uring features required by this poller
+    /// @note thread-safe, the result is probed only once
+    static bool IsSupported();
+
+    /// Constructor
+    /// @note Must check UringPoller::IsSupported before construct the instance
+    UringPoller(EventLoop* loop);
+    virtual ~UringPoller() noexcept override;
+
+    virtual ReceiveTimePoint_t Poll(const TimeoutDuration_t& timeout, ChannelList* activeChannels) override;
+    virtual void UpdateChannel(Channel* c) override;
+    virtual void RemoveChannel(Channel* c) override;
+    virtual bool SupportsEdgeTriggered() const override { return multishotSupported_; }
+    virtual bool SupportsCompletionIo() const override { return completionSupported_; }
+    virtual ssize_t TakeReceived(Channel* c, Buffer* buf, int* savedErrno) override;
+    virtual int TakeAccepted(Channel* c, int* savedErrno) override;
+    virtual void SubmitSend(Channel* c, const struct iovec* iov, int iovcnt, std::shared_ptr<void> holder) override;
+    virtual bool TakeSent(Channel* c, ssize_t* result) override;
+
+private:
+    void SetupRing();
+    /// @brief Registers the provided buffer ring(OR provides the buffers) on the first use of completion mode
+    void SetupRecvBuffers();
+    /// @brief Prepares SQEs which provide the recycled buffers again, one per run of consecutive ids
+    void ProvideRecycledBuffers();
+    void MarkDirty(uint32_t idx);
+    /// @brief Prepares SQEs to make the in-flight poll request of slot match the interest of its channel
+    void SyncSlot(uint32_t idx);
+    /// @brief SyncSlot of a channel in completion mode, arms OR cancels the recv(accept) request
+    void SyncCompletionSlot(uint32_t idx, Channel::CompletionIo mode);
+    void PrepPollAdd(uint32_t idx);
+    void PrepPollRemove(uint32_t idx);
+    void PrepRecv(uint32_t idx);
+    void PrepAccept(uint32_t idx);
+    void PrepSend(uint32_t idx);
+    void PrepCancel(uint64_t token);
+    struct io_uring_sqe* GetSqe();
+    /// @return result of io_uring_enter(2), @c errno is set on failure
+    int Enter(unsigned min_complete, unsigned flags, const TimeoutDuration_t* timeout);
+    void FillActiveChannels(ChannelList* activeChannels);
+    /// @brief Puts the channel of slot into active list, OR merges revents if it's there already
+    void Activate(Slot* slot, int revents, ChannelList* activeChannels, int* numEvents);
+    /// @brief Stashes the result of a recv OR accept completion into slot
+    void HandleCompletion(uint32_t idx, RequestOp op, const struct io_uring_cqe* cqe);
+    /// @brief Releases the resources carried by a completion of a removed OR replaced request
+    void HandleStaleCompletion(uint64_t token, RequestOp op, const struct io_uring_cqe* cqe);
+    /// @brief Whether the slot holds results which the channel didn't take
+    static bool HasPending(const Slot& slot);
+    void MarkReady(uint32_t idx);
+    /// @brief Drops the slots with nothing pending from readySlots_
+    void PruneReadySlots();
+    void RecycleBuffer(uint32_t bid);
+    /// @brief Recycles the buffers and closes the sockets which the slot still holds
+    void ReleasePending(Slot* slot);
+
+    static uint64_t MakeToken(uint32_t idx, uint32_t generation, RequestOp op)
+    { return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(op) << 28) | (idx + 1); }
+    uint64_t SlotToken(uint32_t idx) const
+    { return MakeToken(idx, slots_[idx].generation, slots_[idx].op); }
+
+private:
+    int ringfd_;
+    bool multishotSupported_;
+    bool completionSupported_;
+    bool bufferRing_;           // whether the buffers are provided by a registered ring
+
+    /* mmaped rings shared with kernel */
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    struct io_uring_sqe* sqes_;
+    size_t sqesSize_;
+
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned* sqArray_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe* cqes_;
+
+    unsigned localSqTail_;  // tail of SQEs prepared but not yet published
+    unsigned toSubmit_;
+    uint64_t pollRound_;
+
+    SlotList slots_;
+    SlotIndexList freeSlots_;
+    SlotIndexList dirtySlots_;
+    SlotIndexList readySlots_;      // the slots holding results not taken, reported without waiting
+    SlotIndexList starvedSlots_;    // the recv requests waiting for free provided buffers
+
+    /* provided buffer ring of completion mode */
+    struct io_uring_buf_ring* bufRing_;
+    size_t bufRingSize_;
+    char* recvBuffers_;
+    uint16_t bufRingTail_;
+    unsigned freeBuffers_;          // buffers in the ring, not held by any slot
+    SlotIndexList nextBuffer_;      // the next received buffer of same slot, indexed by buffer id
+    SlotIndexList bufferBytes_;     // received bytes in the buffer, indexed by buffer id
+    SlotIndexList recycledBuffers_; // to be provided again, only without buffer ring
+
+    std::vector<std::unique_ptr<SendState>> retiredSends_;  // of removed channels, until their completions
+    std::vector<std::shared_ptr<void>> releasedHolders_;    // dropped after reaping completions
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_POLLER_URINGPOLLER_H
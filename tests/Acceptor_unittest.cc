@@ -0,0 +1,58 @@
+/// Acceptor drains the backlog in batches of at most SetMaxAcceptsPerWakeup per wakeup.
+#include <muduo/base/SocketOps.h>
+#include <muduo/EventLoop.h>
+#include <muduo/Acceptor.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+TEST(Acceptor, AcceptsBatchPerWakeup) {
+    const int kClients = 5;
+
+    EventLoop loop;
+    Acceptor acceptor(&loop, InetAddr(0, true), false);
+    const uint16_t port = acceptor.GetListeningAddr().GetPort();
+    acceptor.SetMaxAcceptsPerWakeup(3);
+    std::vector<int> accepted;
+    std::vector<size_t> batches;
+    acceptor.SetNewConnectionCallback([&](int connfd, const InetAddr&) {
+        accepted.push_back(connfd);
+    });
+    acceptor.SetAcceptedBatchCallback([&]() {
+        size_t before = 0;
+        for (size_t n : batches) {
+            before += n;
+        }
+        batches.push_back(accepted.size() - before);
+        if (accepted.size() == kClients) {
+            loop.Quit();
+        }
+    });
+    acceptor.Listen();
+
+    // all are queued in the backlog before the loop polls
+    std::vector<int> clients;
+    for (int i = 0; i < kClients; i++) {
+        clients.push_back(test::ConnectLoopback(port));
+        ASSERT_GE(clients.back(), 0);
+    }
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+
+    EXPECT_EQ(batches, (std::vector<size_t>{3, 2}));
+    for (int connfd : accepted) {
+        // accepted by accept4, no fcntl needed
+        EXPECT_TRUE(::fcntl(connfd, F_GETFL) & O_NONBLOCK);
+        EXPECT_TRUE(::fcntl(connfd, F_GETFD) & FD_CLOEXEC);
+        sockets::close(connfd);
+    }
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
@@ -0,0 +1,127 @@
+#include <muduo/BufferBlockPool.h>
+#include <muduo/OutputQueue.h>
+#include <muduo/EventLoop.h>
+#include <muduo/Buffer.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using std::string;
+using namespace muduo;
+
+TEST(BufferBlockPool, BlockSizes) {
+    EXPECT_EQ(BufferBlockPool::BlockSize(1), 4096u);
+    EXPECT_EQ(BufferBlockPool::BlockSize(4096), 4096u);
+    EXPECT_EQ(BufferBlockPool::BlockSize(4097), 16384u);
+    EXPECT_EQ(BufferBlockPool::BlockSize(65536), 65536u);
+    EXPECT_EQ(BufferBlockPool::BlockSize(65537), 0u);
+}
+
+TEST(BufferBlockPool, ReusesFreedBlocks) {
+    EventLoop loop;
+    BufferBlockPool* pool = loop.GetBufferBlockPool();
+    char* a = pool->Allocate(4096);
+    char* b = pool->Allocate(100);
+    EXPECT_EQ(b, a + 4096);     // carved from the same slab
+    EXPECT_EQ(pool->SlabBytes(), BufferBlockPool::kSlabBytes);
+    EXPECT_EQ(pool->LiveBlocks(), 2u);
+
+    pool->Free(a, 4096);
+    EXPECT_EQ(pool->Allocate(4000), a);
+    pool->Free(a, 4000);
+    pool->Free(b, 100);
+    EXPECT_EQ(pool->LiveBlocks(), 0u);
+}
+
+TEST(BufferBlockPool, FreesFromForeignThread) {
+    EventLoop loop;
+    BufferBlockPool* pool = loop.GetBufferBlockPool();
+    // takes the whole slab, so the next allocation has to drain the remote list
+    const size_t blocks = BufferBlockPool::kSlabBytes / BufferBlockPool::kMaxBlockSize;
+    char* all[blocks];
+    for (size_t i = 0; i < blocks; i++) {
+        all[i] = pool->Allocate(BufferBlockPool::kMaxBlockSize);
+    }
+    std::thread foreign([&]() { pool->Free(all[1], BufferBlockPool::kMaxBlockSize); });
+    foreign.join();
+    EXPECT_EQ(pool->LiveBlocks(), blocks - 1);
+
+    EXPECT_EQ(pool->Allocate(BufferBlockPool::kMaxBlockSize), all[1]);
+    EXPECT_EQ(pool->SlabBytes(), BufferBlockPool::kSlabBytes);
+    for (size_t i = 0; i < blocks; i++) {
+        pool->Free(all[i], BufferBlockPool::kMaxBlockSize);
+    }
+}
+
+TEST(PooledBuffer, TakesWholeBlock) {
+    EventLoop loop;
+    BufferBlockPool* pool = loop.GetBufferBlockPool();
+    Buffer buf(pool, 0);
+    EXPECT_TRUE(buf.Pooled());
+    EXPECT_EQ(buf.StorageBytes(), 0u);
+
+    buf.Append(string(100, 'a'));
+    EXPECT_EQ(buf.StorageBytes(), 4096u);
+    EXPECT_EQ(buf.WriteableBytes(), 4096u - Buffer::kCheapPrepend - 100);
+    buf.Append(string(5000, 'b'));
+    EXPECT_EQ(buf.StorageBytes(), 16384u);
+    EXPECT_EQ(buf.RetrieveAsString(100), string(100, 'a'));
+    EXPECT_EQ(buf.RetrieveAllAsString(), string(5000, 'b'));
+    EXPECT_EQ(pool->LiveBlocks(), 1u);
+
+    // drained, returns the block
+    buf.ReleaseStorage();
+    EXPECT_EQ(pool->LiveBlocks(), 0u);
+    buf.Append(string(10, 'c'));
+    EXPECT_EQ(buf.RetrieveAllAsString(), string(10, 'c'));
+
+    // beyond the largest block, from heap
+    buf.ReleaseStorage();
+    buf.Append(string(100 * 1024, 'd'));
+    EXPECT_EQ(pool->LiveBlocks(), 0u);
+    EXPECT_EQ(buf.RetrieveAllAsString(), string(100 * 1024, 'd'));
+}
+
+TEST(PooledBuffer, CopyAndMoveAreNotPooled) {
+    EventLoop loop;
+    Buffer buf(loop.GetBufferBlockPool(), 0);
+    buf.Append(string("hello"));
+
+    Buffer copied(buf);
+    EXPECT_FALSE(copied.Pooled());
+    EXPECT_EQ(copied.RetrieveAllAsString(), "hello");
+
+    Buffer moved(std::move(buf));
+    EXPECT_FALSE(moved.Pooled());
+    EXPECT_EQ(moved.RetrieveAllAsString(), "hello");
+    EXPECT_TRUE(buf.Pooled());
+    EXPECT_EQ(buf.ReadableBytes(), 0u);
+
+    Buffer heap;
+    heap.Append(string("world"));
+    buf = std::move(heap);
+    EXPECT_TRUE(buf.Pooled());
+    EXPECT_EQ(buf.RetrieveAllAsString(), "world");
+}
+
+TEST(PooledBuffer, DestroyedInForeignThread) {
+    EventLoop loop;
+    BufferBlockPool* pool = loop.GetBufferBlockPool();
+    std::unique_ptr<Buffer> buf(new Buffer(pool, 0));
+    buf->Append(string(1000, 'x'));
+    EXPECT_EQ(pool->LiveBlocks(), 1u);
+
+    std::thread foreign([&buf]() { buf.reset(); });
+    foreign.join();
+    EXPECT_EQ(pool->LiveBlocks(), 0u);
+}
+
+TEST(PooledOutputQueue, ReturnsChunksWhenDrained) {
+    EventLoop loop;
+    BufferBlockPool* pool = loop.GetBufferBlockPool();
+    OutputQueue queue(pool);
+    queue.Append(string(40 * 1024, 'q').data(), 40 * 1024);
+    EXPECT_EQ(pool->LiveBlocks(), 3u);  // of 16 KiB chunks
+    queue.Retrieve(40 * 1024);
+    EXPECT_EQ(pool->LiveBlocks(), 0u);
+}
@@ -3,6 +3,7 @@
 #include <muduo/Buffer.h>
 #include <gtest/gtest.h>
 #include <string>
+#include <unistd.h>
 
 using std::string;
 using namespace muduo;
@@ -137,4 +138,43 @@ TEST(TestBuffer, testReadInts) {
     EXPECT_EQ(buf.ReadInt32(), -3);
 }
 
+TEST(TestBuffer, testReleaseAndShrink) {
+    Buffer buf;
+    buf.Append(string(5000, 'r'));
+    buf.RetrieveAll();
+    GTEST_ASSERT_GE(buf.StorageBytes(), 5000);
+
+    buf.ReleaseStorage();
+    GTEST_ASSERT_EQ(buf.StorageBytes(), 0);
+    GTEST_ASSERT_EQ(buf.ReadableBytes(), 0);
+    GTEST_ASSERT_EQ(buf.WriteableBytes(), 0);
+    buf.Append(string(10, 's'));
+    GTEST_ASSERT_EQ(buf.RetrieveAllAsString(), string(10, 's'));
+
+    buf.Append(string(3000, 't'));
+    buf.Retrieve(1000);
+    buf.Shrink(100);
+    GTEST_ASSERT_EQ(buf.StorageBytes(), Buffer::kCheapPrepend + 2000 + 100);
+    GTEST_ASSERT_EQ(buf.WriteableBytes(), 100);
+    GTEST_ASSERT_EQ(buf.RetrieveAllAsString(), string(2000, 't'));
+}
+
+TEST(TestBuffer, testReadFdWithSpill) {
+    int fds[2];
+    GTEST_ASSERT_EQ(::pipe(fds), 0);
+    const string data(3000, 'p');
+    GTEST_ASSERT_EQ(::write(fds[1], data.data(), data.size()), 3000);
+
+    char spill[4096];
+    Buffer buf;
+    buf.ReleaseStorage();   // every byte goes to spill first
+    int savedErrno = 0;
+    GTEST_ASSERT_EQ(buf.ReadFd(fds[0], spill, sizeof spill, &savedErrno), 3000);
+    GTEST_ASSERT_EQ(buf.ReadableBytes(), 3000);
+    GTEST_ASSERT_EQ(buf.WriteableBytes(), 0);   // sized exactly
+    GTEST_ASSERT_EQ(buf.RetrieveAllAsString(), data);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
 #endif
\ No newline at end of file
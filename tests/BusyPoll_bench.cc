@@ -0,0 +1,136 @@
+/// Latency of waking up a loop, blocking in the poller vs busy-polling(EventLoopOptions::busyPollBudget):
+/// a cross-thread callback from enqueueing to running, and a 64-byte echo round trip over loopback.
+/// The requests are paced, so a blocking loop is asleep when each of them arrives.
+/// NOTE: busy-polling wants a CPU per spinning loop, run it on a machine with spare cores.
+/// Usage: BusyPoll_bench [samples] [busy poll budget in us]
+#include <muduo/EventLoopOptions.h>
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/Buffer.h>
+#include <muduo/tests/TestUtil.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+const microseconds kPace(50);   // between requests, longer than the cost of a wakeup
+
+void Report(const char* name, std::vector<nanoseconds>* samples) {
+    std::sort(samples->begin(), samples->end());
+    auto percentile = [samples](double p) {
+        return static_cast<double>((*samples)[static_cast<size_t>(p * (samples->size() - 1))].count()) / 1000;
+    };
+    printf("%-40s p50 %8.2f us   p99 %8.2f us   p99.9 %8.2f us\n", name, percentile(0.5), percentile(0.99), percentile(0.999));
+}
+
+/// Enqueues samples callbacks one by one from this thread, each is timed from enqueueing to running
+void BenchCallback(const char* name, const EventLoopOptions& options, int samples) {
+    std::promise<EventLoop*> started;
+    std::thread thread([&options, &started]() {
+        EventLoop loop(options);
+        started.set_value(&loop);
+        loop.Loop();
+    });
+    EventLoop* loop = started.get_future().get();
+
+    std::vector<nanoseconds> latencies;
+    latencies.reserve(samples);
+    for (int i = 0; i < samples; i++) {
+        std::atomic<int64_t> ran {0};
+        const steady_clock::time_point enqueued = steady_clock::now();
+        loop->EnqueueEventLoop([&ran]() {
+            ran.store(steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+        });
+        while (ran.load(std::memory_order_acquire) == 0) { }
+        latencies.push_back(steady_clock::time_point(steady_clock::duration(ran.load())) - enqueued);
+        std::this_thread::sleep_for(kPace);
+    }
+    loop->RunInEventLoop([loop]() { loop->Quit(); });
+    thread.join();
+    Report(name, &latencies);
+}
+
+/// Echoes samples 64-byte messages one by one with a blocking peer, each is timed from writing to reading back
+void BenchEcho(const char* name, const EventLoopOptions& options, int samples) {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "bench");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(1);
+    server.SetIoLoopOptions(options);
+    server.SetConnectionCallback([](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            conn->SetTcpNoDelay(true);
+        }
+    });
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    std::vector<nanoseconds> latencies;
+    latencies.reserve(samples);
+    std::thread client([&]() {
+        int fd = test::ConnectLoopback(port);
+        if (fd < 0) {
+            perror("connect");
+            std::abort();
+        }
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+        char msg[64] = {'m'};
+        for (int i = 0; i < samples; i++) {
+            const steady_clock::time_point sent = steady_clock::now();
+            ::write(fd, msg, sizeof msg);
+            size_t received = 0;
+            while (received < sizeof msg) {
+                ssize_t n = ::read(fd, msg + received, sizeof msg - received);
+                if (n <= 0) {
+                    perror("read");
+                    std::abort();
+                }
+                received += static_cast<size_t>(n);
+            }
+            latencies.push_back(steady_clock::now() - sent);
+            std::this_thread::sleep_for(kPace);
+        }
+        ::close(fd);
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.Loop();
+    client.join();
+    Report(name, &latencies);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int samples = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const microseconds budget(argc > 2 ? std::atoi(argv[2]) : 200);
+
+    EventLoopOptions blocking;
+    EventLoopOptions spinning;
+    spinning.busyPollBudget = budget;
+    EventLoopOptions spinning_socket = spinning;
+    spinning_socket.socketBusyPoll = 50;
+
+    printf("%d samples, busy poll budget %ld us, paced by %ld us\n", samples,
+        static_cast<long>(budget.count()), static_cast<long>(kPace.count()));
+    BenchCallback("cross-thread callback, blocking", blocking, samples);
+    BenchCallback("cross-thread callback, busy-poll", spinning, samples);
+    BenchEcho("echo round trip, blocking", blocking, samples);
+    BenchEcho("echo round trip, busy-poll", spinning, samples);
+    BenchEcho("echo round trip, busy-poll + SO_BUSY_POLL", spinning_socket, samples);
+}
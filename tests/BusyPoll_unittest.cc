@@ -0,0 +1,153 @@
+/// Busy-poll mode of EventLoop: spinning with zero-timeout polls before blocking, and SO_BUSY_POLL of connections.
+#include <muduo/EventLoopOptions.h>
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/Socket.h>
+#include <muduo/Buffer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// runs cb in loop from this thread, and waits until it's done
+void RunAndWait(EventLoop* loop, PendingEventCb_t cb) {
+    std::atomic_bool done {false};
+    loop->EnqueueEventLoop([&cb, &done]() {
+        cb();
+        done.store(true);
+    });
+    while (!done.load()) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+TEST(BusyPoll, SpinsWithoutEventfd) {
+    EventLoopOptions options;
+    options.busyPollBudget = milliseconds(200);
+    std::promise<EventLoop*> started;
+    std::thread thread([&options, &started]() {
+        EventLoop loop(options);
+        started.set_value(&loop);
+        loop.Loop();
+    });
+    EventLoop* loop = started.get_future().get();
+    RunAndWait(loop, []() { });    // the loop is spinning after it
+
+    // within the budget since the last callback, no enqueue writes the eventfd
+    const uint64_t coalesced = loop->GetCoalescedWakeups();
+    for (int i = 0; i < 10; i++) {
+        RunAndWait(loop, []() { });
+    }
+    EXPECT_EQ(loop->GetCoalescedWakeups() - coalesced, 10u);
+
+    // the budget ran out and the loop blocks, the enqueue wakes it up
+    std::this_thread::sleep_for(milliseconds(400));
+    const steady_clock::time_point start = steady_clock::now();
+    RunAndWait(loop, []() { });
+    EXPECT_LT(steady_clock::now() - start, seconds(1));
+    EXPECT_EQ(loop->GetCoalescedWakeups() - coalesced, 10u);
+
+    loop->RunInEventLoop([loop]() { loop->Quit(); });
+    thread.join();
+}
+
+TEST(BusyPoll, HighPriorityCallbackAroundBudgetEnd) {
+    EventLoopOptions options;
+    options.busyPollBudget = microseconds(500);
+    std::promise<EventLoop*> started;
+    std::thread thread([&options, &started]() {
+        EventLoop loop(options);
+        started.set_value(&loop);
+        loop.Loop();
+    });
+    EventLoop* loop = started.get_future().get();
+
+    // the high-priority callbacks skip the eventfd as the normal ones while spinning,
+    // the one enqueued right before the loop stops spinning must not wait for the poll timeout
+    int late = 0;
+    for (int i = 0; i < 200; i++) {
+        RunAndWait(loop, []() { });    // the loop is spinning after it
+        std::this_thread::sleep_for(microseconds(400 + (i % 20) * 10));
+        std::atomic_bool done {false};
+        loop->EnqueueEventLoop([&done]() { done.store(true); }, CallbackPriority::kHigh);
+        const steady_clock::time_point start = steady_clock::now();
+        while (!done.load() && steady_clock::now() - start < seconds(1)) {
+            std::this_thread::yield();
+        }
+        if (!done.load()) {
+            late++;
+            while (!done.load()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    EXPECT_EQ(late, 0);
+
+    loop->RunInEventLoop([loop]() { loop->Quit(); });
+    thread.join();
+}
+
+TEST(BusyPoll, SetsSocketOption) {
+    Socket sock(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (!sock.SetBusyPoll(10)) {
+        GTEST_SKIP() << "SO_BUSY_POLL is not permitted";
+    }
+    int usec = 0;
+    socklen_t len = sizeof usec;
+    ASSERT_EQ(::getsockopt(sock.FileDescriptor(), SOL_SOCKET, SO_BUSY_POLL, &usec, &len), 0);
+    EXPECT_EQ(usec, 10);
+}
+
+TEST(BusyPoll, ServesConnections) {
+    const int kRoundTrips = 20;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "BusyPoll");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(1);
+    EventLoopOptions options;
+    options.busyPollBudget = milliseconds(20);
+    options.socketBusyPoll = 10;
+    server.SetIoLoopOptions(options);
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    int echoed = 0;
+    std::thread client([&]() {
+        int fd = test::ConnectLoopback(port);
+        if (fd >= 0) {
+            for (int i = 0; i < kRoundTrips; i++) {
+                char c = static_cast<char>('a' + i % 26);
+                char reply = 0;
+                ::write(fd, &c, 1);
+                if (::read(fd, &reply, 1) == 1 && reply == c) {
+                    echoed++;
+                }
+                // some round trips find the loop spinning, the others find it blocked
+                std::this_thread::sleep_for(milliseconds(i % 2 == 0 ? 1 : 40));
+            }
+            ::close(fd);
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(echoed, kRoundTrips);
+}
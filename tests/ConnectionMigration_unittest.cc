@@ -0,0 +1,290 @@
+/// TcpServer moves the established connections between IO-loops, by request or by the busy time of loops.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/Buffer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+std::string ReadExactly(int fd, size_t n) {
+    std::string result;
+    char buf[256];
+    while (result.size() < n) {
+        ssize_t ret = ::read(fd, buf, std::min(sizeof buf, n - result.size()));
+        if (ret <= 0) {
+            break;
+        }
+        result.append(buf, static_cast<size_t>(ret));
+    }
+    return result;
+}
+
+template <typename Pred>
+bool WaitFor(Pred pred) {
+    for (int i = 0; i < 500 && !pred(); i++) {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    return pred();
+}
+
+} // namespace
+
+TEST(ConnectionMigration, MovesWithBufferedInput) {
+    const size_t kMessageSize = 10;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "Migration");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(2);
+    server.SetIdleTimeout(seconds(60));
+    std::mutex mutex;
+    std::vector<EventLoop*> io_loops;
+    server.SetIothreadInitCallback([&](EventLoop* io_loop) {
+        std::lock_guard<std::mutex> guard(mutex);
+        io_loops.push_back(io_loop);
+    });
+    TcpConnectionPtr server_conn;
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        std::lock_guard<std::mutex> guard(mutex);
+        server_conn = conn->IsConnected() ? conn : nullptr;
+    });
+    std::atomic<bool> handled_in_owner {true};
+    server.SetOnMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        if (!conn->GetEventLoop()->IsInLoopThread()) {
+            handled_in_owner = false;
+        }
+        // echoes whole messages only, a partial one stays in the input buffer
+        while (buf->ReadableBytes() >= kMessageSize) {
+            conn->Send(buf->RetrieveAsString(kMessageSize));
+        }
+    });
+    server.ListenAndServe();
+
+    std::string before;
+    std::string after;
+    EventLoop* from = nullptr;
+    EventLoop* to = nullptr;
+    size_t from_conns = 0;
+    size_t to_conns = 0;
+    std::thread client([&]() {
+        int fd = test::ConnectLoopback(port);
+        TcpConnectionPtr conn;
+        WaitFor([&]() { std::lock_guard<std::mutex> guard(mutex); return server_conn != nullptr; });
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            conn = server_conn;
+            from = conn->GetEventLoop();
+            to = (io_loops[0] == from) ? io_loops[1] : io_loops[0];
+        }
+        ::write(fd, "0123456789", 10);
+        before = ReadExactly(fd, kMessageSize);
+
+        // the first half is buffered in the source loop, the second half is read by the target loop
+        ::write(fd, "abcde", 5);
+        std::this_thread::sleep_for(milliseconds(50));
+        server.MigrateConnection(conn, to);
+        WaitFor([&]() { return conn->GetEventLoop() == to; });
+        ::write(fd, "fghij", 5);
+        after = ReadExactly(fd, kMessageSize);
+        from_conns = from->GetLoad().Connections();
+        to_conns = to->GetLoad().Connections();
+
+        conn.reset();
+        ::close(fd);
+        WaitFor([&]() { std::lock_guard<std::mutex> guard(mutex); return server_conn == nullptr; });
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(before, "0123456789");
+    EXPECT_EQ(after, "abcdefghij");
+    EXPECT_NE(from, to);
+    EXPECT_EQ(from_conns, 0u);
+    EXPECT_EQ(to_conns, 1u);
+    EXPECT_TRUE(handled_in_owner);
+    EXPECT_EQ(to->GetLoad().Connections(), 0u);
+}
+
+TEST(ConnectionMigration, RebalancesBusyLoop) {
+    const int kClients = 4;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "Rebalance");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(2);
+    // the connections from the same host go to the same loop
+    server.SetLoopSelection(LoopSelection::kHashHint);
+    server.SetRebalanceInterval(milliseconds(100));
+    std::mutex mutex;
+    std::vector<TcpConnectionPtr> conns;
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (conn->IsConnected()) {
+            conns.push_back(conn);
+        }
+    });
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    std::atomic<bool> busy {true};
+    std::vector<size_t> spread;
+    std::string echoed;
+    std::thread client([&]() {
+        std::vector<int> fds;
+        for (int i = 0; i < kClients; i++) {
+            fds.push_back(test::ConnectLoopback(port));
+        }
+        WaitFor([&]() { std::lock_guard<std::mutex> guard(mutex); return conns.size() == kClients; });
+        EventLoop* hot = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            hot = conns.front()->GetEventLoop();
+        }
+        // the loop of all connections spins for 30ms of every 50ms
+        hot->RunEvery(milliseconds(50), [&busy]() {
+            const steady_clock::time_point until = steady_clock::now() + milliseconds(30);
+            while (busy && steady_clock::now() < until) { }
+        });
+        WaitFor([&]() {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (const TcpConnectionPtr& conn : conns) {
+                if (conn->GetEventLoop() != hot) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        busy = false;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            size_t moved = 0;
+            for (const TcpConnectionPtr& conn : conns) {
+                moved += (conn->GetEventLoop() != hot) ? 1 : 0;
+            }
+            spread.push_back(kClients - moved);
+            spread.push_back(moved);
+        }
+        // the moved connections keep serving
+        for (int fd : fds) {
+            ::write(fd, "x", 1);
+            echoed += ReadExactly(fd, 1);
+        }
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            conns.clear();
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    ASSERT_EQ(spread.size(), 2u);
+    EXPECT_GT(spread[1], 0u);
+    EXPECT_LE(spread[1], static_cast<size_t>(kClients / 2));
+    EXPECT_EQ(echoed, std::string(kClients, 'x'));
+}
+
+TEST(ConnectionMigration, RebalancesByActivity) {
+    const int kClients = 4;
+    const size_t kHeavyBytes = 300;
+    const size_t kLightBytes = 100;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "RebalanceActivity");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(2);
+    server.SetLoopSelection(LoopSelection::kHashHint);
+    server.SetRebalanceInterval(milliseconds(100));
+    std::mutex mutex;
+    std::vector<TcpConnectionPtr> conns;    // in the order of connecting
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (conn->IsConnected()) {
+            conns.push_back(conn);
+        }
+    });
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    std::atomic<bool> busy {true};
+    std::vector<bool> moved;
+    std::thread client([&]() {
+        std::vector<int> fds;
+        for (int i = 0; i < kClients; i++) {
+            fds.push_back(test::ConnectLoopback(port));
+            // one by one, so conns[i] is the server side of fds[i]
+            WaitFor([&]() { std::lock_guard<std::mutex> guard(mutex); return conns.size() == fds.size(); });
+        }
+        EventLoop* hot = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            hot = conns.front()->GetEventLoop();
+        }
+        hot->RunEvery(milliseconds(50), [&busy]() {
+            const steady_clock::time_point until = steady_clock::now() + milliseconds(30);
+            while (busy && steady_clock::now() < until) { }
+        });
+        // the first connection carries 3 times the bytes of the second one, the others are idle
+        auto light_moved = [&]() {
+            std::lock_guard<std::mutex> guard(mutex);
+            return conns[1]->GetEventLoop() != hot;
+        };
+        const std::string heavy(kHeavyBytes, 'h');
+        const std::string light(kLightBytes, 'l');
+        const steady_clock::time_point deadline = steady_clock::now() + seconds(5);
+        steady_clock::time_point settled = steady_clock::time_point::max();
+        while (steady_clock::now() < std::min(deadline, settled)) {
+            ::write(fds[0], heavy.data(), heavy.size());
+            ReadExactly(fds[0], heavy.size());
+            ::write(fds[1], light.data(), light.size());
+            ReadExactly(fds[1], light.size());
+            if (settled == steady_clock::time_point::max() && light_moved()) {
+                settled = steady_clock::now() + milliseconds(300);  // a few more rounds
+            }
+        }
+        busy = false;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (const TcpConnectionPtr& conn : conns) {
+                moved.push_back(conn->GetEventLoop() != hot);
+            }
+            conns.clear();
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    // the light one fits in the half of bytes, the heavy one alone exceeds it, the idle ones carry nothing
+    ASSERT_EQ(moved.size(), static_cast<size_t>(kClients));
+    EXPECT_FALSE(moved[0]);
+    EXPECT_TRUE(moved[1]);
+    EXPECT_FALSE(moved[2]);
+    EXPECT_FALSE(moved[3]);
+}
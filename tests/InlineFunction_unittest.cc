@@ -0,0 +1,45 @@
+#include <muduo/base/InlineFunction.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+using muduo::base::InlineFunction;
+
+TEST(InlineFunction, SmallCallableIsStoredInline) {
+    std::string s("captured");
+    auto small = [s, p = std::make_shared<int>(1)]() { return static_cast<int>(s.size()) + *p; };
+    EXPECT_TRUE(InlineFunction<int()>::StoresInline<decltype(small)>());
+
+    InlineFunction<int()> f(small);
+    EXPECT_TRUE(static_cast<bool>(f));
+    EXPECT_EQ(f(), 9);
+}
+
+TEST(InlineFunction, LargeCallableFallsBackToHeap) {
+    char big[128] = {'x'};
+    auto large = [big]() { return big[0]; };
+    EXPECT_FALSE(InlineFunction<char()>::StoresInline<decltype(large)>());
+
+    InlineFunction<char()> f(large);
+    InlineFunction<char()> g(std::move(f));
+    EXPECT_FALSE(static_cast<bool>(f));
+    EXPECT_EQ(g(), 'x');
+}
+
+TEST(InlineFunction, HoldsMoveOnlyCapture) {
+    auto owned = std::make_unique<int>(42);
+    InlineFunction<int(int)> f([p = std::move(owned)](int delta) { return *p + delta; });
+    InlineFunction<int(int)> g;
+    g = std::move(f);
+    EXPECT_EQ(g(1), 43);
+}
+
+TEST(InlineFunction, DestroysCaptureOnReset) {
+    auto shared = std::make_shared<int>(0);
+    InlineFunction<void()> f([shared]() { });
+    EXPECT_EQ(shared.use_count(), 2);
+    f = nullptr;
+    EXPECT_EQ(shared.use_count(), 1);
+    EXPECT_TRUE(f == nullptr);
+    EXPECT_THROW(f(), std::bad_function_call);
+}
@@ -0,0 +1,143 @@
+/// The IO-threads are pinned to the configured CPUs, and the connections follow the CPU receiving them.
+#include <muduo/EventLoopThreadPool.h>
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// @return the only CPU the calling thread may run on, -1 if it may run on several
+int PinnedCpu() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    ::pthread_getaffinity_np(::pthread_self(), sizeof cpus, &cpus);
+    if (CPU_COUNT(&cpus) != 1) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+int PinnedCpuOf(EventLoop* loop) {
+    std::promise<int> cpu;
+    loop->RunInEventLoop([&cpu]() { cpu.set_value(PinnedCpu()); });
+    return cpu.get_future().get();
+}
+
+} // namespace
+
+TEST(LoopPlacement, PinsThreads) {
+    const int last_cpu = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "placement");
+    threads.SetPoolSize(3);
+    threads.SetThreadCpus({last_cpu, 0});
+    threads.SetNumaLocalMemory(true);
+    threads.BuildAndRun();
+    std::vector<EventLoop*> loops = threads.GetAllLoops();
+
+    EXPECT_EQ(PinnedCpuOf(loops[0]), last_cpu);
+    EXPECT_EQ(PinnedCpuOf(loops[1]), 0);
+    EXPECT_EQ(PinnedCpuOf(loops[2]), last_cpu);
+    EXPECT_EQ(threads.GetLoopCpu(2), last_cpu);
+}
+
+TEST(LoopPlacement, SelectsByIncomingCpu) {
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "placement");
+    threads.SetPoolSize(3);
+    threads.SetThreadCpus({0});
+    threads.SetLoopSelection(LoopSelection::kIncomingCpu);
+    threads.BuildAndRun();
+    std::vector<EventLoop*> loops = threads.GetAllLoops();
+
+    // the first loop pinned to the CPU takes it
+    EXPECT_EQ(threads.GetNextLoop(0), loops[0]);
+    EXPECT_EQ(threads.GetNextLoop(0), loops[0]);
+    // no loop is pinned to the CPU, in turn
+    const size_t unknown = static_cast<size_t>(-1);
+    EXPECT_EQ(threads.GetNextLoop(unknown), loops[0]);
+    EXPECT_EQ(threads.GetNextLoop(unknown), loops[1]);
+    EXPECT_EQ(threads.GetNextLoop(unknown), loops[2]);
+}
+
+TEST(LoopPlacement, ServerFollowsIncomingCpu) {
+    const int kClients = 8;
+    const int kClientCpu = 0;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "Placement");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(2);
+    // the loop 0 is pinned to the CPU of client, the loop 1 to another one if any
+    server.SetIoThreadCpus({kClientCpu, static_cast<int>(std::thread::hardware_concurrency()) - 1});
+    server.SetLoopSelection(LoopSelection::kIncomingCpu);
+    std::mutex mutex;
+    std::vector<EventLoop*> io_loops;   // in the order of threads, each is started before the next
+    server.SetIothreadInitCallback([&](EventLoop* io_loop) {
+        std::lock_guard<std::mutex> guard(mutex);
+        io_loops.push_back(io_loop);
+    });
+    std::atomic<int> ups {0};
+    std::atomic<int> downs {0};
+    std::atomic<int> on_client_cpu {0};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            ups++;
+            std::lock_guard<std::mutex> guard(mutex);
+            if (conn->GetEventLoop() == io_loops[0]) {
+                on_client_cpu++;
+            }
+        } else {
+            downs++;
+        }
+    });
+    server.ListenAndServe();
+
+    std::thread client([&]() {
+        // over loopback, the packets are received on the CPU of the sender
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(kClientCpu, &cpus);
+        ASSERT_EQ(::pthread_setaffinity_np(::pthread_self(), sizeof cpus, &cpus), 0);
+        std::vector<int> fds;
+        for (int i = 0; i < kClients; i++) {
+            fds.push_back(test::ConnectLoopback(port));
+        }
+        while (ups < kClients) {
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        while (downs < kClients) {
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(ups.load(), kClients);
+    EXPECT_EQ(on_client_cpu.load(), kClients);
+}
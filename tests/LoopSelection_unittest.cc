@@ -0,0 +1,157 @@
+/// EventLoopThreadPool picks the IO-loops by the LoopSelection and the load counters of loops.
+#include <muduo/EventLoopThreadPool.h>
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// the pending output bytes are written by the loop thread only
+void AddPendingBytes(EventLoop* loop, size_t n) {
+    std::promise<void> done;
+    loop->RunInEventLoop([loop, n, &done]() {
+        loop->GetLoad().AddPendingOutputBytes(n);
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+} // namespace
+
+TEST(LoopSelection, LeastConnections) {
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "selection");
+    threads.SetPoolSize(3);
+    threads.SetLoopSelection(LoopSelection::kLeastConnections);
+    threads.BuildAndRun();
+    std::vector<EventLoop*> loops = threads.GetAllLoops();
+
+    // equally loaded, in turn
+    EXPECT_EQ(threads.GetNextLoop(), loops[0]);
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);
+    EXPECT_EQ(threads.GetNextLoop(), loops[2]);
+
+    loops[0]->GetLoad().AddConnection();
+    loops[0]->GetLoad().AddConnection();
+    loops[2]->GetLoad().AddConnection();
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);
+    loops[1]->GetLoad().AddConnection();
+    loops[1]->GetLoad().AddConnection();
+    EXPECT_EQ(threads.GetNextLoop(), loops[2]);
+
+    loops[0]->GetLoad().RemoveConnection();
+    loops[0]->GetLoad().RemoveConnection();
+    EXPECT_EQ(threads.GetNextLoop(), loops[0]);
+    loops[1]->GetLoad().RemoveConnection();
+    loops[1]->GetLoad().RemoveConnection();
+    loops[2]->GetLoad().RemoveConnection();
+}
+
+TEST(LoopSelection, LeastPendingBytes) {
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "selection");
+    threads.SetPoolSize(3);
+    threads.SetLoopSelection(LoopSelection::kLeastPendingBytes);
+    threads.BuildAndRun();
+    std::vector<EventLoop*> loops = threads.GetAllLoops();
+
+    AddPendingBytes(loops[0], 1000);
+    AddPendingBytes(loops[1], 10);
+    AddPendingBytes(loops[2], 100);
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);     // regardless of the turn
+    // the connections don't matter
+    loops[1]->GetLoad().AddConnection();
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);
+    loops[1]->GetLoad().RemoveConnection();
+}
+
+TEST(LoopSelection, HashHint) {
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "selection");
+    threads.SetPoolSize(4);
+    threads.SetLoopSelection(LoopSelection::kHashHint);
+    threads.BuildAndRun();
+    std::vector<EventLoop*> loops = threads.GetAllLoops();
+
+    const size_t hint = InetAddr("10.0.0.7", 1234).GetIpHash();
+    EXPECT_EQ(hint, InetAddr("10.0.0.7", 4321).GetIpHash());   // the same host
+    EventLoop* picked = threads.GetNextLoop(hint);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(threads.GetNextLoop(hint), picked);
+    }
+    EXPECT_EQ(picked, loops[hint % loops.size()]);
+    // without a hint, in turn
+    EXPECT_EQ(threads.GetNextLoop(), loops[0]);
+    EXPECT_EQ(threads.GetNextLoop(), loops[1]);
+}
+
+TEST(LoopSelection, ServerCountsConnections) {
+    const int kClients = 6;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "Selection");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(3);
+    server.SetLoopSelection(LoopSelection::kLeastConnections);
+    std::mutex mutex;
+    std::vector<EventLoop*> io_loops;
+    server.SetIothreadInitCallback([&](EventLoop* io_loop) {
+        std::lock_guard<std::mutex> guard(mutex);
+        io_loops.push_back(io_loop);
+    });
+    std::atomic<int> ups {0};
+    std::atomic<int> downs {0};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        conn->IsConnected() ? ups++ : downs++;
+    });
+    server.ListenAndServe();
+
+    std::vector<size_t> loads;
+    std::vector<size_t> loads_after_close;
+    std::thread client([&]() {
+        std::vector<int> fds;
+        for (int i = 0; i < kClients; i++) {
+            fds.push_back(test::ConnectLoopback(port));
+        }
+        while (ups < kClients) {
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (EventLoop* io_loop : io_loops) {
+                loads.push_back(io_loop->GetLoad().Connections());
+            }
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        while (downs < kClients) {
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        for (EventLoop* io_loop : io_loops) {
+            loads_after_close.push_back(io_loop->GetLoad().Connections());
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(loads, (std::vector<size_t>{2, 2, 2}));
+    EXPECT_EQ(loads_after_close, (std::vector<size_t>{0, 0, 0}));
+}
@@ -0,0 +1,120 @@
+#include <muduo/base/allocator/mem_pool.h>
+#include <muduo/EventLoopThreadPool.h>
+#include <muduo/EventLoop.h>
+#include <gtest/gtest.h>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+
+namespace {
+
+const size_t kSmallIndex = 64 / base::MemoryPool::kALIGN - 1;   // the class of 64 bytes
+
+} // namespace
+
+TEST(MemPoolStats, CountsLiveAndFreeBlocks) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+    const base::MemoryPoolStats before = pool->stats();
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 10; i++) {
+        blocks.push_back(pool->allocate(64));
+    }
+    for (int i = 0; i < 4; i++) {
+        pool->deallocate(blocks.back(), 64);
+        blocks.pop_back();
+    }
+
+    const base::MemoryPoolStats stats = pool->stats();
+    const base::MemoryPoolStats::size_class& c = stats.classes[kSmallIndex];
+    EXPECT_EQ(c.block_size, 64u);
+    EXPECT_EQ(c.allocations - before.classes[kSmallIndex].allocations, 10u);
+    EXPECT_EQ(c.live_blocks - before.classes[kSmallIndex].live_blocks, 6u);
+    EXPECT_EQ(c.high_water - before.classes[kSmallIndex].high_water, 10u);
+    EXPECT_GE(c.free_blocks, 4u);
+    EXPECT_GE(stats.os_bytes, stats.live_bytes() + stats.free_bytes());
+    EXPECT_EQ(stats.pools, 1u);
+
+    for (void* p : blocks) {
+        pool->deallocate(p, 64);
+    }
+}
+
+TEST(MemPoolStats, CountsRemoteFrees) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+    const size_t live_before = pool->stats().classes[kSmallIndex].live_blocks;
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 5; i++) {
+        blocks.push_back(pool->allocate(64));
+    }
+    std::thread foreign([&]() {
+        for (void* p : blocks) {
+            pool->deallocate(p, 64);
+        }
+    });
+    foreign.join();
+
+    const base::MemoryPoolStats::size_class& c = pool->stats().classes[kSmallIndex];
+    EXPECT_EQ(c.remote_frees, 5u);
+    EXPECT_EQ(c.live_blocks, live_before);
+}
+
+TEST(MemPoolStats, CountsSpansAndFallback) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+    const size_t span_index = base::MemoryPool::kFreeListsNum + base::detail::span_alloc::class_index(4096);
+    const base::MemoryPoolStats before = pool->stats();
+
+    void* large = pool->allocate(4096);
+    void* huge = pool->allocate(1024 * 1024);
+    base::MemoryPoolStats stats = pool->stats();
+    EXPECT_EQ(stats.classes[span_index].block_size, 4096u);
+    EXPECT_EQ(stats.classes[span_index].live_blocks - before.classes[span_index].live_blocks, 1u);
+    EXPECT_GT(stats.classes[span_index].free_blocks, 0u);
+    EXPECT_GE(stats.os_bytes - before.os_bytes, base::detail::span_alloc::kSpanBytes);
+    EXPECT_EQ(stats.fallback_allocations - before.fallback_allocations, 1u);
+    EXPECT_EQ(stats.fallback_bytes - before.fallback_bytes, 1024u * 1024);
+
+    pool->deallocate(large, 4096);
+    pool->deallocate(huge, 1024 * 1024);
+    stats = pool->stats();
+    EXPECT_EQ(stats.classes[span_index].live_blocks, before.classes[span_index].live_blocks);
+    EXPECT_EQ(stats.fallback_bytes, before.fallback_bytes);
+}
+
+TEST(MemPoolStats, SumsUpOverThreadPool) {
+    EventLoop base_loop;
+    EventLoopThreadPool threads(&base_loop, "stats");
+    threads.SetPoolSize(2);
+    threads.BuildAndRun();
+
+    const base::MemoryPoolStats before = threads.GetMemoryPoolStats();
+    EXPECT_EQ(before.pools, 3u);
+
+    // each IO loop allocates from its own pool
+    std::vector<std::pair<EventLoop*, void*>> blocks;
+    for (int i = 0; i < 2; i++) {
+        EventLoop* loop = threads.GetNextLoop();
+        std::promise<void*> allocated;
+        loop->RunInEventLoop([loop, &allocated]() {
+            allocated.set_value(loop->GetMemoryPool()->allocate(64));
+        });
+        blocks.emplace_back(loop, allocated.get_future().get());
+    }
+
+    base::MemoryPoolStats stats = threads.GetMemoryPoolStats();
+    EXPECT_EQ(stats.classes[kSmallIndex].live_blocks - before.classes[kSmallIndex].live_blocks, 2u);
+
+    // freed in the base loop, so remotely
+    for (auto& block : blocks) {
+        block.first->GetMemoryPool()->deallocate(block.second, 64);
+    }
+    stats = threads.GetMemoryPoolStats();
+    EXPECT_EQ(stats.classes[kSmallIndex].live_blocks, before.classes[kSmallIndex].live_blocks);
+    EXPECT_EQ(stats.classes[kSmallIndex].remote_frees - before.classes[kSmallIndex].remote_frees, 2u);
+}
@@ -0,0 +1,149 @@
+#include <muduo/base/allocator/Allocatable.h>
+#include <muduo/EventLoopOptions.h>
+#include <muduo/EventLoop.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+
+namespace {
+
+const size_t kBlockSize = 136;  // a size class which the EventLoop itself never uses
+const int kBlocks = 1000;
+
+struct Session : public base::detail::Allocatable {
+    explicit Session(int* destroyed) : destroyed_(destroyed) { }
+    ~Session() { ++*destroyed_; }
+
+    int* destroyed_;
+    char payload[200];
+};
+
+} // namespace
+
+TEST(MemPoolRemoteFree, ForeignFreesAreReusedByOwner) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < kBlocks; i++) {
+        blocks.push_back(pool->allocate(kBlockSize));
+    }
+    std::thread foreign([&]() {
+        for (void* p : blocks) {
+            pool->deallocate(p, kBlockSize);
+        }
+    });
+    foreign.join();
+
+    // at most a refill's worth of blocks is left in the local free list, the others come from the remote list
+    std::set<void*> freed(blocks.begin(), blocks.end());
+    int reused = 0;
+    for (int i = 0; i < kBlocks; i++) {
+        reused += freed.count(pool->allocate(kBlockSize)) ? 1 : 0;
+    }
+    EXPECT_GE(reused, kBlocks - 20);
+}
+
+TEST(MemPoolRemoteFree, ConcurrentForeignFrees) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+    const int kThreads = 4;
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < kBlocks * kThreads; i++) {
+        blocks.push_back(pool->allocate(kBlockSize));
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = t; i < kBlocks * kThreads; i += kThreads) {
+                pool->deallocate(blocks[i], kBlockSize);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    // every block is handed out once again, none is lost or duplicated
+    std::set<void*> freed(blocks.begin(), blocks.end());
+    std::set<void*> reallocated;
+    for (int i = 0; i < kBlocks * kThreads; i++) {
+        void* p = pool->allocate(kBlockSize);
+        EXPECT_TRUE(reallocated.insert(p).second);
+        if (freed.count(p)) {
+            freed.erase(p);
+        }
+    }
+    EXPECT_LE(freed.size(), 20u);
+}
+
+TEST(MemPoolRemoteFree, AllocatableDeletedInForeignThread) {
+    EventLoop loop;
+    int destroyed = 0;
+
+    Session* session = new (loop.GetMemoryPool()) Session(&destroyed);
+    std::thread foreign([session]() { delete session; });
+    foreign.join();
+    EXPECT_EQ(destroyed, 1);
+
+    // the storage went back to the pool of the loop, not to the pool of the foreign thread
+    Session* another = nullptr;
+    bool reused = false;
+    std::vector<Session*> sessions;
+    for (int i = 0; i < 20 && !reused; i++) {
+        another = new (loop.GetMemoryPool()) Session(&destroyed);
+        reused = another == session;
+        sessions.push_back(another);
+    }
+    EXPECT_TRUE(reused);
+    for (Session* s : sessions) {
+        delete s;
+    }
+}
+
+TEST(MemPoolRemoteFree, AllocatableDeletedInForeignLoopThread) {
+    EventLoop loop;
+    int destroyed = 0;
+    Session* session = new (loop.GetMemoryPool()) Session(&destroyed);
+
+    // the foreign thread owns a mempool too, the storage must not go into it
+    std::thread foreign([session]() {
+        EventLoop foreign_loop;
+        delete session;
+    });
+    foreign.join();
+    EXPECT_EQ(destroyed, 1);
+}
+
+TEST(MemPoolRemoteFree, IdleSpansReleasedWithoutAllocation) {
+    const size_t kSpanBlockSize = 8192;     // a span class which the EventLoop itself never uses
+    EventLoopOptions options;
+    options.memPool.remote_drain_interval = std::chrono::milliseconds(10);
+    EventLoop loop(options);
+    base::MemoryPool* pool = loop.GetMemoryPool();
+
+    // several spans, all but the current one of the class can be released
+    const size_t kSpanBlocks = 3 * base::detail::span_alloc::kSpanBytes / kSpanBlockSize;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < kSpanBlocks; i++) {
+        blocks.push_back(pool->allocate(kSpanBlockSize));
+    }
+    const size_t released_before = pool->stats().released_bytes;
+    std::thread foreign([&]() {
+        for (void* p : blocks) {
+            pool->deallocate(p, kSpanBlockSize);
+        }
+    });
+    foreign.join();
+    EXPECT_EQ(pool->stats().released_bytes, released_before);
+
+    // the class never allocates again, the loop drains the remote list by itself
+    loop.RunAfter(std::chrono::milliseconds(100), [&loop]() { loop.Quit(); });
+    loop.Loop();
+    EXPECT_GE(pool->stats().released_bytes - released_before, base::detail::span_alloc::kSpanBytes);
+}
@@ -0,0 +1,118 @@
+/// Compares the loop-level memory pool with glibc malloc on connection churn:
+/// keeps N connections alive, each of them owns a TcpConnection-sized object, a read buffer and a hash-map node,
+/// then closes a random one and accepts a new one for M rounds.
+/// Reports the time per churn and the RSS growth during the churn and after closing all.
+/// Usage: MemPool_bench [live connections] [rounds]
+#include <muduo/EventLoop.h>
+#include <muduo/TcpConnection.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// the blocks a connection owns
+const size_t kBlockSizes[] = {
+    sizeof(TcpConnection) + 16,     // with the cookie of Allocatable
+    Buffer::kCheapPrepend + Buffer::kInitialSize,
+    4096 + 8,                       // a grown read buffer
+    64,                             // a node of the connection map
+};
+const size_t kBlocksPerConn = sizeof(kBlockSizes) / sizeof(kBlockSizes[0]);
+
+long RssKiB() {
+    long pages = 0;
+    long resident = 0;
+    FILE* f = ::fopen("/proc/self/statm", "r");
+    if (f != nullptr) {
+        if (::fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        ::fclose(f);
+    }
+    return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct MallocAlloc {
+    void* Allocate(size_t n) { return ::malloc(n); }
+    void Deallocate(void* p, size_t) { ::free(p); }
+};
+
+struct PoolAlloc {
+    void* Allocate(size_t n) { return pool->allocate(n); }
+    void Deallocate(void* p, size_t n) { pool->deallocate(p, n); }
+    base::MemoryPool* pool;
+};
+
+template <typename Alloc>
+void BenchChurn(const char* name, Alloc alloc, int conns, int rounds) {
+    const long rss_before = RssKiB();
+    std::vector<void*> blocks(conns * kBlocksPerConn);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i] = alloc.Allocate(kBlockSizes[i % kBlocksPerConn]);
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, conns - 1);
+    auto t0 = steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        const size_t conn = static_cast<size_t>(dist(rng)) * kBlocksPerConn;
+        for (size_t b = 0; b < kBlocksPerConn; b++) {
+            alloc.Deallocate(blocks[conn + b], kBlockSizes[b]);
+        }
+        for (size_t b = 0; b < kBlocksPerConn; b++) {
+            blocks[conn + b] = alloc.Allocate(kBlockSizes[b]);
+            *static_cast<char*>(blocks[conn + b]) = 1;  // touches it as the constructor does
+        }
+    }
+    auto t1 = steady_clock::now();
+    const long rss_churn = RssKiB();
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        alloc.Deallocate(blocks[i], kBlockSizes[i % kBlocksPerConn]);
+    }
+    const long rss_closed = RssKiB();
+
+    printf("%-34s %8.1f ns/churn   RSS +%7ld KiB while churning, +%7ld KiB after closing all\n", name,
+        static_cast<double>(duration_cast<nanoseconds>(t1 - t0).count()) / rounds,
+        rss_churn - rss_before, rss_closed - rss_before);
+}
+
+void BenchPool(const char* name, const base::MemoryPoolOptions& pool_options, int conns, int rounds) {
+    EventLoopOptions options;
+    options.memPool = pool_options;
+    EventLoop loop(options);
+    BenchChurn(name, PoolAlloc{loop.GetMemoryPool()}, conns, rounds);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int conns = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 2000000;
+    printf("%d connections, %d rounds, blocks of %zu/%zu/%zu/%zu bytes\n", conns, rounds,
+        kBlockSizes[0], kBlockSizes[1], kBlockSizes[2], kBlockSizes[3]);
+
+    // first, so that it doesn't reuse the heap freed by the other runs
+    BenchChurn("glibc malloc", MallocAlloc(), conns, rounds);
+
+    base::MemoryPoolOptions small_only;
+    small_only.max_bytes = base::MemoryPool::kMax_Bytes;
+    BenchPool("mem_pool, <= 512 bytes only", small_only, conns, rounds);
+
+    BenchPool("mem_pool, spans", base::MemoryPoolOptions(), conns, rounds);
+
+    base::MemoryPoolOptions huge_pages;
+    huge_pages.huge_pages = true;
+    BenchPool("mem_pool, spans on huge pages", huge_pages, conns, rounds);
+
+    base::MemoryPoolOptions keep_spans;
+    keep_spans.release_idle_spans = false;
+    BenchPool("mem_pool, spans never released", keep_spans, conns, rounds);
+}
@@ -0,0 +1,74 @@
+#include <muduo/OutputQueue.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+
+namespace {
+
+/// drains everything from fd until EOF
+std::string ReadAll(int fd) {
+    std::string result;
+    char buf[65536];
+    ssize_t n = 0;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        result.append(buf, static_cast<size_t>(n));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(OutputQueue, LargeAppendIsFlushedInOrder) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::string payload(10 * 1024 * 1024 + 123, '\0');
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = static_cast<char>(i % 251);
+    }
+    auto header = std::make_shared<const std::string>("HEADER:");
+
+    OutputQueue queue;
+    queue.AppendSlice(header, header->data(), header->size());
+    queue.Append(payload.data(), payload.size());
+    queue.Append("!", 1);
+    ASSERT_EQ(queue.ReadableBytes(), header->size() + payload.size() + 1);
+
+    std::string received;
+    std::thread reader([&]() { received = ReadAll(fds[1]); });
+    int savedErrno = 0;
+    while (!queue.Empty()) {
+        ASSERT_GT(queue.WriteFd(fds[0], SIZE_MAX, &savedErrno), 0);
+    }
+    ::close(fds[0]);
+    reader.join();
+    ::close(fds[1]);
+
+    EXPECT_TRUE(received == *header + payload + "!");
+    EXPECT_EQ(header.use_count(), 1);   // released by queue after sent
+}
+
+TEST(OutputQueue, WriteFdHonorsMaxBytes) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    OutputQueue queue;
+    std::string data(3 * OutputQueue::kChunkSize, 'b');
+    queue.Append(data.data(), data.size());
+
+    int savedErrno = 0;
+    EXPECT_EQ(queue.WriteFd(fds[0], 100, &savedErrno), 100);
+    EXPECT_EQ(queue.ReadableBytes(), data.size() - 100);
+
+    queue.Retrieve(queue.ReadableBytes() - 1);
+    EXPECT_EQ(queue.ReadableBytes(), 1u);
+    EXPECT_EQ(queue.WriteFd(fds[0], SIZE_MAX, &savedErrno), 1);
+    EXPECT_TRUE(queue.Empty());
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
@@ -0,0 +1,142 @@
+/// Budget of the pending callbacks per loop iteration, and the high-priority lane which runs ahead of the normal one.
+#include <muduo/EventLoopOptions.h>
+#include <muduo/EventLoop.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// runs a loop in its own thread until it quits, the callbacks enqueued during Hold wait until Release
+class HeldLoop {
+public:
+    explicit HeldLoop(const EventLoopOptions& options)
+        : thread_([this, options]() {
+            EventLoop loop(options);
+            started_.set_value(&loop);
+            loop.Loop();
+        })
+        , loop_(started_.get_future().get())
+    { }
+
+    EventLoop* Loop()
+    { return loop_; }
+
+    /// blocks the loop in a pending callback, the callbacks enqueued meanwhile are handled after it
+    void Hold() {
+        loop_->EnqueueEventLoop([this]() {
+            held_ = true;
+            while (!released_) { }
+        });
+        while (!held_) {
+            std::this_thread::yield();
+        }
+    }
+
+    void Release()
+    { released_ = true; }
+
+    void Join()
+    { thread_.join(); }
+
+private:
+    std::promise<EventLoop*> started_;
+    std::thread thread_;
+    EventLoop* loop_;
+    std::atomic_bool held_ {false};
+    std::atomic_bool released_ {false};
+};
+
+} // namespace
+
+TEST(PendingBudget, CarriesOverBeyondMaxCallbacks) {
+    const int kCallbacks = 50;
+    EventLoopOptions options;
+    options.maxPendingCallbacks = 10;
+    HeldLoop held(options);
+    EventLoop* loop = held.Loop();
+
+    std::vector<int> order;     // only touched in loop thread
+    uint64_t carriedOver = 0;
+    held.Hold();
+    for (int i = 0; i < kCallbacks; i++) {
+        loop->EnqueueEventLoop([&order, &carriedOver, loop, i]() {
+            order.push_back(i);
+            if (i == kCallbacks - 1) {
+                carriedOver = loop->GetCarriedOverIterations();
+                loop->Quit();
+            }
+        });
+    }
+    // enqueued last, runs first
+    loop->EnqueueEventLoop([&order]() { order.push_back(-1); }, CallbackPriority::kHigh);
+    held.Release();
+    held.Join();
+
+    ASSERT_EQ(order.size(), static_cast<size_t>(kCallbacks + 1));
+    EXPECT_EQ(order[0], -1);
+    for (int i = 0; i < kCallbacks; i++) {
+        EXPECT_EQ(order[i + 1], i);
+    }
+    // 10 per iteration, the last one leaves nothing
+    EXPECT_EQ(carriedOver, 4u);
+}
+
+TEST(PendingBudget, CarriesOverBeyondTimeBudget) {
+    const int kCallbacks = 20;
+    EventLoopOptions options;
+    options.pendingCallbacksBudget = milliseconds(1);
+    HeldLoop held(options);
+    EventLoop* loop = held.Loop();
+
+    int handled = 0;
+    uint64_t carriedOver = 0;
+    held.Hold();
+    for (int i = 0; i < kCallbacks; i++) {
+        loop->EnqueueEventLoop([&handled, &carriedOver, loop]() {
+            std::this_thread::sleep_for(milliseconds(1));
+            if (++handled == kCallbacks) {
+                carriedOver = loop->GetCarriedOverIterations();
+                loop->Quit();
+            }
+        });
+    }
+    held.Release();
+    held.Join();
+
+    EXPECT_EQ(handled, kCallbacks);
+    // the budget is checked every 8 callbacks, so 8 + 8 + 4
+    EXPECT_EQ(carriedOver, 2u);
+}
+
+TEST(PendingBudget, UrgentCallbackPreemptsNormalBatch) {
+    EventLoopOptions options;   // unlimited
+    HeldLoop held(options);
+    EventLoop* loop = held.Loop();
+
+    std::atomic<int> normalHandled {0};
+    int normalBeforeUrgent = -1;
+    held.Hold();
+    for (int i = 0; i < 10; i++) {
+        loop->EnqueueEventLoop([&normalHandled, &normalBeforeUrgent, loop]() {
+            if (++normalHandled == 1) {
+                // enqueued during the batch, runs right after this callback
+                loop->EnqueueEventLoop([&normalHandled, &normalBeforeUrgent]() {
+                    normalBeforeUrgent = normalHandled;
+                }, CallbackPriority::kHigh);
+            }
+        });
+    }
+    loop->EnqueueEventLoop([loop]() { loop->Quit(); });
+    held.Release();
+    held.Join();
+
+    EXPECT_EQ(normalHandled, 10);
+    EXPECT_EQ(normalBeforeUrgent, 1);
+}
@@ -0,0 +1,141 @@
+/// Counts heap allocations per cross-thread callback,
+/// for the raw EventLoop::EnqueueEventLoop and for TcpConnection::Send over loopback.
+/// Usage: PendingCallback_bench [iterations]
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+
+namespace {
+std::atomic<uint64_t> g_allocations {0};
+} // namespace
+
+void* operator new(size_t n) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n == 0 ? 1 : n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+void Report(const char* name, int iterations, uint64_t allocations, std::chrono::steady_clock::duration elapsed) {
+    using namespace std::chrono;
+    printf("%-44s %8.3f allocs/op %10.1f ns/op\n", name,
+        static_cast<double>(allocations) / iterations,
+        static_cast<double>(duration_cast<nanoseconds>(elapsed).count()) / iterations);
+}
+
+/// Enqueues iterations tasks made by make_task from this thread, and waits until the loop ran all of them
+template <typename MakeTask>
+void BenchEnqueue(EventLoop* loop, const char* name, int iterations, MakeTask make_task) {
+    auto run = [&]() {
+        std::atomic_bool done {false};
+        for (int i = 0; i < iterations; i++) {
+            loop->EnqueueEventLoop(make_task());
+        }
+        loop->EnqueueEventLoop([&done]() { done.store(true); });
+        while (!done.load()) {
+            std::this_thread::yield();
+        }
+    };
+    run();  // warm up the node caches
+
+    uint64_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    run();
+    Report(name, iterations, g_allocations.load() - before, std::chrono::steady_clock::now() - start);
+}
+
+/// Sends iterations messages to peer from this thread, and waits until the peer received all of them
+void BenchSend(const TcpConnectionPtr& conn, std::atomic<size_t>* received, const char* name, int iterations, size_t msg_len) {
+    const std::string msg(msg_len, 's');
+    auto run = [&]() {
+        size_t expected = received->load() + iterations * msg_len;
+        for (int i = 0; i < iterations; i++) {
+            conn->Send(msg);
+        }
+        while (received->load() < expected) {
+            std::this_thread::yield();
+        }
+    };
+    run();
+
+    uint64_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    run();
+    Report(name, iterations, g_allocations.load() - before, std::chrono::steady_clock::now() - start);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "bench");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    std::promise<TcpConnectionPtr> connected;
+    server.SetConnectionCallback([&connected](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            connected.set_value(conn);
+        }
+    });
+    server.ListenAndServe();
+
+    std::thread producer([&]() {
+        auto guard = std::make_shared<int>(0);
+        BenchEnqueue(&loop, "EnqueueEventLoop(lambda{string,shared_ptr})", iterations, [&guard]() {
+            return [tag = std::string("small"), guard]() { (void)tag; };
+        });
+        BenchEnqueue(&loop, "EnqueueEventLoop(std::function)", iterations, [&guard]() {
+            return std::function<void()>([tag = std::string("small"), guard]() { (void)tag; });
+        });
+
+        // a blocking peer which discards everything
+        int fd = test::ConnectLoopback(port);
+        if (fd < 0) {
+            perror("connect");
+            std::abort();
+        }
+        std::atomic<size_t> received {0};
+        std::thread sink([fd, &received]() {
+            char buf[65536];
+            ssize_t n = 0;
+            while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+                received.fetch_add(static_cast<size_t>(n));
+            }
+        });
+
+        TcpConnectionPtr conn = connected.get_future().get();
+        BenchSend(conn, &received, "TcpConnection::Send(8 bytes) cross-thread", iterations, 8);
+        BenchSend(conn, &received, "TcpConnection::Send(1 KiB) cross-thread", iterations, 1024);
+        printf("(Send(const char*, size_t) copies a payload longer than std::string SSO capacity once, Send(std::string&&) does not)\n");
+
+        ::shutdown(fd, SHUT_RDWR);
+        sink.join();
+        ::close(fd);
+        conn.reset();
+        loop.Quit();
+    });
+
+    loop.Loop();
+    producer.join();
+}
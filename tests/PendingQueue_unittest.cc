@@ -0,0 +1,97 @@
+/// Many threads enqueue callbacks into one loop concurrently,
+/// every callback must run exactly once and keep the order of its producer.
+#include <muduo/EventLoop.h>
+#include <muduo/base/MpscQueue.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+
+namespace {
+
+struct IntNode : public base::MpscNode {
+    explicit IntNode(int v) : value(v) { }
+    int value;
+};
+
+} // namespace
+
+TEST(MpscQueue, ConsumeLeavesLaterPushesForNextCall) {
+    base::MpscQueue queue;
+    IntNode n1(1), n2(2), n3(3);
+    queue.Push(&n1);
+    queue.Push(&n2);
+
+    std::vector<int> seen;
+    size_t cnt = queue.Consume([&](base::MpscNode* node) {
+        seen.push_back(static_cast<IntNode*>(node)->value);
+        if (seen.size() == 1) {
+            queue.Push(&n3);    // pushed during consuming
+        }
+    });
+    EXPECT_EQ(cnt, 2u);
+    EXPECT_EQ(seen, (std::vector<int> {1, 2}));
+
+    cnt = queue.Consume([&](base::MpscNode* node) { seen.push_back(static_cast<IntNode*>(node)->value); });
+    EXPECT_EQ(cnt, 1u);
+    EXPECT_EQ(seen, (std::vector<int> {1, 2, 3}));
+    EXPECT_EQ(queue.Consume([](base::MpscNode*) { }), 0u);
+}
+
+TEST(MpscQueue, ConsumeStopsWhenHandlerReturnsFalse) {
+    base::MpscQueue queue;
+    IntNode n1(1), n2(2), n3(3);
+    queue.Push(&n1);
+    queue.Push(&n2);
+    queue.Push(&n3);
+
+    std::vector<int> seen;
+    size_t cnt = queue.Consume([&](base::MpscNode* node) {
+        seen.push_back(static_cast<IntNode*>(node)->value);
+        return seen.size() < 2;
+    });
+    EXPECT_EQ(cnt, 2u);
+    EXPECT_FALSE(queue.Empty());
+
+    cnt = queue.Consume([&](base::MpscNode* node) { seen.push_back(static_cast<IntNode*>(node)->value); });
+    EXPECT_EQ(cnt, 1u);
+    EXPECT_EQ(seen, (std::vector<int> {1, 2, 3}));
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(EventLoopPendingQueue, ConcurrentProducers) {
+    const int kProducers = 8;
+    const int kPerProducer = 20000;
+
+    EventLoop loop;
+    std::vector<int> nextExpected(kProducers, 0);   // only touched in loop thread
+    int handled = 0;
+    bool inOrder = true;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < kPerProducer; i++) {
+                loop.EnqueueEventLoop([&, p, i]() {
+                    inOrder = inOrder && (nextExpected[p] == i);
+                    nextExpected[p] = i + 1;
+                    if (++handled == kProducers * kPerProducer) {
+                        loop.Quit();
+                    }
+                });
+            }
+        });
+    }
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    EXPECT_TRUE(inOrder);
+    EXPECT_EQ(handled, kProducers * kPerProducer);
+    EXPECT_EQ(loop.GetEnqueuedCallbacks(), static_cast<uint64_t>(kProducers * kPerProducer));
+    EXPECT_GT(loop.GetCoalescedWakeups(), 0u);
+    EXPECT_LE(loop.GetCoalescedWakeups(), loop.GetEnqueuedCallbacks());
+}
@@ -0,0 +1,105 @@
+#include <muduo/base/allocator/mem_pool.h>
+#include <muduo/EventLoop.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+using muduo::base::detail::span_alloc;
+
+TEST(SpanAlloc, SizeClasses) {
+    size_t last_index = 0;
+    for (size_t n = span_alloc::kMin_Bytes + 1; n <= span_alloc::kMax_Bytes; n++) {
+        size_t index = span_alloc::class_index(n);
+        size_t size = span_alloc::class_size(index);
+        ASSERT_LT(index, span_alloc::kClassesNum);
+        ASSERT_GE(size, n);
+        ASSERT_LE(size, n + n / 4);     // at most 25% internal fragmentation
+        ASSERT_GE(index, last_index);
+        last_index = index;
+    }
+    EXPECT_EQ(span_alloc::class_size(0), 640u);
+    EXPECT_EQ(span_alloc::class_size(span_alloc::kClassesNum - 1), span_alloc::kMax_Bytes);
+}
+
+TEST(SpanAlloc, MaxBytes) {
+    EXPECT_EQ(span_alloc(512, true, false).max_bytes(), 0u);
+    EXPECT_EQ(span_alloc(64 * 1024, true, false).max_bytes(), 64u * 1024);
+    EXPECT_EQ(span_alloc(100000, true, false).max_bytes(), 114688u);
+    EXPECT_EQ(span_alloc(1 << 30, true, false).max_bytes(), span_alloc::kMax_Bytes);
+}
+
+TEST(SpanAlloc, BlocksAreDistinctAndKeepTheirData) {
+    span_alloc spans(64 * 1024, true, false);
+    std::vector<char*> blocks;
+    for (int i = 0; i < 2000; i++) {
+        char* p = static_cast<char*>(spans.allocate(3000));
+        std::memset(p, i & 0xff, 3000);
+        blocks.push_back(p);
+    }
+    EXPECT_EQ(std::set<char*>(blocks.begin(), blocks.end()).size(), blocks.size());
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_EQ(blocks[i][0], static_cast<char>(i & 0xff));
+        ASSERT_EQ(blocks[i][2999], static_cast<char>(i & 0xff));
+    }
+    for (char* p : blocks) {
+        spans.deallocate(p, 3000);
+    }
+}
+
+TEST(SpanAlloc, ReleasesIdleSpans) {
+    span_alloc spans(64 * 1024, true, false);
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; i++) {    // about 8 spans
+        blocks.push_back(spans.allocate(16 * 1024));
+    }
+    const size_t mapped = spans.mapped_bytes();
+    EXPECT_GE(mapped, 1000u * 16 * 1024);
+    for (void* p : blocks) {
+        spans.deallocate(p, 16 * 1024);
+    }
+    // all the spans but the current one are released
+    EXPECT_EQ(spans.released_spans(), mapped / span_alloc::kSpanBytes - 1);
+
+    // the released spans are reused by another class before mapping new ones
+    blocks.clear();
+    for (int i = 0; i < 2000; i++) {
+        blocks.push_back(spans.allocate(5000));
+    }
+    EXPECT_EQ(spans.mapped_bytes(), mapped);
+    for (void* p : blocks) {
+        spans.deallocate(p, 5000);
+    }
+}
+
+TEST(SpanAlloc, KeepsIdleSpansIfNotReleasing) {
+    span_alloc spans(64 * 1024, false, true);
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; i++) {
+        blocks.push_back(spans.allocate(16 * 1024));
+    }
+    for (void* p : blocks) {
+        spans.deallocate(p, 16 * 1024);
+    }
+    EXPECT_EQ(spans.released_spans(), 0u);
+}
+
+TEST(SpanAlloc, MemPoolServesLargeBlocksAcrossThreads) {
+    EventLoop loop;
+    base::MemoryPool* pool = loop.GetMemoryPool();
+
+    void* large = pool->allocate(4096);
+    std::thread foreign([&]() { pool->deallocate(large, 4096); });
+    foreign.join();
+    // drained from the remote list back to its span, and handed out first
+    EXPECT_EQ(pool->allocate(4096), large);
+    pool->deallocate(large, 4096);
+
+    // beyond the configured max bytes goes to malloc
+    void* huge = pool->allocate(1024 * 1024);
+    EXPECT_NE(reinterpret_cast<uintptr_t>(huge) & (span_alloc::kSpanBytes - 1), 0u);
+    pool->deallocate(huge, 1024 * 1024);
+}
@@ -0,0 +1,71 @@
+/// Echo over loopback with edge-triggered connections and a tiny IO budget,
+/// every byte must come back although each wakeup only handles a part of it.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include <string>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace {
+
+/// blocking client, sends payload and receives the echo of it
+std::string EchoRoundTrip(uint16_t port, const std::string& payload) {
+    int fd = test::ConnectLoopback(port);
+    if (fd < 0) {
+        return std::string();
+    }
+
+    std::string received;
+    std::thread writer([fd, &payload]() {
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            ssize_t n = ::write(fd, payload.data() + sent, payload.size() - sent);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+    });
+    char buf[65536];
+    while (received.size() < payload.size()) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) break;
+        received.append(buf, static_cast<size_t>(n));
+    }
+    writer.join();
+    ::close(fd);
+    return received;
+}
+
+} // namespace
+
+TEST(TcpConnectionEdgeTriggered, EchoWithSmallBudget) {
+    const std::string payload(4 * 1024 * 1024, 'e');
+    std::string echoed;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "ET");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetEdgeTriggered(true);
+    server.SetIoBudgetPerWakeup(4096);
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        EXPECT_EQ(conn->IsEdgeTriggered(), conn->GetEventLoop()->SupportsEdgeTriggered());
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    std::thread client([&]() {
+        echoed = EchoRoundTrip(port, payload);
+        loop.Quit();
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(echoed.size(), payload.size());
+    EXPECT_TRUE(echoed == payload);
+}
@@ -0,0 +1,121 @@
+/// Adaptive input buffer of TcpConnection over loopback: an idle connection holds no input storage,
+/// the storage grows with large messages and shrinks(then is released) when the messages get smaller.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace {
+
+/// a message of the client and the input storage of server connection after it was handled
+struct Exchange {
+    size_t messageBytes;
+    size_t storageBytes;
+};
+
+/// blocking client, sends every message and waits for its ack
+bool SendMessages(uint16_t port, const std::vector<size_t>& messages) {
+    int fd = test::ConnectLoopback(port);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < messages.size() && ok; i++) {
+        const std::string payload(messages[i], 'i');
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            ssize_t n = ::write(fd, payload.data() + sent, payload.size() - sent);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        char ack;
+        ok = sent == payload.size() && ::read(fd, &ack, 1) == 1;
+    }
+    ::close(fd);
+    return ok;
+}
+
+/// @brief Runs a server which acks every message of @c messages,
+///     the storage of input buffer is recorded after the message callback returned
+std::vector<Exchange> RunExchanges(const std::vector<size_t>& messages) {
+    std::vector<Exchange> exchanges;    // only touched in loop thread
+    size_t received = 0;
+    size_t current = 0;
+    bool clientOk = false;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "InputBuffer");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetOnMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        received += buf->ReadableBytes();
+        buf->RetrieveAll();
+        if (current < messages.size() && received == messages[current]) {
+            received = 0;
+            // queued, so it runs after the connection adjusted its input buffer
+            conn->GetEventLoop()->EnqueueEventLoop([&, conn, buf]() {
+                exchanges.push_back({messages[current], buf->StorageBytes()});
+                current++;
+                conn->Send("a");
+            });
+        }
+    });
+    server.ListenAndServe();
+
+    std::thread client([&]() {
+        clientOk = SendMessages(port, messages);
+        loop.Quit();
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_TRUE(clientOk);
+    EXPECT_EQ(exchanges.size(), messages.size());
+    return exchanges;
+}
+
+} // namespace
+
+TEST(TcpConnectionInputBuffer, IdleConnectionHoldsNoStorage) {
+    const std::vector<size_t> messages(8, 100);
+    std::vector<Exchange> exchanges = RunExchanges(messages);
+
+    for (const Exchange& e : exchanges) {
+        EXPECT_EQ(e.storageBytes, 0u);
+    }
+}
+
+TEST(TcpConnectionInputBuffer, GrowsAndShrinksWithMessageSize) {
+    const size_t kLarge = 128 * 1024;
+    const size_t kMedium = 4 * 1024;
+    const size_t kSmall = 64;
+    std::vector<size_t> messages;
+    messages.insert(messages.end(), 16, kLarge);
+    messages.insert(messages.end(), 64, kMedium);
+    messages.insert(messages.end(), 64, kSmall);
+    std::vector<Exchange> exchanges = RunExchanges(messages);
+    ASSERT_EQ(exchanges.size(), messages.size());
+
+    // the last exchange of each phase, the moving average of read sizes has settled by then
+    const size_t afterLarge = exchanges[15].storageBytes;
+    const size_t afterMedium = exchanges[16 + 63].storageBytes;
+    const size_t afterSmall = exchanges.back().storageBytes;
+
+    // large bursts are read into the input buffer, which keeps the storage between them
+    EXPECT_GE(afterLarge, 64 * 1024u);
+    // shrinks to the smaller reads, but isn't released
+    EXPECT_GT(afterMedium, 0u);
+    EXPECT_LE(afterMedium, 4 * 4 * kMedium);
+    EXPECT_LT(afterMedium, afterLarge);
+    // small messages go through the spill buffer, nothing is held
+    EXPECT_EQ(afterSmall, 0u);
+}
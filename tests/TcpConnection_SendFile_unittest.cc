@@ -0,0 +1,262 @@
+/// Sends file regions interleaved with buffered bytes by sendfile(2),
+/// and forwards a connection to another one by splice(2), the peer must receive every byte in order.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+
+namespace {
+
+std::string Pattern(size_t len, char seed) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        s[i] = static_cast<char>(seed + i % 29);
+    }
+    return s;
+}
+
+/// reads until EOF
+std::string ReceiveAll(int fd) {
+    std::string received;
+    char buf[65536];
+    ssize_t n = 0;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        received.append(buf, static_cast<size_t>(n));
+    }
+    return received;
+}
+
+/// temporary file filled with content, removed at exit of scope
+class TempFile {
+public:
+    explicit TempFile(const std::string& content) {
+        char path[] = "/tmp/muduo_sendfile_XXXXXX";
+        fd_ = ::mkstemp(path);
+        path_ = path;
+        EXPECT_EQ(::write(fd_, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    }
+    ~TempFile() {
+        ::close(fd_);
+        ::unlink(path_.c_str());
+    }
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+    std::string path_;
+};
+
+void RunSendFile(bool edge_triggered) {
+    const std::string content = Pattern(5 * 1024 * 1024, 'f');
+    const std::string head = Pattern(100 * 1024, 'h');
+    const std::string middle = "middle";
+    const std::string tail = Pattern(300 * 1024, 't');
+    TempFile file(content);
+    const off_t offset = 4096 + 17;
+    const size_t len = content.size() - offset - 1000;
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "SendFile");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    std::atomic<int> write_completes {0};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (!conn->IsConnected()) {
+            return;
+        }
+        conn->SetWriteCompleteCallback([&](const TcpConnectionPtr&) { write_completes++; });
+        conn->Send(head);
+        conn->SendFile(file.fd(), offset, len);
+        conn->Send(middle);
+        conn->SendFile(file.fd(), 0, 100);
+        conn->Send(tail);
+        conn->Shutdown();
+    });
+    server.SetEdgeTriggered(edge_triggered);
+    server.ListenAndServe();
+
+    std::string received;
+    std::thread client([&]() {
+        int fd = test::ConnectLoopback(port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));    // let the output queue of server grow
+        received = ReceiveAll(fd);
+        ::close(fd);
+        loop.RunAfter(std::chrono::milliseconds(100), [&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    const std::string expected = head + content.substr(offset, len) + middle + content.substr(0, 100) + tail;
+    EXPECT_EQ(received.size(), expected.size());
+    EXPECT_TRUE(received == expected);
+    EXPECT_GE(write_completes.load(), 1);
+}
+
+} // namespace
+
+TEST(TcpConnectionSendFile, InterleavedWithBuffer) {
+    RunSendFile(false);
+}
+
+TEST(TcpConnectionSendFile, EdgeTriggered) {
+    RunSendFile(true);
+}
+
+TEST(TcpConnectionForward, SpliceToAnotherConnection) {
+    const std::string early = "sent before forwarding";
+    const std::string payload = Pattern(8 * 1024 * 1024, 'p');
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "Forward");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    std::vector<TcpConnectionPtr> conns;
+    server.SetOnMessageCallback([](const TcpConnectionPtr&, Buffer*, ReceiveTimePoint_t) {
+        // keeps the bytes received before forwarding in input buffer
+    });
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            conns.push_back(conn);
+        } else if (conns.size() == 2 && conn == conns[0]) {
+            conns[1]->Shutdown();   // source closed, flush and close the target
+        }
+    });
+    server.ListenAndServe();
+
+    std::string received;
+    std::thread client([&]() {
+        int source = test::ConnectLoopback(port);
+        ASSERT_EQ(::write(source, early.data(), early.size()), static_cast<ssize_t>(early.size()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int target = test::ConnectLoopback(port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        loop.RunInEventLoop([&]() { conns[0]->ForwardTo(conns[1]); });
+        std::thread reader([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));    // let the pipe fill up
+            received = ReceiveAll(target);
+        });
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            ssize_t n = ::write(source, payload.data() + sent, payload.size() - sent);
+            ASSERT_GT(n, 0);
+            sent += static_cast<size_t>(n);
+        }
+        ::close(source);
+        reader.join();
+        ::close(target);
+        loop.RunAfter(std::chrono::milliseconds(100), [&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    const std::string expected = early + payload;
+    EXPECT_EQ(received.size(), expected.size());
+    EXPECT_TRUE(received == expected);
+}
+
+TEST(TcpConnectionForward, SourceCloseShutsDownTarget) {
+    const std::string payload = Pattern(2 * 1024 * 1024, 'q');
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "ForwardClose");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    std::vector<TcpConnectionPtr> conns;
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            conns.push_back(conn);
+        }
+    });
+    server.ListenAndServe();
+
+    std::string received;
+    std::thread client([&]() {
+        int source = test::ConnectLoopback(port);
+        int target = test::ConnectLoopback(port);
+        struct timeval timeout {5, 0};
+        ::setsockopt(target, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        loop.RunInEventLoop([&]() { conns[0]->ForwardTo(conns[1]); });
+        std::thread reader([&]() { received = ReceiveAll(target); });  // EOF comes from the forwarding
+        size_t sent = 0;
+        while (sent < payload.size()) {
+            ssize_t n = ::write(source, payload.data() + sent, payload.size() - sent);
+            ASSERT_GT(n, 0);
+            sent += static_cast<size_t>(n);
+        }
+        ::close(source);
+        reader.join();
+        ::close(target);
+        loop.RunAfter(std::chrono::milliseconds(100), [&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_EQ(received.size(), payload.size());
+    EXPECT_TRUE(received == payload);
+}
+
+TEST(TcpConnectionForward, TargetCloseClosesPausedSource) {
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddr(0, true), "ForwardTargetClose");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetEdgeTriggered(true);
+    std::vector<TcpConnectionPtr> conns;
+    std::atomic<int> closed {0};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            conns.push_back(conn);
+        } else {
+            closed++;
+            conns.erase(std::remove(conns.begin(), conns.end(), conn), conns.end());  // closes the socket
+        }
+    });
+    server.ListenAndServe();
+
+    TcpConnectionPtr heldTarget;   // the target is closed but not destroyed, the source must not wait for it
+    int sendErrno = 0;
+    std::thread client([&]() {
+        int source = test::ConnectLoopback(port);
+        int target = test::ConnectLoopback(port);
+        struct timeval timeout {5, 0};
+        ::setsockopt(source, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        loop.RunInEventLoop([&]() {
+            heldTarget = conns[1];
+            conns[0]->ForwardTo(conns[1]);
+        });
+        std::thread writer([&]() {
+            // nobody reads the target, so the pipe fills up and the source pauses
+            const std::string chunk(64 * 1024, 'w');
+            while (::send(source, chunk.data(), chunk.size(), MSG_NOSIGNAL) > 0) { }
+            sendErrno = errno;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        ::close(target);
+        writer.join();
+        ::close(source);
+        loop.RunAfter(std::chrono::milliseconds(100), [&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(std::chrono::seconds(20), [&loop]() { loop.Quit(); });  // guard
+    loop.Loop();
+    client.join();
+
+    // reset by the server instead of timing out
+    EXPECT_TRUE(sendErrno == ECONNRESET || sendErrno == EPIPE) << sendErrno;
+    EXPECT_EQ(closed.load(), 2);
+    heldTarget.reset();
+}
@@ -0,0 +1,80 @@
+/// Idle connections are closed by TcpServer::SetIdleTimeout, active ones are kept.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+/// @return whether the peer closed the connection
+bool PeerClosed(int fd) {
+    char c;
+    return ::recv(fd, &c, 1, MSG_DONTWAIT) == 0;
+}
+
+} // namespace
+
+TEST(TcpServerIdleTimeout, ClosesIdleKeepsActive) {
+    const milliseconds timeout(300);
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "IdleTimeout");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(2);
+    server.SetIdleTimeout(timeout);
+    std::atomic<int> downs {0};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (!conn->IsConnected()) {
+            downs++;
+        }
+    });
+    server.SetOnMessageCallback([](const TcpConnectionPtr&, Buffer* buf, ReceiveTimePoint_t) {
+        buf->RetrieveAll();
+    });
+    server.ListenAndServe();
+
+    milliseconds idle_lifetime {0};
+    bool active_closed_early = false;
+    bool active_closed_later = false;
+    std::thread client([&]() {
+        int active = test::ConnectLoopback(port);
+        auto start = steady_clock::now();
+        int idle = test::ConnectLoopback(port);
+        std::thread idle_reader([&]() {
+            char c;
+            EXPECT_EQ(::read(idle, &c, 1), 0);  // blocks until the server closes it
+            idle_lifetime = duration_cast<milliseconds>(steady_clock::now() - start);
+        });
+        // keeps sending for more than three timeouts
+        while (steady_clock::now() - start < timeout * 3) {
+            ASSERT_EQ(::write(active, "x", 1), 1);
+            std::this_thread::sleep_for(timeout / 3);
+            active_closed_early = active_closed_early || PeerClosed(active);
+        }
+        idle_reader.join();
+        std::this_thread::sleep_for(timeout * 2);
+        active_closed_later = PeerClosed(active);
+        ::close(idle);
+        ::close(active);
+        loop.RunAfter(milliseconds(50), [&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_GE(idle_lifetime, timeout);
+    EXPECT_LT(idle_lifetime, timeout * 2);
+    EXPECT_FALSE(active_closed_early);
+    EXPECT_TRUE(active_closed_later);
+    EXPECT_EQ(downs.load(), 2);
+}
@@ -0,0 +1,140 @@
+/// With TcpServer::SetReusePortListeners, every IO-loop accepts and serves its own connections.
+#include <muduo/TcpConnection.h>
+#include <muduo/EventLoop.h>
+#include <muduo/TcpServer.h>
+#include <muduo/tests/TestUtil.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <string>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+const int kIoThreads = 4;
+const int kClients = 64;
+
+/// @return the index of the listener accepted conn, from the name "...@index.id"
+int ListenerIndex(const TcpConnectionPtr& conn) {
+    const std::string& name = conn->GetName();
+    return std::stoi(name.substr(name.rfind('@') + 1));
+}
+
+/// connects kClients times and echoes a byte over each, then closes all
+/// @param client_cpu the CPU the client runs on, -1 for any
+/// @return the indexes of the listeners which accepted the connections
+std::set<int> RunEchoServer(bool cpu_steering, int client_cpu) {
+
+    EventLoop loop;
+    InetAddr listen_addr(0, true);
+    TcpServer server(&loop, listen_addr, "ReusePort");
+    const uint16_t port = server.GetListeningAddr().GetPort();
+    server.SetIoThreadNum(kIoThreads);
+    server.SetReusePortListeners(true);
+    server.SetReusePortCpuSteering(cpu_steering);
+
+    std::mutex mutex;
+    std::set<int> listeners;
+    std::atomic<int> ups {0};
+    std::atomic<int> downs {0};
+    std::atomic<bool> accepted_in_base {false};
+    server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->IsConnected()) {
+            ups++;
+            accepted_in_base = accepted_in_base || loop.IsInLoopThread();
+            std::lock_guard<std::mutex> guard(mutex);
+            listeners.insert(ListenerIndex(conn));
+        } else {
+            downs++;
+        }
+    });
+    server.SetOnMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, ReceiveTimePoint_t) {
+        conn->Send(buf->RetrieveAllAsString());
+    });
+    server.ListenAndServe();
+
+    bool echoed = true;
+    std::thread client([&]() {
+        if (client_cpu >= 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(client_cpu, &cpus);
+            ASSERT_EQ(::pthread_setaffinity_np(::pthread_self(), sizeof cpus, &cpus), 0);
+        }
+        std::vector<int> fds;
+        for (int i = 0; i < kClients; i++) {
+            int fd = test::ConnectLoopback(port);
+            char c = 'x';
+            echoed = echoed && fd >= 0 && ::write(fd, &c, 1) == 1 && ::read(fd, &c, 1) == 1 && c == 'x';
+            fds.push_back(fd);
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        while (downs < kClients) {
+            std::this_thread::sleep_for(milliseconds(10));
+        }
+        loop.RunInEventLoop([&loop]() { loop.Quit(); });
+    });
+    loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+    loop.Loop();
+    client.join();
+
+    EXPECT_TRUE(echoed);
+    EXPECT_EQ(ups.load(), kClients);
+    EXPECT_EQ(downs.load(), kClients);
+    EXPECT_FALSE(accepted_in_base.load());
+    return listeners;
+}
+
+} // namespace
+
+TEST(TcpServerReusePort, AcceptsInIoLoops) {
+    // the kernel hashes the 4-tuples over the listeners, 64 connections hardly land on one
+    EXPECT_GT(RunEchoServer(false, -1).size(), 1u);
+}
+
+TEST(TcpServerReusePort, CpuSteering) {
+    // over loopback, the CPU of the client also receives the connections
+    const int cpu = std::thread::hardware_concurrency() > 1 ? 1 : 0;
+    std::set<int> listeners = RunEchoServer(true, cpu);
+    EXPECT_EQ(listeners, std::set<int>{cpu % kIoThreads});
+}
+
+TEST(TcpServerReusePort, DestroysOpenConnections) {
+    std::atomic<int> downs {0};
+    int fd = -1;
+    {
+        EventLoop loop;
+        InetAddr listen_addr(0, true);
+        TcpServer server(&loop, listen_addr, "ReusePort");
+        const uint16_t port = server.GetListeningAddr().GetPort();
+        server.SetIoThreadNum(2);
+        server.SetReusePortListeners(true);
+        server.SetConnectionCallback([&](const TcpConnectionPtr& conn) {
+            if (conn->IsConnected()) {
+                loop.RunInEventLoop([&loop]() { loop.Quit(); });
+            } else {
+                downs++;
+            }
+        });
+        server.ListenAndServe();
+        fd = test::ConnectLoopback(port);
+        ASSERT_GE(fd, 0);
+        loop.RunAfter(seconds(10), [&loop]() { loop.Quit(); });   // guard
+        loop.Loop();
+    }
+    // the server is gone with the connection still open
+    EXPECT_EQ(downs.load(), 1);
+    char c;
+    EXPECT_EQ(::read(fd, &c, 1), 0);
+    ::close(fd);
+}
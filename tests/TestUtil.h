@@ -0,0 +1,37 @@
+#if !defined(MUDUO_TESTS_TESTUTIL_H)
+#define MUDUO_TESTS_TESTUTIL_H
+
+/// Helpers shared by the tests over loopback.
+/// The servers listen on port 0 and the clients connect to the port read back by GetListeningAddr,
+/// so the tests never collide with each other OR with the other services of the host.
+#include <cstdint>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace muduo {
+namespace test {
+
+/// @brief Connects a blocking socket to 127.0.0.1:port
+/// @return the connected socket, -1 if failed
+inline int ConnectLoopback(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace test
+} // namespace muduo
+
+#endif // MUDUO_TESTS_TESTUTIL_H
@@ -0,0 +1,90 @@
+/// Counts heap allocations of timers in the loop thread:
+/// per tick of repeating heartbeat timers, and per one-shot timer added, expired and destroyed.
+/// Usage: TimerAlloc_bench [sessions]
+#include <muduo/EventLoop.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+std::atomic<uint64_t> g_allocations {0};
+} // namespace
+
+void* operator new(size_t n) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n == 0 ? 1 : n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+void Report(const char* name, uint64_t ops, uint64_t allocations) {
+    printf("%-44s %10llu ops %8.4f allocs/op\n", name,
+        static_cast<unsigned long long>(ops),
+        ops == 0 ? 0.0 : static_cast<double>(allocations) / static_cast<double>(ops));
+}
+
+/// sessions heartbeat timers of 10ms, measured for a second after warming up
+void BenchHeartbeat(int sessions) {
+    EventLoop loop;
+    uint64_t ticks = 0;
+    std::vector<TimerId_t> ids;
+    for (int i = 0; i < sessions; i++) {
+        ids.push_back(loop.RunEvery(milliseconds(10), [&ticks]() { ++ticks; }));
+    }
+    uint64_t ticks_before = 0;
+    uint64_t allocs_before = 0;
+    loop.RunAfter(milliseconds(200), [&]() {
+        ticks_before = ticks;
+        allocs_before = g_allocations.load();
+    });
+    loop.RunAfter(milliseconds(1200), [&]() {
+        Report("RunEvery(10ms) tick", ticks - ticks_before, g_allocations.load() - allocs_before);
+        loop.Quit();
+    });
+    loop.Loop();
+}
+
+/// re-arms timeouts of sessions every millisecond, like the request timeouts of busy connections
+void BenchOneShot(int sessions) {
+    EventLoop loop;
+    uint64_t added = 0;
+    uint64_t fired = 0;
+    uint64_t added_before = 0;
+    uint64_t allocs_before = 0;
+    TimerId_t driver = loop.RunEvery(milliseconds(1), [&]() {
+        for (int i = 0; i < sessions / 10; i++) {
+            loop.RunAfter(milliseconds(5), [&fired]() { ++fired; });
+            ++added;
+        }
+    });
+    loop.RunAfter(milliseconds(200), [&]() {
+        added_before = added;
+        allocs_before = g_allocations.load();
+    });
+    loop.RunAfter(milliseconds(1200), [&]() {
+        Report("RunAfter(5ms) in loop, add + expire", added - added_before, g_allocations.load() - allocs_before);
+        loop.cancelTimer(driver);
+        loop.Quit();
+    });
+    loop.Loop();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int sessions = argc > 1 ? std::atoi(argv[1]) : 2000;
+    BenchHeartbeat(sessions);
+    BenchOneShot(sessions);
+}
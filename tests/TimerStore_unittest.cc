@@ -0,0 +1,247 @@
+/// Runs the same timer cases on every timer backend, and checks the cascading of the timing wheel with a virtual clock
+#include <muduo/EventLoop.h>
+#include <muduo/Timer.h>
+#include <muduo/TimerQueue.h>
+#include <muduo/timer/TimingWheel.h>
+#include <muduo/timer/TimerPool.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace muduo;
+using namespace std::chrono;
+
+class TimerStoreTest : public testing::TestWithParam<TimerBackend> {
+protected:
+    EventLoopOptions Options() const {
+        EventLoopOptions options;
+        options.timerBackend = GetParam();
+        return options;
+    }
+};
+
+TEST_P(TimerStoreTest, FiresInOrderAndNeverEarly) {
+    EventLoop loop(Options());
+    const auto start = steady_clock::now();
+    const int delays[] = {320, 5, 120, 0, 260, 5, 40, 700};
+    std::vector<int> fired;
+    bool early = false;
+    for (int delay : delays) {
+        loop.RunAfter(milliseconds(delay), [&, delay]() {
+            fired.push_back(delay);
+            early = early || steady_clock::now() - start < milliseconds(delay);
+        });
+    }
+    loop.RunAfter(milliseconds(800), [&loop]() { loop.Quit(); });
+    loop.Loop();
+
+    std::vector<int> expected(std::begin(delays), std::end(delays));
+    std::stable_sort(expected.begin(), expected.end());
+    EXPECT_EQ(fired, expected);
+    EXPECT_FALSE(early);
+}
+
+TEST_P(TimerStoreTest, CancelPendingAndRunning) {
+    EventLoop loop(Options());
+    int fired = 0;
+    int repeats = 0;
+    TimerId_t pending = loop.RunAfter(milliseconds(300), [&]() { ++fired; });
+    loop.RunAfter(milliseconds(10), [&]() { loop.cancelTimer(pending); });
+    TimerId_t every = 0;
+    every = loop.RunEvery(milliseconds(20), [&]() {
+        if (++repeats == 3) {
+            loop.cancelTimer(every);  // cancels itself while running
+        }
+    });
+    loop.RunAfter(milliseconds(400), [&loop]() { loop.Quit(); });
+    loop.Loop();
+
+    EXPECT_EQ(fired, 0);
+    EXPECT_EQ(repeats, 3);
+}
+
+TEST_P(TimerStoreTest, ManyRandomTimers) {
+    EventLoop loop(Options());
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(0, 600);
+    const int kTimers = 2000;
+    int fired = 0;
+    int canceled = 0;
+    std::vector<TimerId_t> ids;
+    for (int i = 0; i < kTimers; i++) {
+        ids.push_back(loop.RunAfter(milliseconds(dist(rng)), [&]() { ++fired; }));
+    }
+    for (int i = 0; i < kTimers; i += 3) {
+        loop.cancelTimer(ids[i]);
+        ++canceled;
+    }
+    loop.RunAfter(milliseconds(700), [&loop]() { loop.Quit(); });
+    loop.Loop();
+
+    EXPECT_EQ(fired, kTimers - canceled);
+}
+
+/// the timers with overlapping windows of slack fire in few wakeups, but never before their expiration time
+TEST_P(TimerStoreTest, SlackCoalescesExpirations) {
+    EventLoop loop;
+    const int kTimers = 50;
+    auto run = [&](milliseconds slack) {
+        TimerQueue queue(&loop, GetParam());
+        const auto start = steady_clock::now();
+        int fired = 0;
+        bool early = false;
+        bool late = false;
+        for (int i = 0; i < kTimers; i++) {
+            const auto when = start + milliseconds(20 + i);
+            queue.AddTimer(when, Interval_t::zero(), [&, when, slack]() {
+                const auto now = steady_clock::now();
+                early = early || now < when;
+                late = late || now > when + slack + milliseconds(50);
+                if (++fired == kTimers) {
+                    loop.Quit();
+                }
+            }, slack);
+        }
+        loop.RunAfter(seconds(3), [&loop]() { loop.Quit(); });    // guard
+        loop.Loop();
+        EXPECT_EQ(fired, kTimers);
+        EXPECT_FALSE(early);
+        EXPECT_FALSE(late);
+        return queue.TimerfdResets();
+    };
+
+    const uint64_t exact = run(milliseconds(0));
+    const uint64_t coalesced = run(milliseconds(60));
+    EXPECT_LE(coalesced, 4u);
+    EXPECT_LT(coalesced * 4, exact);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, TimerStoreTest, testing::Values(TimerBackend::kHeap, TimerBackend::kWheel));
+
+/// drives the wheel with virtual time, far beyond the range of level 0
+TEST(TimingWheel, AddAfterStoppingOnRoundBoundary) {
+    EventLoop loop;     // provides the memory pool of current thread
+    const auto start = steady_clock::now();
+    detail::TimingWheel wheel(start);
+
+    // the repeating one expires on the last tick of the first round, the other one waits in level 1
+    Timer waiting(start + milliseconds(260), Interval_t::zero(), []() {}, 0);
+    Timer repeating(start + milliseconds(255), Interval_t::zero(), []() {}, 1);
+    wheel.Add(&waiting);
+    wheel.Add(&repeating);
+
+#ifdef MUDUO_USE_MEMPOOL
+    TimerStore::ExpiredTimerList expired(loop.GetMemoryPool());
+#else
+    TimerStore::ExpiredTimerList expired;
+#endif
+    wheel.PopExpired(start + milliseconds(255), &expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired.front(), &repeating);
+
+    // restarted as TimerQueue does, while the wheel stopped on the boundary of the second round
+    repeating.Restart(start + milliseconds(265));
+    wheel.Add(&repeating);
+    EXPECT_EQ(wheel.NextExpiration(), start + milliseconds(260));
+
+    expired.clear();
+    wheel.PopExpired(start + milliseconds(260), &expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired.front(), &waiting);
+    EXPECT_EQ(wheel.NextExpiration(), start + milliseconds(265));
+}
+
+TEST(TimingWheel, CascadeAcrossLevels) {
+    EventLoop loop;     // provides the memory pool of current thread
+    const auto start = steady_clock::now();
+    detail::TimingWheel wheel(start);
+
+    std::mt19937_64 rng(11);
+    const int64_t spans[] = {200, 1 << 12, 1 << 18, 1 << 24, int64_t(1) << 31, int64_t(1) << 33};
+    std::vector<std::unique_ptr<Timer>> timers;
+    TimerId_t id = 0;
+    for (int64_t span : spans) {
+        std::uniform_int_distribution<int64_t> dist(0, span);
+        for (int i = 0; i < 200; i++) {
+            timers.emplace_back(new Timer(start + milliseconds(dist(rng)), Interval_t::zero(), []() {}, id++));
+            wheel.Add(timers.back().get());
+        }
+    }
+    ASSERT_EQ(wheel.Size(), timers.size());
+
+    // jumps from one reported expiration to the next, as the timerfd would do
+#ifdef MUDUO_USE_MEMPOOL
+    TimerStore::ExpiredTimerList expired(loop.GetMemoryPool());
+#else
+    TimerStore::ExpiredTimerList expired;
+#endif
+    std::vector<Timer*> order;
+    int wakeups = 0;
+    while (!wheel.Empty()) {
+        const auto now = wheel.NextExpiration();
+        ASSERT_NE(now, detail::TimePoint_t::max());
+        expired.clear();
+        wheel.PopExpired(now, &expired);
+        for (Timer* t : expired) {
+            EXPECT_LE(t->ExpirationTime(), now);                    // never early
+            EXPECT_LT(now - t->ExpirationTime(), milliseconds(1));  // and at most one tick late
+            order.push_back(t);
+        }
+        ASSERT_LT(++wakeups, 100000);
+    }
+    EXPECT_EQ(order.size(), timers.size());
+}
+
+TEST(TimingWheel, RemoveUnlinks) {
+    EventLoop loop;
+    const auto start = steady_clock::now();
+    detail::TimingWheel wheel(start);
+    Timer near(start + milliseconds(3), Interval_t::zero(), []() {}, 1);
+    Timer far(start + milliseconds(100000), Interval_t::zero(), []() {}, 2);
+    Timer kept(start + milliseconds(100001), Interval_t::zero(), []() {}, 3);
+    wheel.Add(&near);
+    wheel.Add(&far);
+    wheel.Add(&kept);
+    wheel.Remove(&near);
+    wheel.Remove(&far);
+    ASSERT_EQ(wheel.Size(), 1u);
+
+#ifdef MUDUO_USE_MEMPOOL
+    TimerStore::ExpiredTimerList expired(loop.GetMemoryPool());
+#else
+    TimerStore::ExpiredTimerList expired;
+#endif
+    wheel.PopExpired(start + milliseconds(100000), &expired);
+    EXPECT_TRUE(expired.empty());
+    wheel.PopExpired(start + milliseconds(100001), &expired);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], &kept);
+    EXPECT_TRUE(wheel.Empty());
+}
+
+TEST(TimerPool, ReusesNodesAndFindsById) {
+    EventLoop loop;
+    detail::TimerPool pool(&loop);
+    const auto now = steady_clock::now();
+    const int kTimers = 1000;   // several slabs and rehashes
+    std::vector<Timer*> timers;
+    for (int i = 0; i < kTimers; i++) {
+        timers.push_back(pool.Create(now, Interval_t::zero(), []() {}, i, Interval_t::zero()));
+    }
+    ASSERT_EQ(pool.Size(), static_cast<size_t>(kTimers));
+    for (int i = 0; i < kTimers; i += 2) {
+        pool.Destroy(timers[i]);
+    }
+    for (int i = 0; i < kTimers; i++) {
+        EXPECT_EQ(pool.Find(i), i % 2 == 0 ? nullptr : timers[i]);
+    }
+
+    // the destroyed nodes are reused before allocating any new slab
+    Timer* reused = pool.Create(now, Interval_t::zero(), []() {}, kTimers, Interval_t::zero());
+    EXPECT_NE(std::find(timers.begin(), timers.end(), reused), timers.end());
+    EXPECT_EQ(pool.Find(kTimers), reused);
+    EXPECT_EQ(pool.Size(), static_cast<size_t>(kTimers / 2 + 1));
+}
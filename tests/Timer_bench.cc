@@ -0,0 +1,139 @@
+/// Compares the binary heap and the hierarchical timing wheel as timer store of EventLoop,
+/// with the pattern of connection timeouts: add N timers, refresh(cancel + add) each of them, then expire all.
+/// Then counts the timerfd reprogramming of many short timers with different slack.
+/// Usage: Timer_bench [number of timers]
+#include <muduo/EventLoop.h>
+#include <muduo/Timer.h>
+#include <muduo/TimerQueue.h>
+#include <muduo/timer/TimerHeap.h>
+#include <muduo/timer/TimingWheel.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace muduo;
+using namespace std::chrono;
+
+namespace {
+
+const int64_t kMaxTimeoutMs = 60 * 1000;
+
+double NanosPerOp(steady_clock::duration elapsed, int n) {
+    return static_cast<double>(duration_cast<nanoseconds>(elapsed).count()) / n;
+}
+
+/// Drives the store directly with virtual time, only the cost of the data structure is measured
+void BenchStore(EventLoop* loop, const char* name, TimerStore* store, const TimePoint_t& start, int n) {
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int64_t> dist(1, kMaxTimeoutMs);
+    std::vector<std::unique_ptr<Timer>> timers;
+    timers.reserve(n);
+    for (int i = 0; i < n; i++) {
+        timers.emplace_back(new Timer(start + milliseconds(dist(rng)), Interval_t::zero(), []() {}, i));
+    }
+
+    auto t0 = steady_clock::now();
+    for (auto& t : timers) {
+        store->Add(t.get());
+    }
+    auto t1 = steady_clock::now();
+    for (auto& t : timers) {
+        store->Remove(t.get());
+        t->Restart(start + milliseconds(dist(rng)));
+        store->Add(t.get());
+    }
+    auto t2 = steady_clock::now();
+    // wakes up at every reported expiration, as the timerfd does
+#ifdef MUDUO_USE_MEMPOOL
+    TimerStore::ExpiredTimerList expired(loop->GetMemoryPool());
+#else
+    TimerStore::ExpiredTimerList expired;
+#endif
+    size_t popped = 0;
+    int wakeups = 0;
+    while (!store->Empty()) {
+        expired.clear();
+        store->PopExpired(store->NextExpiration(), &expired);
+        popped += expired.size();
+        wakeups++;
+    }
+    auto t3 = steady_clock::now();
+
+    printf("%-8s add %7.1f ns/op  refresh %7.1f ns/op  expire %7.1f ns/op  (%zu timers, %d wakeups)\n", name,
+        NanosPerOp(t1 - t0, n), NanosPerOp(t2 - t1, n), NanosPerOp(t3 - t2, n), popped, wakeups);
+}
+
+/// Goes through the public API of EventLoop in the loop thread, including the allocation and id lookup of timers
+void BenchLoop(const char* name, TimerBackend backend, int n) {
+    EventLoopOptions options;
+    options.timerBackend = backend;
+    EventLoop loop(options);
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int64_t> dist(kMaxTimeoutMs / 2, kMaxTimeoutMs);
+    std::vector<TimerId_t> ids(n);
+
+    auto t0 = steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        ids[i] = loop.RunAfter(milliseconds(dist(rng)), []() {});
+    }
+    auto t1 = steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        loop.cancelTimer(ids[i]);
+        ids[i] = loop.RunAfter(milliseconds(dist(rng)), []() {});
+    }
+    auto t2 = steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        loop.cancelTimer(ids[i]);
+    }
+    auto t3 = steady_clock::now();
+
+    printf("%-8s RunAfter %7.1f ns/op  cancel+RunAfter %7.1f ns/op  cancel %7.1f ns/op\n", name,
+        NanosPerOp(t1 - t0, n), NanosPerOp(t2 - t1, n), NanosPerOp(t3 - t2, n));
+}
+
+/// Adds 20 short timers per millisecond for a second, in real time
+void BenchSlack(const char* name, TimerBackend backend, const Interval_t& slack) {
+    EventLoop loop;
+    TimerQueue queue(&loop, backend);
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int64_t> dist(1, 50);
+    uint64_t fired = 0;
+    TimerId_t producer = loop.RunEvery(milliseconds(1), [&]() {
+        const auto now = steady_clock::now();
+        for (int i = 0; i < 20; i++) {
+            queue.AddTimer(now + milliseconds(dist(rng)), Interval_t::zero(), [&fired]() { ++fired; }, slack);
+        }
+    });
+    loop.RunAfter(seconds(1), [&]() { loop.cancelTimer(producer); });
+    loop.RunAfter(milliseconds(1100), [&loop]() { loop.Quit(); });
+    loop.Loop();
+    printf("%-8s slack %3lldms  %6llu timers fired  %6llu timerfd_settime\n", name,
+        static_cast<long long>(slack.count()),
+        static_cast<unsigned long long>(fired),
+        static_cast<unsigned long long>(queue.TimerfdResets()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    {
+        EventLoop loop;     // provides the memory pool of current thread
+        printf("timer store, virtual time, timeouts in [1ms, %llds]:\n", static_cast<long long>(kMaxTimeoutMs / 1000));
+        std::unique_ptr<TimerStore> heap(TimerStore::NewTimerStore(&loop, TimerBackend::kHeap));
+        BenchStore(&loop, "heap", heap.get(), steady_clock::now(), n);
+        std::unique_ptr<TimerStore> wheel(TimerStore::NewTimerStore(&loop, TimerBackend::kWheel));
+        BenchStore(&loop, "wheel", wheel.get(), steady_clock::now(), n);
+    }
+    printf("EventLoop API:\n");
+    BenchLoop("heap", TimerBackend::kHeap, n);
+    BenchLoop("wheel", TimerBackend::kWheel, n);
+    printf("short timers, 20 per ms, delays in [1ms, 50ms]:\n");
+    for (int slack : {0, 5, 20}) {
+        BenchSlack("heap", TimerBackend::kHeap, milliseconds(slack));
+        BenchSlack("wheel", TimerBackend::kWheel, milliseconds(slack));
+    }
+}
@@ -0,0 +1,36 @@
+#include <muduo/TimerStore.h>
+#include <muduo/timer/TimerHeap.h>
+#include <muduo/timer/TimingWheel.h>
+#include <muduo/EventLoop.h>
+#include <muduo/base/Logging.h>
+#include <cstdlib>
+#include <cstring>
+
+using namespace muduo;
+
+TimerStore* TimerStore::NewTimerStore(EventLoop* loop, TimerBackend backend) {
+    if (backend == TimerBackend::kDefault) {
+        const char* env = ::getenv("MUDUO_TIMER");
+        backend = TimerBackend::kHeap;
+        if (env != nullptr && std::strcmp(env, "wheel") == 0) {
+            backend = TimerBackend::kWheel;
+        } else if (env != nullptr && std::strcmp(env, "heap") != 0) {
+            LOG_WARN << "Unknown MUDUO_TIMER=" << env << ", use binary heap by default";
+        }
+    }
+
+    if (backend == TimerBackend::kWheel) {
+        LOG_DEBUG << "EventLoop " << loop << " uses timing wheel as timer store";
+#ifdef MUDUO_USE_MEMPOOL
+        return new (loop->GetMemoryPool()) detail::TimingWheel(TimePoint_t::clock::now());
+#else
+        return new detail::TimingWheel(TimePoint_t::clock::now());
+#endif
+    }
+    LOG_DEBUG << "EventLoop " << loop << " uses binary heap as timer store";
+#ifdef MUDUO_USE_MEMPOOL
+    return new (loop->GetMemoryPool()) detail::TimerHeap(loop);
+#else
+    return new detail::TimerHeap(loop);
+#endif
+}
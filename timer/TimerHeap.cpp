@@ -0,0 +1,93 @@
+#include <muduo/timer/TimerHeap.h>
+#include <muduo/EventLoop.h>
+#include <muduo/Timer.h>
+#include <cassert>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+TimerHeap::TimerHeap(EventLoop* loop)
+#ifdef MUDUO_USE_MEMPOOL
+    : timerList_(loop->GetMemoryPool())
+#else
+    : timerList_()
+#endif
+{ (void)loop; }
+
+bool TimerHeap::Less(size_t a, size_t b) const {
+    return timerList_[a]->Deadline() < timerList_[b]->Deadline();
+}
+
+void TimerHeap::Place(Timer* t, size_t idx) {
+    timerList_[idx] = t;
+    t->heapIndex_ = idx;
+}
+
+void TimerHeap::SiftUp(size_t idx) {
+    Timer* t = timerList_[idx];
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (!(t->Deadline() < timerList_[parent]->Deadline())) {
+            break;
+        }
+        Place(timerList_[parent], idx);
+        idx = parent;
+    }
+    Place(t, idx);
+}
+
+void TimerHeap::SiftDown(size_t idx) {
+    const size_t n = timerList_.size();
+    Timer* t = timerList_[idx];
+    while (idx * 2 + 1 < n) {
+        size_t child = idx * 2 + 1;
+        if (child + 1 < n && Less(child + 1, child)) {
+            child += 1;
+        }
+        if (!(timerList_[child]->Deadline() < t->Deadline())) {
+            break;
+        }
+        Place(timerList_[child], idx);
+        idx = child;
+    }
+    Place(t, idx);
+}
+
+void TimerHeap::Add(Timer* t) {
+    timerList_.push_back(t);
+    t->heapIndex_ = timerList_.size() - 1;
+    SiftUp(t->heapIndex_);
+}
+
+void TimerHeap::Remove(Timer* t) {
+    const size_t idx = t->heapIndex_;
+    assert(idx < timerList_.size() && timerList_[idx] == t);
+    RemoveAt(idx);
+}
+
+void TimerHeap::RemoveAt(size_t idx) {
+    Timer* back = timerList_.back();
+    timerList_.pop_back();
+    if (idx == timerList_.size()) {
+        return; // removed the back
+    }
+    Place(back, idx);
+    if (idx > 0 && back->Deadline() < timerList_[(idx - 1) / 2]->Deadline()) {
+        SiftUp(idx);
+    } else {
+        SiftDown(idx);
+    }
+}
+
+void TimerHeap::PopExpired(const TimePoint_t& now, ExpiredTimerList* expired) {
+    // in the order of deadline, also takes the timers which are due but still within their slack,
+    // so that they are coalesced into this wakeup
+    while (!timerList_.empty() && timerList_.front()->ExpirationTime() <= now) {
+        expired->push_back(timerList_.front());
+        RemoveAt(0);
+    }
+}
+
+TimePoint_t TimerHeap::NextExpiration() const {
+    return timerList_.empty() ? TimePoint_t::max() : timerList_.front()->Deadline();
+}
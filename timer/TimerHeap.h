@@ -0,0 +1,44 @@
+#if !defined(MUDUO_TIMER_TIMERHEAP_H)
+#define MUDUO_TIMER_TIMERHEAP_H
+
+#include <muduo/TimerStore.h>
+
+namespace muduo {
+namespace detail {
+
+/**
+ * binary min-heap ordered by deadline,
+ * the index of a timer in heap is kept in the timer itself, so no position map is updated while sifting
+*/
+class TimerHeap : public TimerStore {
+#ifdef MUDUO_USE_MEMPOOL
+    using TimerList = std::vector<Timer*, base::allocator<Timer*>>;
+#else
+    using TimerList = std::vector<Timer*>;
+#endif
+
+public:
+    explicit TimerHeap(EventLoop* loop);
+    ~TimerHeap() noexcept override = default;
+
+    void Add(Timer* t) override;
+    void Remove(Timer* t) override;
+    void PopExpired(const TimePoint_t& now, ExpiredTimerList* expired) override;
+    TimePoint_t NextExpiration() const override;
+    size_t Size() const override { return timerList_.size(); }
+
+private:
+    void RemoveAt(size_t idx);
+    void SiftUp(size_t idx);
+    void SiftDown(size_t idx);
+    void Place(Timer* t, size_t idx);
+    bool Less(size_t a, size_t b) const;
+
+private:
+    TimerList timerList_;
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_TIMER_TIMERHEAP_H
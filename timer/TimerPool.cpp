@@ -0,0 +1,99 @@
+#include <muduo/timer/TimerPool.h>
+#include <muduo/EventLoop.h>
+#include <cassert>
+#include <new>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+const size_t TimerPool::kSlabTimers;
+
+namespace {
+const size_t kInitialBuckets = 64;  // power of 2
+} // namespace
+
+TimerPool::TimerPool(EventLoop* loop)
+    : slabs_()
+    , freeList_(nullptr)
+#ifdef MUDUO_USE_MEMPOOL
+    , buckets_(kInitialBuckets, nullptr, base::allocator<Timer*>(loop->GetMemoryPool()))
+#else
+    , buckets_(kInitialBuckets, nullptr)
+#endif
+    , size_(0)
+{ (void)loop; }
+
+TimerPool::~TimerPool() noexcept {
+    for (Timer* head : buckets_) {
+        while (head != nullptr) {
+            Timer* next = head->hashNext_;
+            head->~Timer();
+            head = next;
+        }
+    }
+}
+
+void TimerPool::AllocateSlab() {
+    slabs_.emplace_back(new Node[kSlabTimers]);
+    Node* slab = slabs_.back().get();
+    for (size_t i = kSlabTimers; i > 0; i--) {
+        Node* node = &slab[i - 1];
+        *reinterpret_cast<Node**>(node) = freeList_;
+        freeList_ = node;
+    }
+}
+
+Timer* TimerPool::Create(const TimePoint_t& when, const Interval_t& interval, TimeoutCb_t cb, TimerId_t id, const Interval_t& slack) {
+    if (freeList_ == nullptr) {
+        AllocateSlab();
+    }
+    Node* node = freeList_;
+    freeList_ = *reinterpret_cast<Node**>(node);
+    Timer* t = ::new (node) Timer(when, interval, std::move(cb), id, slack);
+
+    if (size_ >= buckets_.size()) {
+        Rehash(buckets_.size() * 2);
+    }
+    Timer*& head = buckets_[BucketOf(id)];
+    t->hashNext_ = head;
+    head = t;
+    size_ += 1;
+    return t;
+}
+
+void TimerPool::Destroy(Timer* t) {
+    Timer** link = &buckets_[BucketOf(t->GetId())];
+    while (*link != t) {
+        assert(*link != nullptr);
+        link = &(*link)->hashNext_;
+    }
+    *link = t->hashNext_;
+    size_ -= 1;
+
+    t->~Timer();
+    Node* node = reinterpret_cast<Node*>(t);
+    *reinterpret_cast<Node**>(node) = freeList_;
+    freeList_ = node;
+}
+
+Timer* TimerPool::Find(TimerId_t id) const {
+    Timer* t = buckets_[BucketOf(id)];
+    while (t != nullptr && t->GetId() != id) {
+        t = t->hashNext_;
+    }
+    return t;
+}
+
+void TimerPool::Rehash(size_t bucket_count) {
+    BucketList buckets(bucket_count, nullptr, buckets_.get_allocator());
+    buckets.swap(buckets_);
+    for (Timer* head : buckets) {
+        while (head != nullptr) {
+            Timer* next = head->hashNext_;
+            Timer*& new_head = buckets_[BucketOf(head->GetId())];
+            head->hashNext_ = new_head;
+            new_head = head;
+            head = next;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#if !defined(MUDUO_TIMER_TIMERPOOL_H)
+#define MUDUO_TIMER_TIMERPOOL_H
+
+#include <muduo/base/allocator/Allocatable.h>
+#include <muduo/base/allocator/sgi_stl_alloc.h>
+#include <muduo/TimerType.h>
+#include <muduo/Timer.h>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace muduo {
+
+class EventLoop;    // forward declaration
+
+namespace detail {
+
+/**
+ * Owns the timers of a TimerQueue.
+ * The timers are constructed in slabs of kSlabTimers nodes, a destroyed node is reused by the next timer,
+ * and they are indexed by id with an intrusive hash table(chained by Timer::hashNext_),
+ * so creating, looking up and destroying a timer allocate nothing in the steady state.
+ * @note not thread-safe, only used in the loop thread
+*/
+#ifdef MUDUO_USE_MEMPOOL
+class TimerPool : public base::detail::Allocatable {
+    using BucketList = std::vector<Timer*, base::allocator<Timer*>>;
+#else
+class TimerPool {
+    using BucketList = std::vector<Timer*>;
+#endif
+    using Node = std::aligned_storage_t<sizeof(Timer), alignof(Timer)>;
+
+    // non-copyable & non-moveable
+    TimerPool(const TimerPool&) = delete;
+    TimerPool& operator=(const TimerPool&) = delete;
+
+public:
+    static const size_t kSlabTimers = 256;
+
+    explicit TimerPool(EventLoop* loop);
+    ~TimerPool() noexcept;
+
+    Timer* Create(const TimePoint_t& when, const Interval_t& interval, TimeoutCb_t cb, TimerId_t id, const Interval_t& slack);
+    void Destroy(Timer* t);
+    /// @return nullptr if there is no such timer
+    Timer* Find(TimerId_t id) const;
+    size_t Size() const { return size_; }
+
+private:
+    size_t BucketOf(TimerId_t id) const
+    { return static_cast<size_t>(id) & (buckets_.size() - 1); }
+    void Rehash(size_t bucket_count);
+    void AllocateSlab();
+
+private:
+    std::vector<std::unique_ptr<Node[]>> slabs_;
+    Node* freeList_;    // the destroyed nodes, linked by the first word of node
+    BucketList buckets_;
+    size_t size_;
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_TIMER_TIMERPOOL_H
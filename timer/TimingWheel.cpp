@@ -0,0 +1,219 @@
+#include <muduo/timer/TimingWheel.h>
+#include <muduo/Timer.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+const int TimingWheel::kRootBits;
+const int TimingWheel::kLevelBits;
+const int TimingWheel::kLevels;
+const size_t TimingWheel::kRootSlots;
+const size_t TimingWheel::kLevelSlots;
+const size_t TimingWheel::kTotalSlots;
+
+namespace {
+const uint64_t kMaxSpan = (uint64_t(1) << (TimingWheel::kRootBits + TimingWheel::kLevels * TimingWheel::kLevelBits)) - 1;
+} // namespace
+
+TimingWheel::TimingWheel(const TimePoint_t& start)
+    : start_(start)
+    , current_(0)
+    , size_(0)
+    , slots_()
+    , occupied_()
+{ }
+
+uint64_t TimingWheel::CeilTick(const TimePoint_t& tp) const {
+    if (tp <= start_) {
+        return 0;
+    }
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(tp - start_);
+    return static_cast<uint64_t>(ms.count());
+}
+
+uint64_t TimingWheel::FloorTick(const TimePoint_t& tp) const {
+    if (tp <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(tp - start_).count());
+}
+
+TimePoint_t TimingWheel::TimeOfTick(uint64_t tick) const {
+    return start_ + std::chrono::milliseconds(tick);
+}
+
+void TimingWheel::Link(Timer* t, size_t slot) {
+    Timer*& head = slots_[slot];
+    t->prev_ = nullptr;
+    t->next_ = head;
+    t->slot_ = &head;
+    if (head != nullptr) {
+        head->prev_ = t;
+    }
+    head = t;
+    occupied_[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimingWheel::Unlink(Timer* t) {
+    if (t->prev_ != nullptr) {
+        t->prev_->next_ = t->next_;
+    } else {
+        *t->slot_ = t->next_;
+        if (t->next_ == nullptr) {
+            const size_t slot = static_cast<size_t>(t->slot_ - slots_);
+            occupied_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        }
+    }
+    if (t->next_ != nullptr) {
+        t->next_->prev_ = t->prev_;
+    }
+    t->prev_ = t->next_ = nullptr;
+    t->slot_ = nullptr;
+}
+
+void TimingWheel::Place(Timer* t) {
+    // an overdue timer fires on the next tick
+    uint64_t expires = std::max(t->tick_, current_);
+    uint64_t delta = expires - current_;
+    if (delta < kRootSlots) {
+        Link(t, SlotOf(0, expires & (kRootSlots - 1)));
+        return;
+    }
+    if (delta > kMaxSpan) {
+        expires = current_ + kMaxSpan;  // re-placed with the real tick when cascaded
+        delta = kMaxSpan;
+    }
+    for (int level = 1; level <= kLevels; level++) {
+        const int shift = ShiftOf(level);
+        if (delta < (uint64_t(1) << (shift + kLevelBits))) {
+            Link(t, SlotOf(level, (expires >> shift) & (kLevelSlots - 1)));
+            return;
+        }
+    }
+    assert(false);
+}
+
+void TimingWheel::Add(Timer* t) {
+    t->tick_ = CeilTick(t->ExpirationTime());
+    const uint64_t last = FloorTick(t->Deadline());
+    if (last > t->tick_) {
+        // picks the tick with most trailing zeros within the slack, so that the timers
+        // with overlapping windows are rounded to the same tick and fire together
+        const int bit = 63 - __builtin_clzll(t->tick_ ^ last);
+        t->tick_ = last & ~((uint64_t(1) << bit) - 1);
+    }
+    Place(t);
+    size_ += 1;
+}
+
+void TimingWheel::Remove(Timer* t) {
+    assert(t->slot_ != nullptr);
+    Unlink(t);
+    size_ -= 1;
+}
+
+size_t TimingWheel::Cascade(int level) {
+    const size_t index = (current_ >> ShiftOf(level)) & (kLevelSlots - 1);
+    const size_t slot = SlotOf(level, index);
+    Timer* t = slots_[slot];
+    slots_[slot] = nullptr;
+    occupied_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    while (t != nullptr) {
+        Timer* next = t->next_;
+        Place(t);
+        t = next;
+    }
+    return index;
+}
+
+size_t TimingWheel::FindOccupied(size_t from, size_t to) const {
+    while (from <= to) {
+        uint64_t word = occupied_[from / 64] >> (from % 64);
+        if (word != 0) {
+            size_t found = from + static_cast<size_t>(__builtin_ctzll(word));
+            return found <= to ? found : kTotalSlots;
+        }
+        from = (from / 64 + 1) * 64;
+    }
+    return kTotalSlots;
+}
+
+void TimingWheel::PopExpired(const TimePoint_t& now, ExpiredTimerList* expired) {
+    if (now < start_) {
+        return;
+    }
+    const uint64_t now_tick = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count());
+    while (current_ <= now_tick) {
+        if (size_ == 0) {
+            current_ = now_tick + 1;    // nothing to cascade, jump
+            break;
+        }
+        const size_t index = current_ & (kRootSlots - 1);
+        Timer* t = slots_[index];
+        if (t != nullptr) {
+            slots_[index] = nullptr;
+            occupied_[index / 64] &= ~(uint64_t(1) << (index % 64));
+            for (; t != nullptr; t = t->next_) {
+                t->slot_ = nullptr;
+                expired->push_back(t);
+                size_ -= 1;
+            }
+        }
+        current_ += 1;
+
+        // skip the empty slots of level 0 in this round
+        const size_t next_index = current_ & (kRootSlots - 1);
+        if (next_index != 0) {
+            const size_t found = FindOccupied(next_index, kRootSlots - 1);
+            const uint64_t round_start = current_ - next_index;
+            const uint64_t next = found == kTotalSlots ? round_start + kRootSlots : round_start + found;
+            current_ = std::min(next, now_tick + 1);
+        }
+        if ((current_ & (kRootSlots - 1)) == 0) {
+            // a round of level 0 passed, cascade the next slot of level 1, and so on.
+            // Done as soon as current_ reaches the boundary, so the timers added meanwhile
+            // AND NextExpiration never see the round before its cascading
+            for (int level = 1; level <= kLevels && Cascade(level) == 0; level++) { }
+        }
+    }
+}
+
+TimePoint_t TimingWheel::NextExpiration() const {
+    if (size_ == 0) {
+        return TimePoint_t::max();
+    }
+    const size_t index = current_ & (kRootSlots - 1);
+    const uint64_t round_start = current_ - index;
+    size_t found = FindOccupied(index, kRootSlots - 1);
+    if (found != kTotalSlots) {
+        return TimeOfTick(round_start + found); // exact, the timers of higher levels expire in later rounds
+    }
+
+    // the earliest of: a timer of level 0 in next round, OR the next cascading of a non-empty slot
+    uint64_t next = UINT64_MAX;
+    found = FindOccupied(0, index == 0 ? 0 : index - 1);
+    if (found != kTotalSlots) {
+        next = round_start + kRootSlots + found;
+    }
+    for (int level = 1; level <= kLevels; level++) {
+        const int shift = ShiftOf(level);
+        const uint64_t pos = current_ >> shift;
+        // the slot of current position was cascaded when current_ entered it
+        for (uint64_t k = 1; k <= kLevelSlots; k++) {
+            const uint64_t cascade_tick = (pos + k) << shift;
+            if (cascade_tick >= next) {
+                break;
+            }
+            const size_t slot = SlotOf(level, (pos + k) & (kLevelSlots - 1));
+            if (occupied_[slot / 64] & (uint64_t(1) << (slot % 64))) {
+                next = cascade_tick;
+                break;
+            }
+        }
+    }
+    assert(next != UINT64_MAX);
+    return TimeOfTick(next);
+}
@@ -0,0 +1,74 @@
+#if !defined(MUDUO_TIMER_TIMINGWHEEL_H)
+#define MUDUO_TIMER_TIMINGWHEEL_H
+
+#include <muduo/TimerStore.h>
+#include <cstdint>
+
+namespace muduo {
+namespace detail {
+
+/// @code
+///  level 0: 256 slots x 1 tick          [current, current + 2^8)
+///  level 1:  64 slots x 2^8 ticks       [.., current + 2^14)
+///  level 2:  64 slots x 2^14 ticks      [.., current + 2^20)
+///  level 3:  64 slots x 2^20 ticks      [.., current + 2^26)
+///  level 4:  64 slots x 2^26 ticks      [.., current + 2^32), farther timers are clamped and re-placed later
+/// @endcode
+
+/**
+ * hierarchical timing wheel, a tick is 1 millisecond.
+ * A timer is linked into the slot of its expiration tick in O(1), and unlinked in O(1) when canceled.
+ * When the level-0 wheel turns a round, the next slot of level 1 is cascaded(re-placed) into lower levels,
+ * and so on, so each timer is moved at most once per level.
+ * Timers fire at tick granularity, never before their expiration time and at most one tick after their deadline.
+*/
+class TimingWheel : public TimerStore {
+public:
+    static const int kRootBits = 8;
+    static const int kLevelBits = 6;
+    static const int kLevels = 4;   // excluding level 0
+    static const size_t kRootSlots = 1 << kRootBits;
+    static const size_t kLevelSlots = 1 << kLevelBits;
+    static const size_t kTotalSlots = kRootSlots + kLevels * kLevelSlots;
+
+    explicit TimingWheel(const TimePoint_t& start);
+    ~TimingWheel() noexcept override = default;
+
+    void Add(Timer* t) override;
+    void Remove(Timer* t) override;
+    void PopExpired(const TimePoint_t& now, ExpiredTimerList* expired) override;
+    TimePoint_t NextExpiration() const override;
+    size_t Size() const override { return size_; }
+
+private:
+    /// @return the first tick at or after tp
+    uint64_t CeilTick(const TimePoint_t& tp) const;
+    /// @return the last tick at or before tp
+    uint64_t FloorTick(const TimePoint_t& tp) const;
+    TimePoint_t TimeOfTick(uint64_t tick) const;
+    static int ShiftOf(int level)
+    { return kRootBits + (level - 1) * kLevelBits; }
+    static size_t SlotOf(int level, size_t index)
+    { return level == 0 ? index : kRootSlots + (level - 1) * kLevelSlots + index; }
+
+    void Place(Timer* t);
+    void Link(Timer* t, size_t slot);
+    void Unlink(Timer* t);
+    /// @brief Re-places the timers in the slot of level for current round
+    /// @return index of the slot
+    size_t Cascade(int level);
+    /// @return the first occupied slot in [from, to], or kTotalSlots if none
+    size_t FindOccupied(size_t from, size_t to) const;
+
+private:
+    TimePoint_t start_;     // time of tick 0
+    uint64_t current_;      // the next tick to process
+    size_t size_;
+    Timer* slots_[kTotalSlots];
+    uint64_t occupied_[kTotalSlots / 64];   // bitmap of non-empty slots
+};
+
+} // namespace detail
+} // namespace muduo
+
+#endif // MUDUO_TIMER_TIMINGWHEEL_H